@@ -0,0 +1,88 @@
+#include "arena.h"
+
+#include <string.h>
+
+#include "utils.h"
+
+#define SKARD_ARENA_ALIGN(size) \
+    (((size) + SKARD_ARENA_ALIGNMENT - 1) & ~(size_t) (SKARD_ARENA_ALIGNMENT - 1))
+
+static uint8_t *arena_block_data(ArenaBlock *block)
+{
+    return (uint8_t *) block + SKARD_ARENA_ALIGN(sizeof(ArenaBlock));
+}
+
+void arena_init(Arena *arena)
+{
+    arena->current = NULL;
+}
+
+void arena_free(Arena *arena)
+{
+    ArenaBlock *block = arena->current;
+    while (block != NULL) {
+        ArenaBlock *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    arena_init(arena);
+}
+
+void arena_reset(Arena *arena)
+{
+    ArenaBlock *current = arena->current;
+    if (current == NULL) {
+        return;
+    }
+
+    ArenaBlock *block = current->previous;
+    while (block != NULL) {
+        ArenaBlock *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    current->previous = NULL;
+    current->used = 0;
+}
+
+void *arena_allocate(Arena *arena, size_t size)
+{
+    size = SKARD_ARENA_ALIGN(size);
+    ArenaBlock *current = arena->current;
+    if (current == NULL || current->size - current->used < size) {
+        size_t block_size = current == NULL ? SKARD_ARENA_MIN_BLOCK_SIZE : current->size * 2;
+        while (block_size < size) {
+            block_size *= 2;
+        }
+
+        ArenaBlock *block = (ArenaBlock *) allocate(SKARD_ARENA_ALIGN(sizeof(ArenaBlock)) + block_size);
+        block->previous = current;
+        block->size = block_size;
+        block->used = 0;
+        arena->current = current = block;
+    }
+
+    void *pointer = arena_block_data(current) + current->used;
+    current->used += size;
+    return pointer;
+}
+
+void *arena_grow(Arena *arena, void *pointer, size_t old_size, size_t new_size)
+{
+    if (pointer == NULL) {
+        return arena_allocate(arena, new_size);
+    }
+
+    ArenaBlock *current = arena->current;
+    old_size = SKARD_ARENA_ALIGN(old_size);
+    new_size = SKARD_ARENA_ALIGN(new_size);
+    uint8_t *end = arena_block_data(current) + current->used;
+    if ((uint8_t *) pointer + old_size == end && current->size - (current->used - old_size) >= new_size) {
+        current->used = current->used - old_size + new_size;
+        return pointer;
+    }
+
+    void *moved = arena_allocate(arena, new_size);
+    memcpy(moved, pointer, old_size < new_size ? old_size : new_size);
+    return moved;
+}
@@ -0,0 +1,37 @@
+#ifndef SKARD_ARENA_H
+#define SKARD_ARENA_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define SKARD_ARENA_MIN_BLOCK_SIZE 4096
+#define SKARD_ARENA_ALIGNMENT 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *previous;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+// Bump pointer allocator, everything allocated from it is released at once. Blocks double in size, so a reset arena
+// keeps its largest block and usually serves the next round without calling the allocator.
+typedef struct {
+    ArenaBlock *current;
+} Arena;
+
+void arena_init(Arena *arena);
+void arena_free(Arena *arena);
+// Releases every allocation but keeps the current block
+void arena_reset(Arena *arena);
+
+void *arena_allocate(Arena *arena, size_t size);
+// Extends the last allocation in place when it fits, otherwise moves it
+void *arena_grow(Arena *arena, void *pointer, size_t old_size, size_t new_size);
+
+#define SKARD_ARENA_ALLOCATE(arena, type) \
+    (type *) arena_allocate(arena, sizeof(type))
+
+#define SKARD_ARENA_GROW_ARRAY(arena, type, pointer, old_capacity, new_capacity) \
+    (type *) arena_grow(arena, pointer, sizeof(type) * (old_capacity), sizeof(type) * (new_capacity))
+
+#endif //SKARD_ARENA_H
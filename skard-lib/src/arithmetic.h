@@ -0,0 +1,69 @@
+#ifndef SKARD_ARITHMETIC_H
+#define SKARD_ARITHMETIC_H
+
+#include "value.h"
+
+// Semantics of the arithmetic instructions, the compiler folds constants with the same functions the VM runs. Int
+// arithmetic wraps around on overflow.
+
+// Values are untagged, the compiler picks the specialized instruction for the operand kinds
+static inline Value vm_to_real(Value value)
+{
+    return make_value_real((SkReal) value.as.sk_int);
+}
+
+static inline Value vm_negate_int(Value value)
+{
+    return make_value_int((SkInt) (0 - (uint64_t) value.as.sk_int));
+}
+
+static inline Value vm_negate_real(Value value)
+{
+    return make_value_real(-value.as.sk_real);
+}
+
+static inline Value vm_add_int(Value first, Value second)
+{
+    return make_value_int((SkInt) ((uint64_t) first.as.sk_int + (uint64_t) second.as.sk_int));
+}
+
+static inline Value vm_add_real(Value first, Value second)
+{
+    return make_value_real(first.as.sk_real + second.as.sk_real);
+}
+
+static inline Value vm_subtract_int(Value first, Value second)
+{
+    return make_value_int((SkInt) ((uint64_t) first.as.sk_int - (uint64_t) second.as.sk_int));
+}
+
+static inline Value vm_subtract_real(Value first, Value second)
+{
+    return make_value_real(first.as.sk_real - second.as.sk_real);
+}
+
+static inline Value vm_multiply_int(Value first, Value second)
+{
+    return make_value_int((SkInt) ((uint64_t) first.as.sk_int * (uint64_t) second.as.sk_int));
+}
+
+static inline Value vm_multiply_real(Value first, Value second)
+{
+    return make_value_real(first.as.sk_real * second.as.sk_real);
+}
+
+static inline Value vm_divide_real(Value first, Value second)
+{
+    return make_value_real(first.as.sk_real / second.as.sk_real);
+}
+
+// Caller is responsible for rejecting a zero divisor
+static inline Value vm_div_int(Value first, Value second)
+{
+    if (second.as.sk_int == -1) {
+        return vm_negate_int(first);
+    }
+    return make_value_int(first.as.sk_int / second.as.sk_int);
+}
+
+#endif //SKARD_ARITHMETIC_H
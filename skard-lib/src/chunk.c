@@ -1,127 +1,535 @@
 #include "chunk.h"
 
+#include <assert.h>
+#include <string.h>
+
 #include "utils.h"
 #include "error.h"
+#include "jit.h"
+#include "verifier.h"
+#include "skc.h"
 
 void debug_info_init(DebugInfo *debug_info)
 {
-    debug_info->lines_count = 0;
-    debug_info->lines_capacity = 0;
-    debug_info->lines = NULL;
-    debug_info->columns_count = 0;
-    debug_info->columns_capacity = 0;
-    debug_info->columns = NULL;
+    debug_info->count = 0;
+    debug_info->runs_count = 0;
+    debug_info->last_offset = 0;
+    debug_info->last_line = 0;
+    debug_info->last_column = 0;
+    debug_info->bytes_count = 0;
+    debug_info->bytes_capacity = 0;
+    debug_info->bytes = NULL;
+    debug_info->checkpoints_count = 0;
+    debug_info->checkpoints_capacity = 0;
+    debug_info->checkpoints = NULL;
+    debug_info->side_path = NULL;
+    debug_info->side_id = 0;
+    debug_info->side = NULL;
+}
+
+static void debug_info_free_side(DebugInfo *debug_info)
+{
+    if (debug_info->side != NULL) {
+        debug_info_free(debug_info->side);
+        free(debug_info->side);
+        debug_info->side = NULL;
+    }
+    debug_info->side_path = SKARD_FREE_ARRAY(char, debug_info->side_path);
 }
 
 void debug_info_free(DebugInfo *debug_info)
 {
-    SKARD_FREE_ARRAY(size_t, debug_info->lines);
-    SKARD_FREE_ARRAY(size_t, debug_info->columns);
+    debug_info_free_side(debug_info);
+    SKARD_FREE_ARRAY(uint8_t, debug_info->bytes);
+    SKARD_FREE_ARRAY(DebugCheckpoint, debug_info->checkpoints);
     debug_info_init(debug_info);
 }
 
-void debug_info_add_line(DebugInfo *debug_info, size_t line)
+static void debug_info_write_varint(DebugInfo *debug_info, uint64_t value)
 {
-    if (debug_info->lines_capacity != 0 && debug_info->lines[debug_info->lines_count - 2] == line) {
-        debug_info->lines[debug_info->lines_count - 1]++;
-        return;
+    // A 64-bit varint takes at most 10 bytes
+    if (debug_info->bytes_capacity < debug_info->bytes_count + 10) {
+        debug_info->bytes_capacity = SKARD_GROW_CAPACITY(debug_info->bytes_capacity + 10);
+        debug_info->bytes = SKARD_GROW_ARRAY(uint8_t, debug_info->bytes, debug_info->bytes_capacity);
+    }
+    while (value >= 0x80) {
+        debug_info->bytes[debug_info->bytes_count++] = (uint8_t) (value | 0x80);
+        value >>= 7;
     }
+    debug_info->bytes[debug_info->bytes_count++] = (uint8_t) value;
+}
 
-    if (debug_info->lines_capacity < debug_info->lines_capacity + 2) {
-        debug_info->lines_capacity = SKARD_GROW_CAPACITY(debug_info->lines_capacity);
-        debug_info->lines = SKARD_GROW_ARRAY(size_t, debug_info->lines, debug_info->lines_capacity);
+// Stops at the end of the stream, so corrupted files cannot make a lookup read past it
+static uint64_t debug_info_read_varint(const uint8_t **bytes, const uint8_t *end)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; *bytes < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*bytes)++;
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
     }
-    debug_info->lines[debug_info->lines_count] = line;
-    debug_info->lines[debug_info->lines_count + 1] = 1;
-    debug_info->lines_count += 2;
+    return value;
 }
 
-void debug_info_add_column(DebugInfo *debug_info, size_t column)
+static uint64_t zigzag_encode(size_t delta)
 {
-    if (debug_info->columns_capacity < debug_info->columns_count + 1) {
-        debug_info->columns_capacity = SKARD_GROW_CAPACITY(debug_info->columns_capacity);
-        debug_info->columns = SKARD_GROW_ARRAY(size_t, debug_info->columns, debug_info->columns_capacity);
+    int64_t value = (int64_t) delta;
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static size_t zigzag_decode(uint64_t value)
+{
+    return (size_t) ((value >> 1) ^ (~(value & 1) + 1));
+}
+
+void debug_info_add(DebugInfo *debug_info, size_t line, size_t column, size_t count)
+{
+    if (debug_info->runs_count > 0 && debug_info->last_line == line && debug_info->last_column == column) {
+        debug_info->count += count;
+        return;
+    }
+
+    size_t offset = debug_info->count;
+    debug_info_write_varint(debug_info, offset - debug_info->last_offset);
+    debug_info_write_varint(debug_info, zigzag_encode(line - debug_info->last_line));
+    debug_info_write_varint(debug_info, zigzag_encode(column - debug_info->last_column));
+
+    if (debug_info->runs_count % SKARD_DEBUG_CHECKPOINT_INTERVAL == 0) {
+        if (debug_info->checkpoints_capacity < debug_info->checkpoints_count + 1) {
+            debug_info->checkpoints_capacity = SKARD_GROW_CAPACITY(debug_info->checkpoints_capacity);
+            debug_info->checkpoints = SKARD_GROW_ARRAY(DebugCheckpoint, debug_info->checkpoints,
+                                                       debug_info->checkpoints_capacity);
+        }
+        debug_info->checkpoints[debug_info->checkpoints_count++] = (DebugCheckpoint) {
+            .offset = (uint32_t) offset,
+            .line = (uint32_t) line,
+            .column = (uint32_t) column,
+            .position = (uint32_t) debug_info->bytes_count };
     }
-    debug_info->columns[debug_info->columns_count] = column;
-    debug_info->columns_count++;
+
+    debug_info->last_offset = offset;
+    debug_info->last_line = line;
+    debug_info->last_column = column;
+    debug_info->runs_count++;
+    debug_info->count += count;
 }
 
-void debug_info_add(DebugInfo *debug_info, size_t line, size_t column)
+// Stripped tables are loaded once and published atomically, frozen chunks may be looked up from several threads
+static const DebugInfo *debug_info_tables(DebugInfo *debug_info)
 {
-    debug_info_add_line(debug_info, line);
-    debug_info_add_column(debug_info, column);
+    if (debug_info->side_path == NULL) {
+        return debug_info;
+    }
+
+    DebugInfo *side = __atomic_load_n(&debug_info->side, __ATOMIC_ACQUIRE);
+    if (side != NULL) {
+        return side;
+    }
+
+    side = SKARD_ALLOCATE(DebugInfo);
+    if (!skc_load_debug_file(side, debug_info->side_path, debug_info->side_id)) {
+        free(side);
+        return debug_info;
+    }
+    DebugInfo *expected = NULL;
+    if (!__atomic_compare_exchange_n(&debug_info->side, &expected, side, false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        debug_info_free(side);
+        free(side);
+        return expected;
+    }
+    return side;
 }
 
-size_t debug_info_read_line(DebugInfo *debug_info, size_t offset)
+static void debug_info_find(DebugInfo *debug_info, size_t offset, size_t *line, size_t *column)
 {
-    size_t pos = 0;
-    while (pos * 2 < debug_info->lines_count) {
-        if (offset >= debug_info->lines[pos * 2 + 1]) {
-            offset -= debug_info->lines[pos * 2 + 1];
+    const DebugInfo *tables = debug_info_tables(debug_info);
+    *line = 0;
+    *column = 0;
+    if (offset >= tables->count || tables->checkpoints_count == 0) {
+        return;
+    }
+
+    size_t low = 0;
+    size_t high = tables->checkpoints_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (tables->checkpoints[middle].offset <= offset) {
+            low = middle;
         } else {
-            return debug_info->lines[pos * 2];
+            high = middle;
         }
+    }
 
-        pos++;
+    const DebugCheckpoint *checkpoint = &tables->checkpoints[low];
+    size_t run_offset = checkpoint->offset;
+    size_t run_line = checkpoint->line;
+    size_t run_column = checkpoint->column;
+    const uint8_t *bytes = tables->bytes + checkpoint->position;
+    const uint8_t *end = tables->bytes + tables->bytes_count;
+    while (bytes < end) {
+        size_t next_offset = run_offset + debug_info_read_varint(&bytes, end);
+        if (next_offset > offset) {
+            break;
+        }
+        run_offset = next_offset;
+        run_line += zigzag_decode(debug_info_read_varint(&bytes, end));
+        run_column += zigzag_decode(debug_info_read_varint(&bytes, end));
     }
 
-    return 0;
+    *line = run_line;
+    *column = run_column;
+}
+
+size_t debug_info_read_line(DebugInfo *debug_info, size_t offset)
+{
+    size_t line;
+    size_t column;
+    debug_info_find(debug_info, offset, &line, &column);
+    return line;
 }
 
 size_t debug_info_read_column(DebugInfo *debug_info, size_t offset)
 {
-    return debug_info->columns[offset];
+    size_t line;
+    size_t column;
+    debug_info_find(debug_info, offset, &line, &column);
+    return column;
+}
+
+bool debug_info_is_valid(const DebugInfo *debug_info)
+{
+    if (debug_info->count > 0 && (debug_info->checkpoints_count == 0 || debug_info->checkpoints[0].offset != 0)) {
+        return false;
+    }
+    for (size_t i = 0; i < debug_info->checkpoints_count; i++) {
+        const DebugCheckpoint *checkpoint = &debug_info->checkpoints[i];
+        if (checkpoint->position > debug_info->bytes_count ||
+            (i > 0 && checkpoint->offset <= debug_info->checkpoints[i - 1].offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t debug_info_size(const DebugInfo *debug_info)
+{
+    return debug_info->bytes_capacity + debug_info->checkpoints_capacity * sizeof(DebugCheckpoint);
+}
+
+
+size_t stack_instruction_size(uint8_t op)
+{
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+    switch (op) {
+        case OP_CONSTANT:
+        case OP_CONSTANT_DUMP_INT:
+        case OP_CONSTANT_DUMP_REAL:
+        case OP_ADD_CONSTANT_INT:
+        case OP_ADD_CONSTANT_REAL:
+        case OP_SUBTRACT_CONSTANT_INT:
+        case OP_SUBTRACT_CONSTANT_REAL:
+        case OP_MULTIPLY_CONSTANT_INT:
+        case OP_MULTIPLY_CONSTANT_REAL:
+        case OP_DIVIDE_CONSTANT_REAL:
+        case OP_DIV_CONSTANT_INT:
+            return 2;
+        case OP_CALL_NATIVE:
+            return 3;
+        case OP_CONSTANT_LONG:
+        case OP_GET_FIELD:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+bool stack_instruction_has_constant(uint8_t op)
+{
+    return op != OP_GET_FIELD && op != OP_CALL_NATIVE && stack_instruction_size(op) > 1;
+}
+
+
+static void constant_index_init(ConstantIndex *constants_index)
+{
+    constants_index->capacity = 0;
+    constants_index->slots = NULL;
+}
+
+static void constant_index_free(ConstantIndex *constants_index)
+{
+    SKARD_FREE_ARRAY(uint32_t, constants_index->slots);
+    constant_index_init(constants_index);
+}
+
+// Constants are compared by their bits, kinds come from the instructions so Int 0 and Real 0.0 can share a slot
+static bool constants_equal(Value a, Value b)
+{
+#ifdef SKARD_VALUE_TAGS
+    if (a.type != b.type) {
+        return false;
+    }
+#endif
+    return a.as.sk_int == b.as.sk_int;
+}
+
+static size_t constant_hash(Value constant)
+{
+    uint64_t bits = (uint64_t) constant.as.sk_int;
+#ifdef SKARD_VALUE_TAGS
+    bits ^= (uint64_t) constant.type << 59;
+#endif
+    bits *= 0x9E3779B97F4A7C15u;
+    return (size_t) (bits ^ (bits >> 32));
+}
+
+static void constant_index_insert(ConstantIndex *constants_index, ValueArray *constants, size_t index)
+{
+    size_t mask = constants_index->capacity - 1;
+    size_t i = constant_hash(constants->values[index]) & mask;
+    while (constants_index->slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    constants_index->slots[i] = (uint32_t) (index + 1);
+}
+
+// Keeps the table at most half full, entries are reinserted from the pool itself
+static void constant_index_rebuild(ConstantIndex *constants_index, ValueArray *constants)
+{
+    size_t capacity = constants_index->capacity == 0 ? 16 : constants_index->capacity;
+    while (capacity < 2 * constants->count) {
+        capacity *= 2;
+    }
+
+    SKARD_FREE_ARRAY(uint32_t, constants_index->slots);
+    constants_index->capacity = capacity;
+    constants_index->slots = SKARD_GROW_ARRAY(uint32_t, NULL, capacity);
+    memset(constants_index->slots, 0, capacity * sizeof(uint32_t));
+    for (size_t i = 0; i < constants->count; i++) {
+        constant_index_insert(constants_index, constants, i);
+    }
 }
 
 
 void chunk_init(Chunk *chunk)
 {
+    chunk->format = CHUNK_FORMAT_STACK;
+    chunk->is_verified = false;
+    chunk->is_frozen = false;
+    chunk->max_stack_depth = 0;
+    chunk->registers_count = 0;
+    chunk->natives_count = 0;
+    chunk->entry_count = 0;
+    chunk->is_jit_rejected = false;
+    chunk->jit_code = NULL;
+    chunk->jit_code_size = 0;
+    chunk->mapping = NULL;
+    chunk->mapping_size = 0;
+    chunk->packed = NULL;
+    chunk->packed_size = 0;
     chunk->count = 0;
     chunk->capacity = 0;
     chunk->code = NULL;
     value_array_init(&chunk->constants);
+    constant_index_init(&chunk->constants_index);
     debug_info_init(&chunk->debug_info);
 }
 
 void chunk_free(Chunk *chunk)
 {
-    debug_info_free(&chunk->debug_info);
-    value_array_free(&chunk->constants);
-    SKARD_FREE_ARRAY(uint8_t, chunk->code);
+    jit_release(chunk);
+    constant_index_free(&chunk->constants_index);
+    if (chunk->mapping != NULL) {
+        debug_info_free_side(&chunk->debug_info);
+        skc_unmap(chunk);
+    } else if (chunk->packed != NULL) {
+        debug_info_free_side(&chunk->debug_info);
+        SKARD_FREE_ARRAY(uint8_t, chunk->packed);
+    } else {
+        debug_info_free(&chunk->debug_info);
+        value_array_free(&chunk->constants);
+        SKARD_FREE_ARRAY(uint8_t, chunk->code);
+    }
     chunk_init(chunk);
 }
 
 void chunk_write_byte(Chunk *chunk, uint8_t byte, size_t line, size_t column)
 {
-    if (chunk->capacity < chunk->count + 1) {
-        chunk->capacity = SKARD_GROW_CAPACITY(chunk->capacity);
+    chunk_write_instruction(chunk, &byte, 1, line, column);
+}
+
+void chunk_write_instruction(Chunk *chunk, const uint8_t *bytes, size_t count, size_t line, size_t column)
+{
+    assert(chunk->packed == NULL && chunk->mapping == NULL && "Finalized chunks are read only");
+    if (chunk->capacity < chunk->count + count) {
+        while (chunk->capacity < chunk->count + count) {
+            chunk->capacity = SKARD_GROW_CAPACITY(chunk->capacity);
+        }
         chunk->code = SKARD_GROW_ARRAY(uint8_t, chunk->code, chunk->capacity);
     }
-    chunk->code[chunk->count] = byte;
-    chunk->count++;
-    debug_info_add(&chunk->debug_info, line, column);
+    memcpy(chunk->code + chunk->count, bytes, count);
+    chunk->count += count;
+    debug_info_add(&chunk->debug_info, line, column, count);
 }
 
-static size_t chunk_add_constant(Chunk *chunk, Value constant)
+size_t chunk_add_constant(Chunk *chunk, Value constant)
 {
+    size_t index;
+    if (chunk_find_constant(chunk, constant, &index)) {
+        return index;
+    }
+
     value_array_add(&chunk->constants, constant);
-    return chunk->constants.count - 1;
+    index = chunk->constants.count - 1;
+    if (index >= SKARD_MAX_CHUNK_CONSTANTS) {
+        error_too_many_constants_in_chunk();
+    }
+
+    ConstantIndex *constants_index = &chunk->constants_index;
+    if (constants_index->capacity < 2 * chunk->constants.count) {
+        constant_index_rebuild(constants_index, &chunk->constants);
+    } else {
+        constant_index_insert(constants_index, &chunk->constants, index);
+    }
+    return index;
+}
+
+bool chunk_find_constant(Chunk *chunk, Value constant, size_t *index)
+{
+    ConstantIndex *constants_index = &chunk->constants_index;
+    if (constants_index->capacity == 0) {
+        return false;
+    }
+
+    size_t mask = constants_index->capacity - 1;
+    for (size_t i = constant_hash(constant) & mask; constants_index->slots[i] != 0; i = (i + 1) & mask) {
+        size_t candidate = constants_index->slots[i] - 1;
+        if (constants_equal(chunk->constants.values[candidate], constant)) {
+            *index = candidate;
+            return true;
+        }
+    }
+    return false;
 }
 
 void chunk_write_op_constant(Chunk *chunk, Value constant, size_t line, size_t column)
 {
     size_t index = chunk_add_constant(chunk, constant);
-    if (index >= SKARD_MAX_CHUNK_CONSTANTS) {
-        error_too_many_constants_in_chunk();
-    }
 
     if (index <= UINT8_MAX) {
-        chunk_write_byte(chunk, OP_CONSTANT, line, column);
-        chunk_write_byte(chunk, index, line, column);
+        uint8_t instruction[] = { OP_CONSTANT, index };
+        chunk_write_instruction(chunk, instruction, sizeof(instruction), line, column);
+        return;
+    }
+    uint8_t instruction[] = { OP_CONSTANT_LONG, index & 0xFF, (index >> 8) & 0xFF, (index >> 16) & 0xFF };
+    chunk_write_instruction(chunk, instruction, sizeof(instruction), line, column);
+}
+
+void chunk_write_register_instruction(Chunk *chunk, uint8_t op, uint8_t a, uint8_t b, uint8_t c,
+                                      size_t line, size_t column)
+{
+    uint8_t instruction[SKARD_REGISTER_INSTRUCTION_SIZE] = { op, a, b, c };
+    chunk_write_instruction(chunk, instruction, sizeof(instruction), line, column);
+}
+
+void chunk_write_register_constant(Chunk *chunk, uint8_t a, Value constant, size_t line, size_t column)
+{
+    size_t index = chunk_add_constant(chunk, constant);
+
+    if (index <= SKARD_MAX_REGISTER_CONSTANT_SHORT) {
+        chunk_write_register_instruction(chunk, ROP_CONSTANT, a, index & 0xFF, (index >> 8) & 0xFF, line, column);
+        return;
+    }
+    uint8_t instruction[2 * SKARD_REGISTER_INSTRUCTION_SIZE] = {
+        ROP_CONSTANT_LONG, a, 0, 0, index & 0xFF, (index >> 8) & 0xFF, (index >> 16) & 0xFF, 0 };
+    chunk_write_instruction(chunk, instruction, sizeof(instruction), line, column);
+}
+
+static void copy_bytes(uint8_t *destination, const void *source, size_t size)
+{
+    if (size > 0) {
+        memcpy(destination, source, size);
+    }
+}
+
+void chunk_finalize(Chunk *chunk)
+{
+    if (chunk->packed != NULL || chunk->mapping != NULL) {
+        return;
+    }
+    constant_index_free(&chunk->constants_index);
+
+    // Constants first, the code follows so both are touched within a few cache lines, debug tables are cold
+    DebugInfo *debug_info = &chunk->debug_info;
+    size_t constants_size = chunk->constants.count * sizeof(Value);
+    size_t code_offset = constants_size;
+    size_t locations_offset = code_offset + chunk->count;
+    size_t checkpoints_offset = (locations_offset + debug_info->bytes_count + sizeof(uint64_t) - 1) /
+                                sizeof(uint64_t) * sizeof(uint64_t);
+    size_t size = checkpoints_offset + debug_info->checkpoints_count * sizeof(DebugCheckpoint);
+
+    uint8_t *packed = SKARD_GROW_ARRAY(uint8_t, NULL, size + SKARD_CHUNK_ALIGNMENT - 1);
+    uint8_t *block = (uint8_t *) (((uintptr_t) packed + SKARD_CHUNK_ALIGNMENT - 1) &
+                                  ~(uintptr_t) (SKARD_CHUNK_ALIGNMENT - 1));
+    copy_bytes(block, chunk->constants.values, constants_size);
+    copy_bytes(block + code_offset, chunk->code, chunk->count);
+    copy_bytes(block + locations_offset, debug_info->bytes, debug_info->bytes_count);
+    copy_bytes(block + checkpoints_offset, debug_info->checkpoints,
+               debug_info->checkpoints_count * sizeof(DebugCheckpoint));
+
+    SKARD_FREE_ARRAY(Value, chunk->constants.values);
+    SKARD_FREE_ARRAY(uint8_t, chunk->code);
+    SKARD_FREE_ARRAY(uint8_t, debug_info->bytes);
+    SKARD_FREE_ARRAY(DebugCheckpoint, debug_info->checkpoints);
+
+    // Capacities stay 0 like in mapped chunks, nothing may grow arrays that live in the block
+    chunk->packed = packed;
+    chunk->packed_size = size + SKARD_CHUNK_ALIGNMENT - 1;
+    chunk->constants.values = (Value *) block;
+    chunk->constants.capacity = 0;
+    chunk->code = block + code_offset;
+    chunk->capacity = 0;
+    debug_info->bytes = block + locations_offset;
+    debug_info->bytes_capacity = 0;
+    debug_info->checkpoints = (DebugCheckpoint *) (block + checkpoints_offset);
+    debug_info->checkpoints_capacity = 0;
+}
+
+
+// Takes over the chunk and leaves it empty. Everything vm_run would lazily write (verification and native code) is
+// done here, so running a frozen chunk only reads it. Returns NULL when the chunk fails verification.
+FrozenChunk *chunk_freeze(Chunk *chunk, bool is_jit_compiled)
+{
+    if (!chunk->is_verified && !chunk_verify(chunk)) {
+        return NULL;
+    }
+    if (is_jit_compiled && chunk->jit_code == NULL && !chunk->is_jit_rejected) {
+        jit_compile(chunk);
+    }
+    chunk->is_frozen = true;
+    chunk_finalize(chunk);
+
+    FrozenChunk *frozen = SKARD_ALLOCATE(FrozenChunk);
+    frozen->chunk = *chunk;
+    frozen->references = 1;
+    chunk_init(chunk);
+    return frozen;
+}
+
+FrozenChunk *frozen_chunk_retain(FrozenChunk *frozen)
+{
+    __atomic_add_fetch(&frozen->references, 1, __ATOMIC_RELAXED);
+    return frozen;
+}
+
+void frozen_chunk_release(FrozenChunk *frozen)
+{
+    if (__atomic_sub_fetch(&frozen->references, 1, __ATOMIC_ACQ_REL) != 0) {
         return;
     }
-    chunk_write_byte(chunk, OP_CONSTANT_LONG, line, column);
-    chunk_write_byte(chunk, index & 0xFF, line, column);
-    chunk_write_byte(chunk, (index >> 8) & 0xFF, line, column);
-    chunk_write_byte(chunk, (index >> 16) & 0xFF, line, column);
+
+    chunk_free(&frozen->chunk);
+    free(frozen);
 }
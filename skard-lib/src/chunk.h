@@ -3,47 +3,209 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 
+#include "native.h"
 #include "value.h"
 
 #define SKARD_MAX_CHUNK_CONSTANTS 16777216
+#define SKARD_MAX_STRUCT_SIZE 255
+#define SKARD_CHUNK_ALIGNMENT 64
+#define SKARD_NATIVE_UNUSED 0xFF
 
+#define SKARD_REGISTER_INSTRUCTION_SIZE 4
+#define SKARD_MAX_REGISTERS 128
+#define SKARD_RK_CONSTANT_FLAG 0x80
+#define SKARD_MAX_RK_CONSTANTS 128
+#define SKARD_MAX_REGISTER_CONSTANT_SHORT 65535
+
+// Values are untagged, so every instruction whose result depends on operand kinds is specialized by the compiler.
+// Mixed-kind arithmetic names the kinds of its operands, OP_ADD_INT_REAL promotes its first operand to Real.
 typedef enum {
     OP_RETURN,
-    OP_DUMP,
+    OP_DUMP_INT,
+    OP_DUMP_REAL,
     OP_CONSTANT,
     OP_CONSTANT_LONG,
+    OP_NEGATE_INT,
+    OP_NEGATE_REAL,
+    OP_ADD_INT,
+    OP_ADD_REAL,
+    OP_ADD_INT_REAL,
+    OP_ADD_REAL_INT,
+    OP_SUBTRACT_INT,
+    OP_SUBTRACT_REAL,
+    OP_SUBTRACT_INT_REAL,
+    OP_SUBTRACT_REAL_INT,
+    OP_MULTIPLY_INT,
+    OP_MULTIPLY_REAL,
+    OP_MULTIPLY_INT_REAL,
+    OP_MULTIPLY_REAL_INT,
+    OP_DIVIDE_REAL,
+    OP_DIVIDE_INT_REAL,
+    OP_DIVIDE_REAL_INT,
+    OP_DIVIDE_INT_INT,
+    OP_DIV_INT,
+    OP_GET_FIELD, // struct size, field offset, field size; replaces the struct on top of the stack with its field
+    OP_YIELD_INT, // suspends the run with the value on top of the stack, the host may replace it before resuming
+    OP_YIELD_REAL,
+    OP_CALL_NATIVE, // native index, arity; replaces the arguments on top of the stack with the result
+    OP_CONSTANT_DUMP_INT,
+    OP_CONSTANT_DUMP_REAL,
+    OP_ADD_CONSTANT_INT,
+    OP_ADD_CONSTANT_REAL,
+    OP_SUBTRACT_CONSTANT_INT,
+    OP_SUBTRACT_CONSTANT_REAL,
+    OP_MULTIPLY_CONSTANT_INT,
+    OP_MULTIPLY_CONSTANT_REAL,
+    OP_DIVIDE_CONSTANT_REAL,
+    OP_DIV_CONSTANT_INT,
     COUNT_OPS
 } OpCode;
 
+// Register instructions are fixed-width: [opcode, A, B, C]. Operands B and C of arithmetic instructions are RK
+// operands, they address a constant instead of a register when SKARD_RK_CONSTANT_FLAG is set. Arithmetic is
+// specialized like the stack ops, promotion of Int operands is an explicit ROP_TO_REAL.
+typedef enum {
+    ROP_RETURN, // return
+    ROP_DUMP_INT, // dump R[A]
+    ROP_DUMP_REAL, // dump R[A]
+    ROP_CONSTANT, // R[A] = K[B | C << 8]
+    ROP_CONSTANT_LONG, // R[A] = K[index], index is stored in the following instruction word
+    ROP_NEGATE_INT, // R[A] = -RK[B]
+    ROP_NEGATE_REAL, // R[A] = -RK[B]
+    ROP_ADD_INT, // R[A] = RK[B] + RK[C]
+    ROP_ADD_REAL, // R[A] = RK[B] + RK[C]
+    ROP_SUBTRACT_INT, // R[A] = RK[B] - RK[C]
+    ROP_SUBTRACT_REAL, // R[A] = RK[B] - RK[C]
+    ROP_MULTIPLY_INT, // R[A] = RK[B] * RK[C]
+    ROP_MULTIPLY_REAL, // R[A] = RK[B] * RK[C]
+    ROP_DIVIDE_REAL, // R[A] = RK[B] / RK[C]
+    ROP_DIV_INT, // R[A] = RK[B] | RK[C]
+    ROP_TO_REAL, // R[A] = (Real) RK[B]
+    ROP_MOVE, // R[A] = R[B]
+    ROP_YIELD_INT, // suspend with R[A], the host may replace it before resuming
+    ROP_YIELD_REAL, // suspend with R[A], the host may replace it before resuming
+    ROP_CALL_NATIVE, // R[A] = native C (R[A], ..., R[A + B - 1])
+    COUNT_ROPS
+} RegisterOpCode;
+
+typedef enum {
+    CHUNK_FORMAT_STACK,
+    CHUNK_FORMAT_REGISTER,
+    COUNT_CHUNK_FORMATS,
+} ChunkFormat;
+
+#define SKARD_DEBUG_CHECKPOINT_INTERVAL 16
+
+// Absolute location of every SKARD_DEBUG_CHECKPOINT_INTERVAL-th run, position is where the following run starts in
+// the encoded stream. Fixed width so the table can be mapped from files.
 typedef struct {
-    size_t lines_count;
-    size_t lines_capacity;
-    size_t *lines;
-    size_t columns_count;
-    size_t columns_capacity;
-    size_t *columns;
+    uint32_t offset;
+    uint32_t line;
+    uint32_t column;
+    uint32_t position;
+} DebugCheckpoint;
+
+// Source locations of code bytes, stored as runs of bytes that share a line and column. Each run is three varints
+// in the stream: the code offset delta from the previous run and the zigzag encoded line and column deltas. Lookups
+// binary search the checkpoints and decode at most one interval of runs.
+typedef struct DebugInfo {
+    // Code bytes covered
+    size_t count;
+    size_t runs_count;
+    size_t last_offset;
+    size_t last_line;
+    size_t last_column;
+    size_t bytes_count;
+    size_t bytes_capacity;
+    uint8_t *bytes;
+    size_t checkpoints_count;
+    size_t checkpoints_capacity;
+    DebugCheckpoint *checkpoints;
+    // Set for chunks whose debug info was stripped into a side file, it is loaded on the first lookup
+    char *side_path;
+    uint64_t side_id;
+    struct DebugInfo *side;
 } DebugInfo;
 
+size_t stack_instruction_size(uint8_t op);
+bool stack_instruction_has_constant(uint8_t op);
+
 void debug_info_init(DebugInfo *debug_info);
 void debug_info_free(DebugInfo *debug_info);
-void debug_info_add_line(DebugInfo *debug_info, size_t line);
-void debug_info_add_column(DebugInfo *debug_info, size_t column);
-void debug_info_add(DebugInfo *debug_info, size_t line, size_t column);
+// The next count code bytes share the location
+void debug_info_add(DebugInfo *debug_info, size_t line, size_t column, size_t count);
+// Both return 0 for offsets without a location, including when a side file cannot be loaded
 size_t debug_info_read_line(DebugInfo *debug_info, size_t offset);
 size_t debug_info_read_column(DebugInfo *debug_info, size_t offset);
+// Checks tables read from a file before they are decoded
+bool debug_info_is_valid(const DebugInfo *debug_info);
+// Heap footprint of the tables
+size_t debug_info_size(const DebugInfo *debug_info);
+
+// Open addressing table over the constant pool so equal constants share one slot. Slots hold a pool index plus one,
+// zero marks an empty slot. It only exists while the chunk is being written.
+typedef struct {
+    size_t capacity;
+    uint32_t *slots;
+} ConstantIndex;
 
 typedef struct {
+    ChunkFormat format;
+    bool is_verified;
+    // Set by chunk_freeze, frozen chunks are never written to again
+    bool is_frozen;
+    size_t max_stack_depth;
+    size_t registers_count;
+    // One past the highest native index the chunk calls, set by the verifier
+    size_t natives_count;
+    // Argument count of every call to each native below natives_count, SKARD_NATIVE_UNUSED where none is called
+    uint8_t native_arities[SKARD_MAX_NATIVES];
+    // Tiered execution state, managed by jit.c
+    size_t entry_count;
+    bool is_jit_rejected;
+    void *jit_code;
+    size_t jit_code_size;
+    // Set when code, constants and debug info live in a file mapped by skc_map_file
+    void *mapping;
+    size_t mapping_size;
+    // Set by chunk_finalize, the single block code, constants and debug tables were packed into
+    void *packed;
+    size_t packed_size;
     size_t count;
     size_t capacity;
     uint8_t *code;
     ValueArray constants;
+    ConstantIndex constants_index;
     DebugInfo debug_info;
 } Chunk;
 
 void chunk_init(Chunk *chunk);
 void chunk_free(Chunk *chunk);
 void chunk_write_byte(Chunk *chunk, uint8_t byte, size_t line, size_t column);
+// Writes a whole instruction with a single location entry
+void chunk_write_instruction(Chunk *chunk, const uint8_t *bytes, size_t count, size_t line, size_t column);
+// Returns the slot of an equal constant when the pool already has one
+size_t chunk_add_constant(Chunk *chunk, Value constant);
+bool chunk_find_constant(Chunk *chunk, Value constant, size_t *index);
 void chunk_write_op_constant(Chunk *chunk, Value constant, size_t line, size_t column);
+void chunk_write_register_instruction(Chunk *chunk, uint8_t op, uint8_t a, uint8_t b, uint8_t c,
+                                      size_t line, size_t column);
+void chunk_write_register_constant(Chunk *chunk, uint8_t a, Value constant, size_t line, size_t column);
+
+// Packs code, constants and debug tables into one cache line aligned block without growth slack. The chunk is read
+// only afterwards, like a mapped one. Compilation and chunk_freeze finalize their chunks.
+void chunk_finalize(Chunk *chunk);
+
+// Immutable compiled chunk that any number of VMs, on any threads, can run at the same time
+typedef struct {
+    Chunk chunk;
+    size_t references;
+} FrozenChunk;
+
+FrozenChunk *chunk_freeze(Chunk *chunk, bool is_jit_compiled);
+FrozenChunk *frozen_chunk_retain(FrozenChunk *frozen);
+void frozen_chunk_release(FrozenChunk *frozen);
 
 #endif //SKARD_CHUNK_H
@@ -0,0 +1,240 @@
+#include "chunk_cache.h"
+
+#include <string.h>
+
+#include "utils.h"
+
+#define SKARD_CHUNK_CACHE_MIN_BUCKETS 16
+
+void chunk_cache_init(ChunkCache *cache, size_t memory_cap)
+{
+    cache->memory_cap = memory_cap;
+    cache->memory_used = 0;
+    cache->is_jit_compiled = false;
+    cache->entries_count = 0;
+    cache->buckets_count = 0;
+    cache->buckets = NULL;
+    cache->most_recent = NULL;
+    cache->least_recent = NULL;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+}
+
+static void chunk_cache_entry_free(ChunkCacheEntry *entry)
+{
+    frozen_chunk_release(entry->frozen);
+    SKARD_FREE_ARRAY(char, entry->source);
+    free(entry);
+}
+
+void chunk_cache_clear(ChunkCache *cache)
+{
+    ChunkCacheEntry *entry = cache->most_recent;
+    while (entry != NULL) {
+        ChunkCacheEntry *next = entry->lru_next;
+        chunk_cache_entry_free(entry);
+        entry = next;
+    }
+
+    for (size_t i = 0; i < cache->buckets_count; i++) {
+        cache->buckets[i] = NULL;
+    }
+    cache->memory_used = 0;
+    cache->entries_count = 0;
+    cache->most_recent = NULL;
+    cache->least_recent = NULL;
+}
+
+void chunk_cache_free(ChunkCache *cache)
+{
+    chunk_cache_clear(cache);
+    cache->buckets = SKARD_FREE_ARRAY(ChunkCacheEntry *, cache->buckets);
+    cache->buckets_count = 0;
+}
+
+static uint64_t chunk_cache_hash(const char *source, size_t source_length, const CompilerOptions *options)
+{
+    uint64_t hash = hash_bytes(source, source_length, SKARD_HASH_SEED);
+    uint8_t layout[2] = { (uint8_t) options->format, (uint8_t) options->mode };
+    hash = hash_bytes(layout, sizeof(layout), hash);
+    if (options->fusions != NULL) {
+        hash = hash_bytes(options->fusions->enabled, sizeof(options->fusions->enabled), hash);
+    }
+    return hash;
+}
+
+static bool chunk_cache_entry_matches(ChunkCacheEntry *entry, uint64_t hash, const char *source, size_t source_length,
+                                      const CompilerOptions *options)
+{
+    if (entry->hash != hash || entry->source_length != source_length || entry->format != options->format ||
+        entry->mode != options->mode) {
+        return false;
+    }
+    if (entry->has_fusions != (options->fusions != NULL) || entry->natives != options->natives) {
+        return false;
+    }
+    if (entry->has_fusions &&
+        memcmp(entry->fusions.enabled, options->fusions->enabled, sizeof(entry->fusions.enabled)) != 0) {
+        return false;
+    }
+    return memcmp(entry->source, source, source_length) == 0;
+}
+
+// Finalized and mapped chunks keep code, constants and debug info in one block and leave their capacities at 0
+static size_t chunk_cache_chunk_size(Chunk *chunk)
+{
+    if (chunk->packed != NULL) {
+        return chunk->packed_size;
+    }
+    if (chunk->mapping != NULL) {
+        return chunk->mapping_size;
+    }
+    return chunk->capacity + chunk->constants.capacity * sizeof(Value) + debug_info_size(&chunk->debug_info);
+}
+
+// Rough heap footprint of a frozen chunk and its key
+static size_t chunk_cache_entry_size(ChunkCacheEntry *entry)
+{
+    Chunk *chunk = &entry->frozen->chunk;
+    return sizeof(ChunkCacheEntry) + entry->source_length + sizeof(FrozenChunk) + chunk_cache_chunk_size(chunk) +
+           chunk->jit_code_size;
+}
+
+static void chunk_cache_unlink(ChunkCache *cache, ChunkCacheEntry *entry)
+{
+    if (entry->lru_previous != NULL) {
+        entry->lru_previous->lru_next = entry->lru_next;
+    } else {
+        cache->most_recent = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_previous = entry->lru_previous;
+    } else {
+        cache->least_recent = entry->lru_previous;
+    }
+    entry->lru_previous = NULL;
+    entry->lru_next = NULL;
+}
+
+static void chunk_cache_link_front(ChunkCache *cache, ChunkCacheEntry *entry)
+{
+    entry->lru_previous = NULL;
+    entry->lru_next = cache->most_recent;
+    if (cache->most_recent != NULL) {
+        cache->most_recent->lru_previous = entry;
+    } else {
+        cache->least_recent = entry;
+    }
+    cache->most_recent = entry;
+}
+
+static void chunk_cache_remove(ChunkCache *cache, ChunkCacheEntry *entry)
+{
+    ChunkCacheEntry **slot = &cache->buckets[entry->hash & (cache->buckets_count - 1)];
+    while (*slot != entry) {
+        slot = &(*slot)->bucket_next;
+    }
+    *slot = entry->bucket_next;
+
+    chunk_cache_unlink(cache, entry);
+    cache->memory_used -= entry->size;
+    cache->entries_count--;
+    chunk_cache_entry_free(entry);
+}
+
+static void chunk_cache_grow(ChunkCache *cache)
+{
+    size_t buckets_count = cache->buckets_count < SKARD_CHUNK_CACHE_MIN_BUCKETS
+                           ? SKARD_CHUNK_CACHE_MIN_BUCKETS
+                           : cache->buckets_count * 2;
+    ChunkCacheEntry **buckets = SKARD_GROW_ARRAY(ChunkCacheEntry *, NULL, buckets_count);
+    for (size_t i = 0; i < buckets_count; i++) {
+        buckets[i] = NULL;
+    }
+
+    for (ChunkCacheEntry *entry = cache->most_recent; entry != NULL; entry = entry->lru_next) {
+        ChunkCacheEntry **slot = &buckets[entry->hash & (buckets_count - 1)];
+        entry->bucket_next = *slot;
+        *slot = entry;
+    }
+
+    SKARD_FREE_ARRAY(ChunkCacheEntry *, cache->buckets);
+    cache->buckets = buckets;
+    cache->buckets_count = buckets_count;
+}
+
+static void chunk_cache_insert(ChunkCache *cache, uint64_t hash, const char *source, size_t source_length,
+                               const CompilerOptions *options, FrozenChunk *frozen)
+{
+    if ((cache->entries_count + 1) * 4 > cache->buckets_count * 3) {
+        chunk_cache_grow(cache);
+    }
+
+    ChunkCacheEntry *entry = SKARD_ALLOCATE(ChunkCacheEntry);
+    entry->hash = hash;
+    entry->source = SKARD_GROW_ARRAY(char, NULL, source_length + 1);
+    memcpy(entry->source, source, source_length + 1);
+    entry->source_length = source_length;
+    entry->format = options->format;
+    entry->mode = options->mode;
+    entry->natives = options->natives;
+    entry->has_fusions = options->fusions != NULL;
+    if (entry->has_fusions) {
+        entry->fusions = *options->fusions;
+    } else {
+        fusion_set_init(&entry->fusions);
+    }
+    entry->frozen = frozen;
+    entry->size = chunk_cache_entry_size(entry);
+
+    ChunkCacheEntry **slot = &cache->buckets[hash & (cache->buckets_count - 1)];
+    entry->bucket_next = *slot;
+    *slot = entry;
+    chunk_cache_link_front(cache, entry);
+    cache->memory_used += entry->size;
+    cache->entries_count++;
+}
+
+FrozenChunk *chunk_cache_compile(ChunkCache *cache, Compiler *compiler, const char *source)
+{
+    size_t source_length = strlen(source);
+    uint64_t hash = chunk_cache_hash(source, source_length, &compiler->options);
+
+    if (cache->buckets_count > 0) {
+        ChunkCacheEntry *entry = cache->buckets[hash & (cache->buckets_count - 1)];
+        while (entry != NULL && !chunk_cache_entry_matches(entry, hash, source, source_length, &compiler->options)) {
+            entry = entry->bucket_next;
+        }
+
+        if (entry != NULL) {
+            cache->hits++;
+            chunk_cache_unlink(cache, entry);
+            chunk_cache_link_front(cache, entry);
+            return frozen_chunk_retain(entry->frozen);
+        }
+    }
+    cache->misses++;
+
+    Chunk chunk;
+    if (!compiler_compile_source(compiler, source, &chunk)) {
+        chunk_free(&chunk);
+        return NULL;
+    }
+    FrozenChunk *frozen = chunk_freeze(&chunk, cache->is_jit_compiled);
+    if (frozen == NULL) {
+        chunk_free(&chunk);
+        return NULL;
+    }
+
+    chunk_cache_insert(cache, hash, source, source_length, &compiler->options, frozen);
+    frozen_chunk_retain(frozen);
+
+    // Entries larger than the whole cap are handed out but not kept
+    while (cache->memory_used > cache->memory_cap && cache->least_recent != NULL) {
+        cache->evictions++;
+        chunk_cache_remove(cache, cache->least_recent);
+    }
+
+    return frozen;
+}
@@ -0,0 +1,55 @@
+#ifndef SKARD_CHUNK_CACHE_H
+#define SKARD_CHUNK_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chunk.h"
+#include "compiler.h"
+#include "optimizer.h"
+
+#define SKARD_CHUNK_CACHE_DEFAULT_MEMORY_CAP (64u * 1024u * 1024u)
+
+// Keyed by the source text and the compiler options it was compiled with
+typedef struct ChunkCacheEntry {
+    uint64_t hash;
+    char *source;
+    size_t source_length;
+    ChunkFormat format;
+    // Single-pass chunks neither fold constants nor catch every division by zero at compile time
+    CompileMode mode;
+    bool has_fusions;
+    FusionSet fusions;
+    // Chunks index into the registry, a different registry needs its own entry even for the same source
+    const NativeRegistry *natives;
+    FrozenChunk *frozen;
+    size_t size;
+    struct ChunkCacheEntry *bucket_next;
+    struct ChunkCacheEntry *lru_previous;
+    struct ChunkCacheEntry *lru_next;
+} ChunkCacheEntry;
+
+// Frozen chunks by source, the least recently used ones are evicted once their estimated memory exceeds the cap.
+// The cache itself is not synchronized, threads sharing one have to lock around chunk_cache_compile.
+typedef struct {
+    size_t memory_cap;
+    size_t memory_used;
+    bool is_jit_compiled;
+    size_t entries_count;
+    size_t buckets_count;
+    ChunkCacheEntry **buckets;
+    ChunkCacheEntry *most_recent;
+    ChunkCacheEntry *least_recent;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} ChunkCache;
+
+void chunk_cache_init(ChunkCache *cache, size_t memory_cap);
+void chunk_cache_free(ChunkCache *cache);
+void chunk_cache_clear(ChunkCache *cache);
+
+// Returns a retained chunk the caller releases with frozen_chunk_release, or NULL when the source does not compile
+FrozenChunk *chunk_cache_compile(ChunkCache *cache, Compiler *compiler, const char *source);
+
+#endif //SKARD_CHUNK_CACHE_H
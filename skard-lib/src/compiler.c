@@ -2,8 +2,12 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 #include "utils.h"
+#include "debug.h"
+#include "verifier.h"
+#include "arithmetic.h"
 
 
 const char *ast_operator_translate(ASTOperator operator)
@@ -28,53 +32,65 @@ const char *ast_operator_translate(ASTOperator operator)
 }
 
 
-static void ast_node_expression_free(ASTNodeExpression *node);
+// Positions in the extra list of a node
+enum {
+    AST_STRUCT_LAYOUT = 0,
+    AST_STRUCT_FIELDS = 1,
+    AST_FIELD_NAME = 0,
+    AST_FIELD_OFFSET = 1,
+    AST_CALL_NAME = 0,
+    AST_CALL_NATIVE = 1,
+    AST_CALL_ARGUMENTS = 2,
+};
 
-static void ast_node_expression_free(ASTNodeExpression *node)
+static void ast_init(AST *ast)
 {
-    assert((COUNT_AST_EXPRS == 4) && "Exhaustive expression kinds handling");
-    switch (node->kind) {
-        case AST_EXPR_VALUE:
-            break;
-        case AST_EXPR_UNARY:
-            ast_node_free((ASTNode *) node->as.node_unary.child);
-            break;
-        case AST_EXPR_BINARY:
-            ast_node_free((ASTNode *) node->as.node_binary.first);
-            ast_node_free((ASTNode *) node->as.node_binary.second);
-            break;
-        case AST_EXPR_GROUPING:
-            ast_node_free((ASTNode *) node->as.node_grouping.child);
-            break;
-        default:
-            break; // Unreachable
-    }
+    *ast = (AST) { .count = 0 };
 }
 
+static void ast_free(AST *ast)
+{
+    SKARD_FREE_ARRAY(uint8_t, ast->kinds);
+    SKARD_FREE_ARRAY(uint8_t, ast->operators);
+    SKARD_FREE_ARRAY(SkardType, ast->types);
+    SKARD_FREE_ARRAY(ASTIndex, ast->firsts);
+    SKARD_FREE_ARRAY(ASTIndex, ast->seconds);
+    SKARD_FREE_ARRAY(ASTSpan, ast->spans);
+    SKARD_FREE_ARRAY(Value, ast->values);
+    SKARD_FREE_ARRAY(Token, ast->names);
+    SKARD_FREE_ARRAY(uint32_t, ast->extra);
+    SKARD_FREE_ARRAY(uint32_t, ast->scratch);
+    SKARD_FREE_ARRAY(StructLayout *, ast->layouts);
+    ast_init(ast);
+}
 
-void ast_node_free(ASTNode *node)
+// Columns are only emptied, the layouts go away with the arena once their fields are freed
+static void compiler_release_ast(Compiler *compiler)
 {
-    assert((COUNT_AST_NODES == 1) && "Exhaustive node kinds handling");
-    switch (node->kind) {
-        case AST_NODE_EXPRESSION:
-            ast_node_expression_free(&node->as.node_expression);
-            break;
-        default:
-            break; // Unreachable
+    AST *ast = &compiler->ast;
+    for (size_t i = 0; i < ast->layouts_count; i++) {
+        struct_layout_free(ast->layouts[i]);
     }
-
-    free(node);
+    ast->count = 0;
+    ast->values_count = 0;
+    ast->names_count = 0;
+    ast->extra_count = 0;
+    ast->scratch_count = 0;
+    ast->layouts_count = 0;
+    arena_reset(&compiler->arena);
 }
 
 
 static void ast_print_invalid(void);
 
-static void ast_expression_value_print(ASTExpressionValue *value);
-static void ast_expression_unary_print(ASTExpressionUnary *unary);
-static void ast_expression_binary_print(ASTExpressionBinary *binary);
-static void ast_expression_grouping_print(ASTExpressionGrouping *grouping);
-
-static void ast_node_expression_print(ASTNodeExpression *expression);
+static void ast_expression_value_print(AST *ast, ASTIndex node);
+static void ast_expression_unary_print(AST *ast, ASTIndex node);
+static void ast_expression_binary_print(AST *ast, ASTIndex node);
+static void ast_expression_grouping_print(AST *ast, ASTIndex node);
+static void ast_expression_struct_print(AST *ast, ASTIndex node);
+static void ast_expression_field_print(AST *ast, ASTIndex node);
+static void ast_expression_yield_print(AST *ast, ASTIndex node);
+static void ast_expression_call_print(AST *ast, ASTIndex node);
 
 
 static void ast_print_invalid(void)
@@ -83,15 +99,15 @@ static void ast_print_invalid(void)
 }
 
 
-static void ast_expression_value_print(ASTExpressionValue *value)
+static void ast_expression_value_print(AST *ast, ASTIndex node)
 {
-    print_value(value->value);
+    print_value_of_kind(ast->values[ast->firsts[node]], ast->types[node].kind);
 }
 
-static void ast_expression_unary_print(ASTExpressionUnary *unary)
+static void ast_expression_unary_print(AST *ast, ASTIndex node)
 {
     assert((COUNT_OTORS == 5) && "Exhaustive operators handling");
-    switch (unary->operator) {
+    switch (ast->operators[node]) {
         case OTOR_MINUS:
             printf("-");
             break;
@@ -104,13 +120,13 @@ static void ast_expression_unary_print(ASTExpressionUnary *unary)
     }
 
     printf(" ");
-    ast_node_print((ASTNode *) unary->child, false);
+    ast_node_print(ast, ast->firsts[node], false);
 }
 
-static void ast_expression_binary_print(ASTExpressionBinary *binary)
+static void ast_expression_binary_print(AST *ast, ASTIndex node)
 {
     assert((COUNT_OTORS == 5) && "Exhaustive operators handling");
-    switch (binary->operator) {
+    switch (ast->operators[node]) {
         case OTOR_PLUS:
             printf("+");
             break;
@@ -132,50 +148,83 @@ static void ast_expression_binary_print(ASTExpressionBinary *binary)
     }
 
     printf(" ");
-    ast_node_print((ASTNode *) binary->first, false);
-    ast_node_print((ASTNode *) binary->second, false);
+    ast_node_print(ast, ast->firsts[node], false);
+    ast_node_print(ast, ast->seconds[node], false);
 }
 
-static void ast_expression_grouping_print(ASTExpressionGrouping *grouping)
+static void ast_expression_grouping_print(AST *ast, ASTIndex node)
 {
     printf("(_) ");
-    ast_node_print((ASTNode *) grouping->child, false);
+    ast_node_print(ast, ast->firsts[node], false);
+}
+
+static void ast_expression_struct_print(AST *ast, ASTIndex node)
+{
+    printf("struct");
+    size_t fields = ast->firsts[node] + AST_STRUCT_FIELDS;
+    for (size_t i = 0; i < ast->seconds[node]; i++) {
+        Token *name = &ast->names[ast->extra[fields + 2 * i]];
+        printf(" %.*s = ", (int) name->length, name->start);
+        ast_node_print(ast, ast->extra[fields + 2 * i + 1], false);
+    }
+}
+
+static void ast_expression_field_print(AST *ast, ASTIndex node)
+{
+    Token *name = &ast->names[ast->extra[ast->seconds[node] + AST_FIELD_NAME]];
+    printf(".%.*s ", (int) name->length, name->start);
+    ast_node_print(ast, ast->firsts[node], false);
+}
+
+static void ast_expression_yield_print(AST *ast, ASTIndex node)
+{
+    printf("yield ");
+    ast_node_print(ast, ast->firsts[node], false);
+}
+
+static void ast_expression_call_print(AST *ast, ASTIndex node)
+{
+    size_t call = ast->firsts[node];
+    Token *name = &ast->names[ast->extra[call + AST_CALL_NAME]];
+    printf("%.*s()", (int) name->length, name->start);
+    for (size_t i = 0; i < ast->seconds[node]; i++) {
+        printf(" ");
+        ast_node_print(ast, ast->extra[call + AST_CALL_ARGUMENTS + i], false);
+    }
 }
 
 
-static void ast_node_expression_print(ASTNodeExpression *expression)
+void ast_node_print(AST *ast, ASTIndex node, bool end_line)
 {
-    skard_type_print(&expression->type);
+    printf("(");
+    skard_type_print(&ast->types[node]);
     printf(" ");
 
-    assert((COUNT_AST_EXPRS == 4) && "Exhaustive expression kinds handling");
-    switch (expression->kind) {
+    assert((COUNT_AST_EXPRS == 8) && "Exhaustive expression kinds handling");
+    switch (ast->kinds[node]) {
         case AST_EXPR_VALUE:
-            ast_expression_value_print(&expression->as.node_value);
+            ast_expression_value_print(ast, node);
             break;
         case AST_EXPR_UNARY:
-            ast_expression_unary_print(&expression->as.node_unary);
+            ast_expression_unary_print(ast, node);
             break;
         case AST_EXPR_BINARY:
-            ast_expression_binary_print(&expression->as.node_binary);
+            ast_expression_binary_print(ast, node);
             break;
         case AST_EXPR_GROUPING:
-            ast_expression_grouping_print(&expression->as.node_grouping);
+            ast_expression_grouping_print(ast, node);
             break;
-        default:
-            break; // Unreachable
-    }
-}
-
-
-void ast_node_print(ASTNode *node, bool end_line)
-{
-    printf("(");
-
-    assert((COUNT_AST_NODES == 1) && "Exhaustive node kinds handling");
-    switch (node->kind) {
-        case AST_NODE_EXPRESSION:
-            ast_node_expression_print(&node->as.node_expression);
+        case AST_EXPR_STRUCT:
+            ast_expression_struct_print(ast, node);
+            break;
+        case AST_EXPR_FIELD:
+            ast_expression_field_print(ast, node);
+            break;
+        case AST_EXPR_YIELD:
+            ast_expression_yield_print(ast, node);
+            break;
+        case AST_EXPR_CALL:
+            ast_expression_call_print(ast, node);
             break;
         default:
             break; // Unreachable
@@ -188,11 +237,34 @@ void ast_node_print(ASTNode *node, bool end_line)
 }
 
 
+static bool compiler_generate_single_pass(Compiler *compiler);
+
+
 void compiler_init(Compiler *compiler)
 {
-    compiler->lexer = NULL;
+    compiler->options.mode = COMPILE_MODE_AST;
+    compiler->options.format = CHUNK_FORMAT_STACK;
+    compiler->options.fusions = NULL;
+    compiler->options.natives = NULL;
+    lexer_init(&compiler->lexer, "");
+    compiler->chunk = NULL;
+    compiler->registers_count = 0;
     compiler->is_error = false;
     compiler->is_panic = false;
+    ast_init(&compiler->ast);
+    arena_init(&compiler->arena);
+    compiler->operands_count = 0;
+    compiler->operands_capacity = 0;
+    compiler->operands = NULL;
+}
+
+void compiler_free(Compiler *compiler)
+{
+    compiler_release_ast(compiler);
+    ast_free(&compiler->ast);
+    arena_free(&compiler->arena);
+    compiler->operands = SKARD_FREE_ARRAY(TypedOperand, compiler->operands);
+    compiler->operands_capacity = 0;
 }
 
 
@@ -207,25 +279,57 @@ bool compiler_compile_file(Compiler *compiler, const char *filename, Chunk *chun
 
 bool compiler_compile_source(Compiler *compiler, const char *source, Chunk *chunk)
 {
-    (void) compiler;
-    (void) chunk;
-
-    Lexer lexer;
-    compiler->lexer = &lexer;
-    lexer_init(compiler->lexer, source);
-    lexer_print(compiler->lexer);
+    compiler->is_error = false;
+    compiler->is_panic = false;
+    chunk_init(chunk);
+
+    lexer_init(&compiler->lexer, source);
+#ifdef SKARD_DEBUG
+    lexer_print(&compiler->lexer);
+    lexer_reset(&compiler->lexer);
+#endif
+
+    bool result;
+    if (compiler->options.mode == COMPILE_MODE_SINGLE_PASS && compiler->options.format == CHUNK_FORMAT_STACK) {
+        compiler->chunk = chunk;
+        result = compiler_generate_single_pass(compiler);
+    } else {
+        ASTIndex root = compiler_generate_ast(compiler);
+        compiler->chunk = chunk;
+        result = root != SKARD_AST_NONE && compiler_generate_bytecode(compiler, root);
+    }
+    compiler_release_ast(compiler);
+    if (result) {
+        chunk_finalize(chunk);
+    }
 
-    lexer_reset(compiler->lexer);
-    compiler_generate_ast(compiler);
+#ifdef SKARD_DEBUG
+    if (result) {
+        disassemble_chunk(chunk, "COMPILED");
+    }
+#endif
 
-    return false;
+    compiler->chunk = NULL;
+    return result;
 }
 
-static ASTNode *make_ast_node_expression(ASTNodeExpression node_expression);
-static ASTNode *make_ast_node_value(Value value, SkardType type);
-static ASTNode *make_ast_node_unary(ASTNode *child, ASTOperator operator);
-static ASTNode *make_ast_node_binary(ASTNode *first, ASTNode *second, ASTOperator operator);
-static ASTNode *make_ast_node_grouping(ASTNode *child);
+static ASTIndex make_ast_node_expression(Compiler *compiler, ASTExpressionKind kind, ASTOperator operator,
+                                         SkardType type, ASTIndex first, ASTIndex second, Token *token);
+static ASTIndex make_ast_node_value(Compiler *compiler, Value value, SkardType type, Token *token);
+static ASTIndex make_ast_node_unary(Compiler *compiler, ASTIndex child, ASTOperator operator, Token *token);
+static ASTIndex make_ast_node_binary(Compiler *compiler, ASTIndex first, ASTIndex second, ASTOperator operator,
+                                     Token *token);
+static ASTIndex make_ast_node_grouping(Compiler *compiler, ASTIndex child, Token *token);
+static ASTIndex make_ast_node_struct(Compiler *compiler, size_t fields_start, Token *token);
+static ASTIndex make_ast_node_field(Compiler *compiler, ASTIndex object, Token name, Token *token);
+static ASTIndex make_ast_node_yield(Compiler *compiler, ASTIndex child, Token *token);
+static ASTIndex make_ast_node_call(Compiler *compiler, Token name, size_t arguments_start, Token *token);
+
+static uint32_t ast_add_value(AST *ast, Value value);
+static uint32_t ast_add_layout(Compiler *compiler);
+static uint32_t ast_add_name(AST *ast, Token name);
+static void ast_push_scratch(AST *ast, uint32_t item);
+static uint32_t ast_move_list(AST *ast, size_t scratch_start, const uint32_t *header, size_t header_count);
 
 static void compiler_parse_error_at_current(Compiler *compiler, const char *message);
 static void compiler_parse_error_at_previous(Compiler *compiler, const char *message);
@@ -233,68 +337,178 @@ static void compiler_parse_error(Compiler *compiler, Token *token, const char *m
 static void compiler_advance(Compiler *compiler);
 static void compiler_consume(Compiler *compiler, TokenType type, const char *message);
 
-static ParseRule *get_parse_rule(TokenType type);
+static const ParseRule *get_parse_rule(TokenType type);
+static ASTOperator get_unary_operator(TokenType type);
+static ASTOperator get_binary_operator(TokenType type);
+
+static ASTIndex compiler_parse_precedence(Compiler *compiler, Precedence precedence);
+static ASTIndex compiler_parse_expression(Compiler *compiler);
+static ASTIndex compiler_parse_grouping(Compiler *compiler);
+static ASTIndex compiler_parse_binary(Compiler *compiler, ASTIndex first);
+static ASTIndex compiler_parse_unary(Compiler *compiler);
+static ASTIndex compiler_parse_struct(Compiler *compiler);
+static ASTIndex compiler_parse_field(Compiler *compiler, ASTIndex object);
+static ASTIndex compiler_parse_yield(Compiler *compiler);
+static ASTIndex compiler_parse_call(Compiler *compiler);
+static ASTIndex compiler_parse_real(Compiler *compiler);
+static ASTIndex compiler_parse_int(Compiler *compiler);
+
+
+// Appends a row to every column, nodes are made once their children are parsed
+static ASTIndex make_ast_node_expression(Compiler *compiler, ASTExpressionKind kind, ASTOperator operator,
+                                         SkardType type, ASTIndex first, ASTIndex second, Token *token)
+{
+    AST *ast = &compiler->ast;
+    if (ast->count == SKARD_AST_MAX_NODES) {
+        compiler_parse_error(compiler, token, "Expression has too many nodes.");
+        return SKARD_AST_NONE;
+    }
+
+    if (ast->capacity < ast->count + 1) {
+        ast->capacity = SKARD_GROW_CAPACITY(ast->capacity);
+        ast->kinds = SKARD_GROW_ARRAY(uint8_t, ast->kinds, ast->capacity);
+        ast->operators = SKARD_GROW_ARRAY(uint8_t, ast->operators, ast->capacity);
+        ast->types = SKARD_GROW_ARRAY(SkardType, ast->types, ast->capacity);
+        ast->firsts = SKARD_GROW_ARRAY(ASTIndex, ast->firsts, ast->capacity);
+        ast->seconds = SKARD_GROW_ARRAY(ASTIndex, ast->seconds, ast->capacity);
+        ast->spans = SKARD_GROW_ARRAY(ASTSpan, ast->spans, ast->capacity);
+    }
+
+    ASTIndex node = (ASTIndex) ast->count++;
+    ast->kinds[node] = (uint8_t) kind;
+    ast->operators[node] = (uint8_t) operator;
+    ast->types[node] = type;
+    ast->firsts[node] = first;
+    ast->seconds[node] = second;
+    ast->spans[node] = (ASTSpan) { .line = (uint32_t) token->line, .column = (uint32_t) token->column };
+    return node;
+}
 
-static ASTNode *compiler_parse_precedence(Compiler *compiler, Precedence precedence);
-static ASTNode *compiler_parse_expression(Compiler *compiler);
-static ASTNode *compiler_parse_grouping(Compiler *compiler);
-static ASTNode *compiler_parse_binary(Compiler *compiler, ASTNode *first);
-static ASTNode *compiler_parse_unary(Compiler *compiler);
-static ASTNode *compiler_parse_real(Compiler *compiler);
-static ASTNode *compiler_parse_int(Compiler *compiler);
+static ASTIndex make_ast_node_value(Compiler *compiler, Value value, SkardType type, Token *token)
+{
+    return make_ast_node_expression(compiler, AST_EXPR_VALUE, OTOR_PLUS, type, ast_add_value(&compiler->ast, value),
+                                    SKARD_AST_NONE, token);
+}
 
+static ASTIndex make_ast_node_unary(Compiler *compiler, ASTIndex child, ASTOperator operator, Token *token)
+{
+    return make_ast_node_expression(compiler, AST_EXPR_UNARY, operator, make_skard_type_unknown(), child,
+                                    SKARD_AST_NONE, token);
+}
 
-static ASTNode *make_ast_node_expression(ASTNodeExpression node_expression)
+static ASTIndex make_ast_node_binary(Compiler *compiler, ASTIndex first, ASTIndex second, ASTOperator operator,
+                                     Token *token)
 {
-    ASTNode *node = SKARD_ALLOCATE(ASTNode);
-    node->kind = AST_NODE_EXPRESSION;
-    node->as.node_expression = node_expression;
-    node->line = 0;
-    node->column = 0;
-    return node;
+    return make_ast_node_expression(compiler, AST_EXPR_BINARY, operator, make_skard_type_unknown(), first, second,
+                                    token);
+}
+
+static ASTIndex make_ast_node_grouping(Compiler *compiler, ASTIndex child, Token *token)
+{
+    return make_ast_node_expression(compiler, AST_EXPR_GROUPING, OTOR_PLUS, make_skard_type_unknown(), child,
+                                    SKARD_AST_NONE, token);
+}
+
+// The (name, value) pairs of the fields are on the scratch stack from fields_start
+static ASTIndex make_ast_node_struct(Compiler *compiler, size_t fields_start, Token *token)
+{
+    AST *ast = &compiler->ast;
+    uint32_t header[] = { [AST_STRUCT_LAYOUT] = ast_add_layout(compiler) };
+    size_t fields_count = (ast->scratch_count - fields_start) / 2;
+    uint32_t list = ast_move_list(ast, fields_start, header, sizeof(header) / sizeof(header[0]));
+    return make_ast_node_expression(compiler, AST_EXPR_STRUCT, OTOR_PLUS, make_skard_type_unknown(), list,
+                                    (ASTIndex) fields_count, token);
+}
+
+static ASTIndex make_ast_node_field(Compiler *compiler, ASTIndex object, Token name, Token *token)
+{
+    AST *ast = &compiler->ast;
+    uint32_t header[] = { [AST_FIELD_NAME] = ast_add_name(ast, name), [AST_FIELD_OFFSET] = 0 };
+    uint32_t list = ast_move_list(ast, ast->scratch_count, header, sizeof(header) / sizeof(header[0]));
+    return make_ast_node_expression(compiler, AST_EXPR_FIELD, OTOR_PLUS, make_skard_type_unknown(), object, list,
+                                    token);
 }
 
-static ASTNode *make_ast_node_value(Value value, SkardType type)
+static ASTIndex make_ast_node_yield(Compiler *compiler, ASTIndex child, Token *token)
 {
-    ASTNodeExpression node_expression;
-    node_expression.kind = AST_EXPR_VALUE;
-    node_expression.type = type;
-    node_expression.as.node_value = (ASTExpressionValue) { .value = value };
+    return make_ast_node_expression(compiler, AST_EXPR_YIELD, OTOR_PLUS, make_skard_type_unknown(), child,
+                                    SKARD_AST_NONE, token);
+}
 
-    return make_ast_node_expression(node_expression);
+// The arguments are on the scratch stack from arguments_start
+static ASTIndex make_ast_node_call(Compiler *compiler, Token name, size_t arguments_start, Token *token)
+{
+    AST *ast = &compiler->ast;
+    uint32_t header[] = { [AST_CALL_NAME] = ast_add_name(ast, name), [AST_CALL_NATIVE] = 0 };
+    size_t arguments_count = ast->scratch_count - arguments_start;
+    uint32_t list = ast_move_list(ast, arguments_start, header, sizeof(header) / sizeof(header[0]));
+    return make_ast_node_expression(compiler, AST_EXPR_CALL, OTOR_PLUS, make_skard_type_unknown(), list,
+                                    (ASTIndex) arguments_count, token);
 }
 
-static ASTNode *make_ast_node_unary(ASTNode *child, ASTOperator operator)
+static uint32_t ast_add_value(AST *ast, Value value)
 {
-    ASTNodeExpression node_expression;
-    node_expression.kind = AST_EXPR_UNARY;
-    node_expression.type = make_skard_type_unknown();
-    node_expression.as.node_unary = (ASTExpressionUnary) { .child = (struct ASTNode *) child, .operator = operator };
+    if (ast->values_capacity < ast->values_count + 1) {
+        ast->values_capacity = SKARD_GROW_CAPACITY(ast->values_capacity);
+        ast->values = SKARD_GROW_ARRAY(Value, ast->values, ast->values_capacity);
+    }
+    ast->values[ast->values_count] = value;
+    return (uint32_t) ast->values_count++;
+}
 
-    return make_ast_node_expression(node_expression);
+// Layouts are kept by the AST even when the single pass compiles, so they are freed the same way
+static uint32_t ast_add_layout(Compiler *compiler)
+{
+    AST *ast = &compiler->ast;
+    StructLayout *layout = SKARD_ARENA_ALLOCATE(&compiler->arena, StructLayout);
+    struct_layout_init(layout);
+    if (ast->layouts_capacity < ast->layouts_count + 1) {
+        ast->layouts_capacity = SKARD_GROW_CAPACITY(ast->layouts_capacity);
+        ast->layouts = SKARD_GROW_ARRAY(StructLayout *, ast->layouts, ast->layouts_capacity);
+    }
+    ast->layouts[ast->layouts_count] = layout;
+    return (uint32_t) ast->layouts_count++;
 }
 
-static ASTNode *make_ast_node_binary(ASTNode *first, ASTNode *second, ASTOperator operator)
+static uint32_t ast_add_name(AST *ast, Token name)
 {
-    ASTNodeExpression node_expression;
-    node_expression.kind = AST_EXPR_BINARY;
-    node_expression.type = make_skard_type_unknown();
-    node_expression.as.node_binary = (ASTExpressionBinary) {
-        .first = (struct ASTNode *) first,
-        .second = (struct ASTNode *) second,
-        .operator = operator };
+    if (ast->names_capacity < ast->names_count + 1) {
+        ast->names_capacity = SKARD_GROW_CAPACITY(ast->names_capacity);
+        ast->names = SKARD_GROW_ARRAY(Token, ast->names, ast->names_capacity);
+    }
+    ast->names[ast->names_count] = name;
+    return (uint32_t) ast->names_count++;
+}
 
-    return make_ast_node_expression(node_expression);
+static void ast_push_scratch(AST *ast, uint32_t item)
+{
+    if (ast->scratch_capacity < ast->scratch_count + 1) {
+        ast->scratch_capacity = SKARD_GROW_CAPACITY(ast->scratch_capacity);
+        ast->scratch = SKARD_GROW_ARRAY(uint32_t, ast->scratch, ast->scratch_capacity);
+    }
+    ast->scratch[ast->scratch_count++] = item;
 }
 
-static ASTNode *make_ast_node_grouping(ASTNode *child)
+// Moves the scratch items from scratch_start to extra behind the header and returns where the list starts
+static uint32_t ast_move_list(AST *ast, size_t scratch_start, const uint32_t *header, size_t header_count)
 {
-    ASTNodeExpression node_expression;
-    node_expression.kind = AST_EXPR_GROUPING;
-    node_expression.type = make_skard_type_unknown();
-    node_expression.as.node_grouping = (ASTExpressionGrouping) { .child = (struct ASTNode *) child };
+    size_t items_count = ast->scratch_count - scratch_start;
+    size_t count = header_count + items_count;
+    if (ast->extra_capacity < ast->extra_count + count) {
+        while (ast->extra_capacity < ast->extra_count + count) {
+            ast->extra_capacity = SKARD_GROW_CAPACITY(ast->extra_capacity);
+        }
+        ast->extra = SKARD_GROW_ARRAY(uint32_t, ast->extra, ast->extra_capacity);
+    }
 
-    return make_ast_node_expression(node_expression);
+    uint32_t start = (uint32_t) ast->extra_count;
+    memcpy(&ast->extra[start], header, header_count * sizeof(uint32_t));
+    if (items_count > 0) {
+        memcpy(&ast->extra[start + header_count], &ast->scratch[scratch_start], items_count * sizeof(uint32_t));
+    }
+    ast->extra_count += count;
+    ast->scratch_count = scratch_start;
+    return start;
 }
 
 
@@ -334,7 +548,7 @@ static void compiler_advance(Compiler *compiler)
     compiler->previous = compiler->current;
 
     while (true) {
-        compiler->current = lexer_scan_token(compiler->lexer);
+        compiler->current = lexer_scan_token(&compiler->lexer);
         if (compiler->current.type != TOKEN_ERROR) {
             break;
         }
@@ -354,7 +568,7 @@ static void compiler_consume(Compiler *compiler, TokenType type, const char *mes
 }
 
 
-static ParseRule parse_rules[] = {
+static const ParseRule parse_rules[] = {
     [TOKEN_EOF] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_EOL] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_ERROR] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
@@ -364,7 +578,7 @@ static ParseRule parse_rules[] = {
     [TOKEN_RIGHT_BRACE] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_RIGHT_BRACKET] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_LEFT_BRACKET] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
-    [TOKEN_DOT] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
+    [TOKEN_DOT] = { .prefix = NULL, .infix = compiler_parse_field, .precedence = PREC_CALL },
     [TOKEN_COMMA] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_COLON] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_PLUS] = { .prefix = compiler_parse_unary, .infix = compiler_parse_binary, .precedence = PREC_TERM },
@@ -391,7 +605,7 @@ static ParseRule parse_rules[] = {
     [TOKEN_AND] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_PACKAGE] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_IMPORT] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
-    [TOKEN_KEY_STRUCT] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
+    [TOKEN_KEY_STRUCT] = { .prefix = compiler_parse_struct, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_SELF] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_LET] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_NIL] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
@@ -406,115 +620,199 @@ static ParseRule parse_rules[] = {
     [TOKEN_KEY_MATCH] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_WITH] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_KEY_DUMP] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
-    [TOKEN_IDENTIFIER] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
+    [TOKEN_KEY_YIELD] = { .prefix = compiler_parse_yield, .infix = NULL, .precedence = PREC_NONE },
+    [TOKEN_IDENTIFIER] = { .prefix = compiler_parse_call, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_LIT_STRING] = { .prefix = NULL, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_LIT_REAL] = { .prefix = compiler_parse_real, .infix = NULL, .precedence = PREC_NONE },
     [TOKEN_LIT_INT] = { .prefix = compiler_parse_int, .infix = NULL, .precedence = PREC_NONE },
 };
 
 
-static ParseRule *get_parse_rule(TokenType type)
+static const ParseRule *get_parse_rule(TokenType type)
 {
-    assert(COUNT_TOKENS == 55);
+    assert(COUNT_TOKENS == 56);
     return &parse_rules[type];
 }
 
+// Returns COUNT_OTORS for tokens of no unary operator
+static ASTOperator get_unary_operator(TokenType type)
+{
+    assert((COUNT_TOKENS == 56) && "Exhaustive token types handling");
+    switch (type) {
+        case TOKEN_MINUS:
+            return OTOR_MINUS;
+        case TOKEN_PLUS:
+            return OTOR_PLUS;
+        default:
+            break;
+    }
+
+    return COUNT_OTORS;
+}
+
+// Returns COUNT_OTORS for tokens of no binary operator
+static ASTOperator get_binary_operator(TokenType type)
+{
+    assert((COUNT_TOKENS == 56) && "Exhaustive token types handling");
+    switch (type) {
+        case TOKEN_PLUS:
+            return OTOR_PLUS;
+        case TOKEN_MINUS:
+            return OTOR_MINUS;
+        case TOKEN_STAR:
+            return OTOR_STAR;
+        case TOKEN_SLASH:
+            return OTOR_SLASH;
+        case TOKEN_DIV:
+            return OTOR_DIV;
+        default:
+            break;
+    }
+
+    return COUNT_OTORS;
+}
+
 
-static ASTNode *compiler_parse_precedence(Compiler *compiler, Precedence precedence) // TODO: add support for multiline expressions
+static ASTIndex compiler_parse_precedence(Compiler *compiler, Precedence precedence) // TODO: add support for multiline expressions
 {
     compiler_advance(compiler);
     ParseFnPrefix prefix_rule = get_parse_rule(compiler->previous.type)->prefix;
     if (prefix_rule == NULL) {
         compiler_parse_error_at_previous(compiler, "Expected expression.");
-        return NULL;
+        return SKARD_AST_NONE;
     }
 
-    ASTNode *first = prefix_rule(compiler);
+    ASTIndex first = prefix_rule(compiler);
 
     while (precedence <= get_parse_rule(compiler->current.type)->precedence) {
         compiler_advance(compiler);
         ParseFnInfix infix_rule = get_parse_rule(compiler->previous.type)->infix;
+        if (infix_rule == NULL) {
+            compiler_parse_error_at_previous(compiler, "Unsupported operator.");
+            break;
+        }
         first = infix_rule(compiler, first);
     }
 
     return first;
 }
 
-static ASTNode *compiler_parse_expression(Compiler *compiler)
+static ASTIndex compiler_parse_expression(Compiler *compiler)
 {
     return compiler_parse_precedence(compiler, PREC_ASSIGNMENT);
 }
 
-static ASTNode *compiler_parse_grouping(Compiler *compiler)
+static ASTIndex compiler_parse_grouping(Compiler *compiler)
 {
-    ASTNode *child = compiler_parse_expression(compiler);
+    Token token = compiler->previous;
+    ASTIndex child = compiler_parse_expression(compiler);
     compiler_consume(compiler, TOKEN_RIGHT_PAREN, "Expected ')' after expression.");
-    return make_ast_node_grouping(child);
+    return make_ast_node_grouping(compiler, child, &token);
 }
 
-static ASTNode *compiler_parse_binary(Compiler *compiler, ASTNode *first)
+static ASTIndex compiler_parse_binary(Compiler *compiler, ASTIndex first)
 {
-    TokenType operator_type = compiler->previous.type;
-    ParseRule *rule = get_parse_rule(operator_type);
-    ASTNode *second = compiler_parse_precedence(compiler, (Precedence) (rule->precedence + 1));
-
-    ASTOperator ast_operator;
-    assert((COUNT_TOKENS == 55) && "Exhaustive token types handling");
-    switch (operator_type) {
-        case TOKEN_PLUS:
-            ast_operator = OTOR_PLUS;
-            break;
-        case TOKEN_MINUS:
-            ast_operator = OTOR_MINUS;
-            break;
-        case TOKEN_STAR:
-            ast_operator = OTOR_STAR;
-            break;
-        case TOKEN_SLASH:
-            ast_operator = OTOR_SLASH;
-            break;
-        case TOKEN_DIV:
-            ast_operator = OTOR_DIV;
-            break;
-        default:
-            return NULL; // Unreachable
+    Token token = compiler->previous;
+    TokenType operator_type = token.type;
+    const ParseRule *rule = get_parse_rule(operator_type);
+    ASTIndex second = compiler_parse_precedence(compiler, (Precedence) (rule->precedence + 1));
+
+    ASTOperator ast_operator = get_binary_operator(operator_type);
+    if (ast_operator == COUNT_OTORS) {
+        return SKARD_AST_NONE; // Unreachable
     }
 
-    return make_ast_node_binary(first, second, ast_operator);
+    return make_ast_node_binary(compiler, first, second, ast_operator, &token);
 }
 
-static ASTNode *compiler_parse_unary(Compiler *compiler)
+static ASTIndex compiler_parse_unary(Compiler *compiler)
 {
-    TokenType operator_type = compiler->previous.type;
-    ASTNode *child = compiler_parse_precedence(compiler, PREC_UNARY);
+    Token token = compiler->previous;
+    TokenType operator_type = token.type;
+    ASTIndex child = compiler_parse_precedence(compiler, PREC_UNARY);
 
-    ASTOperator ast_operator;
-    assert((COUNT_TOKENS == 55) && "Exhaustive token types handling");
-    switch (operator_type) {
-        case TOKEN_MINUS:
-            ast_operator = OTOR_MINUS;
+    ASTOperator ast_operator = get_unary_operator(operator_type);
+    if (ast_operator == COUNT_OTORS) {
+        return SKARD_AST_NONE; // Unreachable
+    }
+
+    return make_ast_node_unary(compiler, child, ast_operator, &token);
+}
+
+// struct { name = expression, ... }
+static ASTIndex compiler_parse_struct(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    AST *ast = &compiler->ast;
+    size_t fields_start = ast->scratch_count;
+
+    compiler_consume(compiler, TOKEN_LEFT_BRACE, "Expected '{' after 'struct'.");
+    do {
+        compiler_consume(compiler, TOKEN_IDENTIFIER, "Expected field name.");
+        uint32_t name = ast_add_name(ast, compiler->previous);
+        compiler_consume(compiler, TOKEN_ASSIGN, "Expected '=' after field name.");
+        ASTIndex value = compiler_parse_expression(compiler);
+        ast_push_scratch(ast, name);
+        ast_push_scratch(ast, value);
+
+        if (compiler->current.type != TOKEN_COMMA) {
             break;
-        case TOKEN_PLUS:
-            ast_operator = OTOR_PLUS;
+        }
+        compiler_advance(compiler);
+    } while (compiler->current.type != TOKEN_RIGHT_BRACE && !compiler->is_panic);
+    compiler_consume(compiler, TOKEN_RIGHT_BRACE, "Expected '}' after struct fields.");
+
+    return make_ast_node_struct(compiler, fields_start, &token);
+}
+
+static ASTIndex compiler_parse_field(Compiler *compiler, ASTIndex object)
+{
+    Token token = compiler->previous;
+    compiler_consume(compiler, TOKEN_IDENTIFIER, "Expected field name after '.'.");
+    return make_ast_node_field(compiler, object, compiler->previous, &token);
+}
+
+// yield expression, takes everything to its right like Python's yield
+static ASTIndex compiler_parse_yield(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    ASTIndex child = compiler_parse_expression(compiler);
+    return make_ast_node_yield(compiler, child, &token);
+}
+
+// name(expression, ...), names only refer to native functions for now
+static ASTIndex compiler_parse_call(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    AST *ast = &compiler->ast;
+    size_t arguments_start = ast->scratch_count;
+
+    compiler_consume(compiler, TOKEN_LEFT_PAREN, "Expected '(' after function name.");
+    while (compiler->current.type != TOKEN_RIGHT_PAREN && !compiler->is_panic) {
+        ast_push_scratch(ast, compiler_parse_expression(compiler));
+        if (compiler->current.type != TOKEN_COMMA) {
             break;
-        default:
-            return NULL; // Unreachable
+        }
+        compiler_advance(compiler);
     }
+    compiler_consume(compiler, TOKEN_RIGHT_PAREN, "Expected ')' after arguments.");
 
-    return make_ast_node_unary(child, ast_operator);
+    return make_ast_node_call(compiler, token, arguments_start, &token);
 }
 
-static ASTNode *compiler_parse_real(Compiler *compiler)
+static ASTIndex compiler_parse_real(Compiler *compiler)
 {
     SkReal sk_real = strtod(compiler->previous.start, NULL);
-    ASTNode *node = make_ast_node_value(make_value_real(sk_real), make_skard_type_real());
+    ASTIndex node = make_ast_node_value(compiler, make_value_real(sk_real), make_skard_type_real(),
+                                        &compiler->previous);
     return node;
 }
 
-static ASTNode *compiler_parse_int(Compiler *compiler)
+static ASTIndex compiler_parse_int(Compiler *compiler)
 {
     SkInt sk_int = strtoll(compiler->previous.start, NULL, 10);
-    ASTNode *node = make_ast_node_value(make_value_int(sk_int), make_skard_type_int());
+    ASTIndex node = make_ast_node_value(compiler, make_value_int(sk_int), make_skard_type_int(),
+                                        &compiler->previous);
     return node;
 }
 
@@ -531,19 +829,25 @@ static SkardType compiler_infer_type_binary_star(Compiler *compiler, SkardType *
 static SkardType compiler_infer_type_binary_slash(Compiler *compiler, SkardType *first_type, SkardType *second_type);
 static SkardType compiler_infer_type_binary_div(Compiler *compiler, SkardType *first_type, SkardType *second_type);
 
-static InferRule *get_infer_rule(ASTOperator operator);
+static const InferRule *get_infer_rule(ASTOperator operator);
 
-static SkardType compiler_infer_type_unary(Compiler *compiler, ASTExpressionUnary *node);
-static SkardType compiler_infer_type_binary(Compiler *compiler, ASTExpressionBinary *node);
-static SkardType compiler_infer_type_grouping(Compiler *compiler, ASTExpressionGrouping *node);
+static SkardType compiler_infer_type_unary(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_binary(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_grouping(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_struct(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_field(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_yield(Compiler *compiler, ASTIndex node);
+static SkardType compiler_infer_type_call(Compiler *compiler, ASTIndex node);
 
-static SkardType compiler_infer_type_expression(Compiler *compiler, ASTNodeExpression *node);
+static SkardType compiler_infer_type_expression(Compiler *compiler, ASTIndex node);
 
-static SkardType compiler_get_expression_type(Compiler *compiler, ASTNodeExpression *node);
+static SkardType compiler_get_expression_type(Compiler *compiler, ASTIndex node);
 
-static bool compiler_typecheck_expression(Compiler *compiler, ASTNodeExpression *node);
+static bool compiler_typecheck_expression(Compiler *compiler, ASTIndex node);
+static bool check_dumped_type(SkardType *type);
 
-static bool compiler_typecheck_ast(Compiler *compiler, ASTNode *node);
+static bool compiler_fold_binary(Compiler *compiler, ASTIndex node);
+static bool compiler_fold_constants(Compiler *compiler);
 
 
 static void report_type_error_unary(SkardType *child_type, ASTOperator operator)
@@ -701,7 +1005,7 @@ static SkardType compiler_infer_type_binary_div(Compiler *compiler, SkardType *f
 }
 
 
-static InferRule infer_rules[] = {
+static const InferRule infer_rules[] = {
         [OTOR_PLUS] = { .unary = compiler_infer_type_unary_plus, .binary = compiler_infer_type_binary_plus },
         [OTOR_MINUS] = { .unary = compiler_infer_type_unary_minus, .binary = compiler_infer_type_binary_minus },
         [OTOR_STAR] = { .unary = NULL, .binary = compiler_infer_type_binary_star },
@@ -709,75 +1013,201 @@ static InferRule infer_rules[] = {
         [OTOR_DIV] = { .unary = NULL, .binary = compiler_infer_type_binary_div },
 };
 
-static InferRule *get_infer_rule(ASTOperator operator)
+static const InferRule *get_infer_rule(ASTOperator operator)
 {
     return &infer_rules[operator];
 }
 
 
-static SkardType compiler_infer_type_unary(Compiler *compiler, ASTExpressionUnary *node)
+static SkardType compiler_infer_type_unary(Compiler *compiler, ASTIndex node)
 {
-    ASTNodeExpression *child_expression = &((ASTNode *) node->child)->as.node_expression;
-    SkardType child_type = compiler_get_expression_type(compiler, child_expression);
+    AST *ast = &compiler->ast;
+    SkardType child_type = compiler_get_expression_type(compiler, ast->firsts[node]);
 
     if (is_skard_type_invalid(&child_type)) {
         return make_skard_type_invalid();
     }
 
-    InferFnUnary unary_rule = get_infer_rule(node->operator)->unary;
+    ASTOperator operator = ast->operators[node];
+    InferFnUnary unary_rule = get_infer_rule(operator)->unary;
     if (unary_rule == NULL) {
-        fprintf(stderr, "ERROR: Invalid unary operator '%s'\n", ast_operator_translate(node->operator));
+        fprintf(stderr, "ERROR: Invalid unary operator '%s'\n", ast_operator_translate(operator));
         return make_skard_type_invalid();
     }
 
     return unary_rule(compiler, &child_type);
 }
 
-static SkardType compiler_infer_type_binary(Compiler *compiler, ASTExpressionBinary *node)
+static SkardType compiler_infer_type_binary(Compiler *compiler, ASTIndex node)
 {
-    ASTNodeExpression *first_expression = &((ASTNode *) node->first)->as.node_expression;
-    ASTNodeExpression *second_expression = &((ASTNode *) node->second)->as.node_expression;
-    SkardType first_type = compiler_get_expression_type(compiler, first_expression);
-    SkardType second_type = compiler_get_expression_type(compiler, second_expression);
+    AST *ast = &compiler->ast;
+    SkardType first_type = compiler_get_expression_type(compiler, ast->firsts[node]);
+    SkardType second_type = compiler_get_expression_type(compiler, ast->seconds[node]);
 
     if (is_skard_type_invalid(&first_type) || is_skard_type_invalid(&second_type)) {
         return make_skard_type_invalid();
     }
 
-    InferFnBinary binary_rule = get_infer_rule(node->operator)->binary;
+    ASTOperator operator = ast->operators[node];
+    InferFnBinary binary_rule = get_infer_rule(operator)->binary;
     if (binary_rule == NULL) {
-        fprintf(stderr, "ERROR: Invalid binary operator '%s'\n", ast_operator_translate(node->operator));
+        fprintf(stderr, "ERROR: Invalid binary operator '%s'\n", ast_operator_translate(operator));
         return make_skard_type_invalid();
     }
 
     return binary_rule(compiler, &first_type, &second_type);
 }
 
-static SkardType compiler_infer_type_grouping(Compiler *compiler, ASTExpressionGrouping *node)
+static SkardType compiler_infer_type_grouping(Compiler *compiler, ASTIndex node)
 {
-    ASTNodeExpression *child_expression = &((ASTNode *) node->child)->as.node_expression;
-    SkardType child_type = compiler_get_expression_type(compiler, child_expression);
+    SkardType child_type = compiler_get_expression_type(compiler, compiler->ast.firsts[node]);
     return copy_skard_type(&child_type); // TODO: Consider unknown type at this point
 }
 
+// Lays the fields out inline in declaration order, nested structs are flattened into the outer one
+static SkardType compiler_infer_type_struct(Compiler *compiler, ASTIndex node)
+{
+    AST *ast = &compiler->ast;
+    size_t list = ast->firsts[node];
+    StructLayout *layout = ast->layouts[ast->extra[list + AST_STRUCT_LAYOUT]];
+    for (size_t i = 0; i < ast->seconds[node]; i++) {
+        Token *name = &ast->names[ast->extra[list + AST_STRUCT_FIELDS + 2 * i]];
+        ASTIndex value = ast->extra[list + AST_STRUCT_FIELDS + 2 * i + 1];
+        SkardType field_type = compiler_get_expression_type(compiler, value);
+        if (is_skard_type_invalid(&field_type)) {
+            return make_skard_type_invalid();
+        }
+
+        if (!struct_layout_add_field(layout, name->start, name->length, field_type)) {
+            fprintf(stderr, "ERROR: Duplicate field '%.*s' in struct.\n", (int) name->length, name->start);
+            return make_skard_type_invalid();
+        }
+    }
 
-// TODO: Implement infering and kind checking with rules in similar way as parsing
-static SkardType compiler_infer_type_expression(Compiler *compiler, ASTNodeExpression *node)
+    if (layout->size > SKARD_MAX_STRUCT_SIZE) {
+        fprintf(stderr, "ERROR: Struct of %zu values exceeds the limit of %d values.\n",
+                layout->size, SKARD_MAX_STRUCT_SIZE);
+        return make_skard_type_invalid();
+    }
+
+    return make_skard_type_struct(layout);
+}
+
+static SkardType compiler_infer_type_field(Compiler *compiler, ASTIndex node)
 {
-    (void) compiler;
+    AST *ast = &compiler->ast;
+    SkardType object_type = compiler_get_expression_type(compiler, ast->firsts[node]);
+    if (is_skard_type_invalid(&object_type)) {
+        return make_skard_type_invalid();
+    }
+
+    size_t list = ast->seconds[node];
+    Token *name = &ast->names[ast->extra[list + AST_FIELD_NAME]];
+    if (!is_skard_type_of_kind(&object_type, TYPE_STRUCT)) {
+        fprintf(stderr, "ERROR: Data type '%s' has no field '%.*s'.\n",
+                skard_type_translate(&object_type), (int) name->length, name->start);
+        return make_skard_type_invalid();
+    }
+
+    StructField *field = struct_layout_find_field(object_type.layout, name->start, name->length);
+    if (field == NULL) {
+        fprintf(stderr, "ERROR: Struct has no field '%.*s'.\n", (int) name->length, name->start);
+        return make_skard_type_invalid();
+    }
+
+    ast->extra[list + AST_FIELD_OFFSET] = (uint32_t) field->offset;
+    return copy_skard_type(&field->type);
+}
+
+// The host reads and replaces the yielded value in a single slot, so only scalars can be yielded
+static SkardType compiler_infer_type_yield(Compiler *compiler, ASTIndex node)
+{
+    SkardType child_type = compiler_get_expression_type(compiler, compiler->ast.firsts[node]);
+    if (is_skard_type_invalid(&child_type)) {
+        return make_skard_type_invalid();
+    }
+
+    if (!is_skard_type_of_kind(&child_type, TYPE_INT) && !is_skard_type_of_kind(&child_type, TYPE_REAL)) {
+        fprintf(stderr, "ERROR: Cannot yield a value of data type '%s'.\n", skard_type_translate(&child_type));
+        return make_skard_type_invalid();
+    }
+
+    return copy_skard_type(&child_type);
+}
+
+static ASTIndex unwrap_ast_expression(AST *ast, ASTIndex node);
+
+// Argument kinds have to match the signature exactly, only Int literals are promoted for Real parameters
+static SkardType compiler_infer_type_call(Compiler *compiler, ASTIndex node)
+{
+    AST *ast = &compiler->ast;
+    size_t list = ast->firsts[node];
+    size_t arguments_count = ast->seconds[node];
+    Token *name = &ast->names[ast->extra[list + AST_CALL_NAME]];
+
+    size_t index = 0;
+    const NativeFunction *native = NULL;
+    if (compiler->options.natives != NULL) {
+        native = native_registry_find(compiler->options.natives, name->start, name->length, &index);
+    }
+    if (native == NULL) {
+        fprintf(stderr, "ERROR: Unknown function '%.*s'.\n", (int) name->length, name->start);
+        return make_skard_type_invalid();
+    }
+
+    if (arguments_count != native->arity) {
+        fprintf(stderr, "ERROR: Function '%.*s' takes %zu arguments but %zu were given.\n",
+                (int) name->length, name->start, native->arity, arguments_count);
+        return make_skard_type_invalid();
+    }
+
+    for (size_t i = 0; i < arguments_count; i++) {
+        ASTIndex argument = ast->extra[list + AST_CALL_ARGUMENTS + i];
+        SkardType argument_type = compiler_get_expression_type(compiler, argument);
+        if (is_skard_type_invalid(&argument_type)) {
+            return make_skard_type_invalid();
+        }
+
+        TypeKind parameter = native->parameters[i];
+        bool is_literal = ast->kinds[unwrap_ast_expression(ast, argument)] == AST_EXPR_VALUE;
+        if (!is_skard_type_of_kind(&argument_type, parameter) &&
+            !(parameter == TYPE_REAL && is_skard_type_of_kind(&argument_type, TYPE_INT) && is_literal)) {
+            SkardType parameter_type = make_skard_type_simple(parameter);
+            fprintf(stderr, "ERROR: Argument %zu of function '%.*s' has data type '%s', expected '%s'.\n", i + 1,
+                    (int) name->length, name->start, skard_type_translate(&argument_type),
+                    skard_type_translate(&parameter_type));
+            return make_skard_type_invalid();
+        }
+    }
+
+    ast->extra[list + AST_CALL_NATIVE] = (uint32_t) index;
+    return make_skard_type_simple(native->result);
+}
+
 
-    assert((COUNT_AST_EXPRS == 4) && "Exhaustive expression kinds handling");
-    switch (node->kind) {
+// TODO: Implement infering and kind checking with rules in similar way as parsing
+static SkardType compiler_infer_type_expression(Compiler *compiler, ASTIndex node)
+{
+    assert((COUNT_AST_EXPRS == 8) && "Exhaustive expression kinds handling");
+    switch (compiler->ast.kinds[node]) {
         case AST_EXPR_VALUE:
             fprintf(stderr, "Error: Unspecified value type.\n");
             // TODO: Create better error message, this should never happen and should be a bug in compiler
             return make_skard_type_invalid();
         case AST_EXPR_UNARY:
-            return compiler_infer_type_unary(compiler, &node->as.node_unary);
+            return compiler_infer_type_unary(compiler, node);
         case AST_EXPR_BINARY:
-            return compiler_infer_type_binary(compiler, &node->as.node_binary);
+            return compiler_infer_type_binary(compiler, node);
         case AST_EXPR_GROUPING:
-            return compiler_infer_type_grouping(compiler, &node->as.node_grouping);
+            return compiler_infer_type_grouping(compiler, node);
+        case AST_EXPR_STRUCT:
+            return compiler_infer_type_struct(compiler, node);
+        case AST_EXPR_FIELD:
+            return compiler_infer_type_field(compiler, node);
+        case AST_EXPR_YIELD:
+            return compiler_infer_type_yield(compiler, node);
+        case AST_EXPR_CALL:
+            return compiler_infer_type_call(compiler, node);
         default:
             break;
     }
@@ -787,70 +1217,1053 @@ static SkardType compiler_infer_type_expression(Compiler *compiler, ASTNodeExpre
 }
 
 
-static SkardType compiler_get_expression_type(Compiler *compiler, ASTNodeExpression *node)
+static SkardType compiler_get_expression_type(Compiler *compiler, ASTIndex node)
 {
-    if (is_skard_type_unknown(&node->type)) {
-        SkardType type = compiler_infer_type_expression(compiler, node);
-        node->type = type;
+    SkardType *type = &compiler->ast.types[node];
+    if (is_skard_type_unknown(type)) {
+        *type = compiler_infer_type_expression(compiler, node);
     }
 
-    return node->type;
+    return *type;
 }
 
 
-static bool compiler_typecheck_expression(Compiler *compiler, ASTNodeExpression *node)
+static bool compiler_typecheck_expression(Compiler *compiler, ASTIndex node)
 {
     SkardType expression_type = compiler_get_expression_type(compiler, node);
-    if (is_skard_type_invalid(&expression_type)) {
+    return check_dumped_type(&expression_type);
+}
+
+// The expression result is dumped, so it has to be a known scalar
+static bool check_dumped_type(SkardType *type)
+{
+    if (is_skard_type_invalid(type)) {
         fprintf(stderr, "ERROR: Invalid expression type.\n");
         return false;
     }
 
-    if (is_skard_type_unknown(&expression_type)) {
+    if (is_skard_type_unknown(type)) {
         fprintf(stderr, "ERROR: Could not infer expression type.\n");
         return false;
     }
 
+    // TODO: Move to dump statements once statements are parsed
+    if (is_skard_type_of_kind(type, TYPE_STRUCT)) {
+        fprintf(stderr, "ERROR: Cannot dump a value of data type '%s'.\n", skard_type_translate(type));
+        return false;
+    }
+
     return true;
 }
 
 
-static bool compiler_typecheck_ast(Compiler *compiler, ASTNode *node)
+ASTIndex compiler_generate_ast(Compiler *compiler)
 {
-    assert((COUNT_AST_NODES == 1) && "Exhaustive node kinds handling");
-    switch (node->kind) {
-        case AST_NODE_EXPRESSION:
-            return compiler_typecheck_expression(compiler, &node->as.node_expression);
-        default:
-            break;
+    compiler_release_ast(compiler);
+    compiler_advance(compiler);
+    ASTIndex root = compiler_parse_expression(compiler);
+    compiler_consume(compiler, TOKEN_EOF, "Expected end of expression.");
+
+    if (compiler->is_error) {
+        return SKARD_AST_NONE;
     }
 
-    fprintf(stderr, "ERROR: Unknown node kind.\n");
-    return false;
+#ifdef SKARD_DEBUG
+    ast_node_print(&compiler->ast, root, true);
+#endif
+    if (!compiler_typecheck_expression(compiler, root)) {
+        compiler->is_error = true;
+        return SKARD_AST_NONE;
+    }
+    if (!compiler_fold_constants(compiler)) {
+        return SKARD_AST_NONE;
+    }
+#ifdef SKARD_DEBUG
+    ast_node_print(&compiler->ast, root, true);
+#endif
+
+    return root;
 }
 
 
-bool compiler_generate_ast(Compiler *compiler)
+static void compiler_error_at(Compiler *compiler, size_t line, size_t column, const char *message);
+static void compiler_generate_error(Compiler *compiler, ASTIndex node, const char *message);
+
+static bool compiler_generate_stack_operand(Compiler *compiler, ASTIndex node, TypeKind kind, TypeKind *pushed);
+static bool compiler_generate_stack_expression(Compiler *compiler, ASTIndex node);
+static bool compiler_generate_stack(Compiler *compiler, ASTIndex root);
+static void compiler_finish_stack(Compiler *compiler, TypeKind kind, size_t line, size_t column);
+
+static bool compiler_reserve_register(Compiler *compiler, ASTIndex node, size_t target);
+static bool compiler_generate_register_operand(Compiler *compiler, ASTIndex node, size_t target, TypeKind kind,
+                                               uint8_t *operand);
+static bool compiler_generate_register_expression(Compiler *compiler, ASTIndex node, size_t target);
+static bool compiler_generate_register(Compiler *compiler, ASTIndex root);
+
+
+static void compiler_error_at(Compiler *compiler, size_t line, size_t column, const char *message)
 {
-    compiler_advance(compiler);
-    ASTNode *ast = compiler_parse_expression(compiler);
-    compiler_consume(compiler, TOKEN_EOF, "Expected end of expression.");
+    fprintf(stderr, "[line %zu][column %zu] Error: %s\n", line, column, message);
+    compiler->is_error = true;
+}
+
+static void compiler_generate_error(Compiler *compiler, ASTIndex node, const char *message)
+{
+    ASTSpan span = compiler->ast.spans[node];
+    compiler_error_at(compiler, span.line, span.column, message);
+}
 
-    if (ast != NULL) {
-        ast_node_print(ast, true);
-        compiler_typecheck_ast(compiler, ast);
-        ast_node_print(ast, true);
-        ast_node_free(ast);
+
+// Operands of an arithmetic operator are promoted to this kind before the operation
+static TypeKind get_operand_kind(ASTOperator operator, TypeKind result_kind)
+{
+    if (operator == OTOR_SLASH) {
+        return TYPE_REAL;
     }
 
-    return !compiler->is_error;
+    return result_kind;
 }
 
+// Picks the instruction specialized for the kinds the operands have on the stack, Int operands of a Real operation
+// are promoted by the instruction itself
+static uint8_t get_stack_op_binary(ASTOperator operator, TypeKind first, TypeKind second)
+{
+    size_t variant = (first == TYPE_INT) << 1 | (second == TYPE_INT);
+
+    assert((COUNT_OTORS == 5) && "Exhaustive operators handling");
+    switch (operator) {
+        case OTOR_PLUS: {
+            static const uint8_t ops[] = { OP_ADD_REAL, OP_ADD_REAL_INT, OP_ADD_INT_REAL, OP_ADD_INT };
+            return ops[variant];
+        }
+        case OTOR_MINUS: {
+            static const uint8_t ops[] = {
+                OP_SUBTRACT_REAL, OP_SUBTRACT_REAL_INT, OP_SUBTRACT_INT_REAL, OP_SUBTRACT_INT
+            };
+            return ops[variant];
+        }
+        case OTOR_STAR: {
+            static const uint8_t ops[] = {
+                OP_MULTIPLY_REAL, OP_MULTIPLY_REAL_INT, OP_MULTIPLY_INT_REAL, OP_MULTIPLY_INT
+            };
+            return ops[variant];
+        }
+        case OTOR_SLASH: {
+            static const uint8_t ops[] = { OP_DIVIDE_REAL, OP_DIVIDE_REAL_INT, OP_DIVIDE_INT_REAL, OP_DIVIDE_INT_INT };
+            return ops[variant];
+        }
+        case OTOR_DIV:
+            return OP_DIV_INT;
+        default:
+            break;
+    }
+
+    return OP_RETURN; // Unreachable
+}
 
-bool compiler_generate_bytecode(Compiler *compiler, ASTNode *node)
+static uint8_t get_register_op_binary(ASTOperator operator, TypeKind kind)
 {
-    (void) compiler;
-    (void) node;
+    bool is_int = kind == TYPE_INT;
 
-    return false;
+    assert((COUNT_OTORS == 5) && "Exhaustive operators handling");
+    switch (operator) {
+        case OTOR_PLUS:
+            return is_int ? ROP_ADD_INT : ROP_ADD_REAL;
+        case OTOR_MINUS:
+            return is_int ? ROP_SUBTRACT_INT : ROP_SUBTRACT_REAL;
+        case OTOR_STAR:
+            return is_int ? ROP_MULTIPLY_INT : ROP_MULTIPLY_REAL;
+        case OTOR_SLASH:
+            return ROP_DIVIDE_REAL;
+        case OTOR_DIV:
+            return ROP_DIV_INT;
+        default:
+            break;
+    }
+
+    return ROP_RETURN; // Unreachable
+}
+
+
+// Groupings and unary plus produce no code of their own
+static ASTIndex unwrap_ast_expression(AST *ast, ASTIndex node)
+{
+    while (true) {
+        ASTExpressionKind kind = ast->kinds[node];
+        if (kind == AST_EXPR_GROUPING || (kind == AST_EXPR_UNARY && ast->operators[node] == OTOR_PLUS)) {
+            node = ast->firsts[node];
+        } else {
+            return node;
+        }
+    }
+}
+
+// Chained field accesses collapse into one access of the innermost object at the summed offset
+static ASTIndex resolve_field_access(AST *ast, ASTIndex node, size_t *offset)
+{
+    *offset = 0;
+    node = unwrap_ast_expression(ast, node);
+    while (ast->kinds[node] == AST_EXPR_FIELD) {
+        *offset += ast->extra[ast->seconds[node] + AST_FIELD_OFFSET];
+        node = unwrap_ast_expression(ast, ast->firsts[node]);
+    }
+
+    return node;
+}
+
+static bool needs_promotion(AST *ast, ASTIndex node, TypeKind kind)
+{
+    return kind == TYPE_REAL && is_skard_type_of_kind(&ast->types[node], TYPE_INT);
+}
+
+
+static void ast_fold_node(AST *ast, ASTIndex node, Value value)
+{
+    ast->kinds[node] = AST_EXPR_VALUE;
+    ast->firsts[node] = ast_add_value(ast, value);
+    ast->seconds[node] = SKARD_AST_NONE;
+}
+
+// Computes what the instruction picked for the operator would, a constant zero divisor fails whatever the dividend
+static bool compiler_fold_binary(Compiler *compiler, ASTIndex node)
+{
+    AST *ast = &compiler->ast;
+    ASTOperator operator = ast->operators[node];
+    ASTIndex first = unwrap_ast_expression(ast, ast->firsts[node]);
+    ASTIndex second = unwrap_ast_expression(ast, ast->seconds[node]);
+    bool is_second_constant = ast->kinds[second] == AST_EXPR_VALUE;
+
+    if (operator == OTOR_DIV && is_second_constant && ast->values[ast->firsts[second]].as.sk_int == 0) {
+        compiler_generate_error(compiler, node, "Integer division by zero.");
+        return false;
+    }
+    if (ast->kinds[first] != AST_EXPR_VALUE || !is_second_constant) {
+        return true;
+    }
+
+    TypeKind operand_kind = get_operand_kind(operator, ast->types[node].kind);
+    bool is_int = operand_kind == TYPE_INT;
+    Value a = ast->values[ast->firsts[first]];
+    Value b = ast->values[ast->firsts[second]];
+    if (needs_promotion(ast, first, operand_kind)) {
+        a = vm_to_real(a);
+    }
+    if (needs_promotion(ast, second, operand_kind)) {
+        b = vm_to_real(b);
+    }
+
+    Value value;
+    assert((COUNT_OTORS == 5) && "Exhaustive operators handling");
+    switch (operator) {
+        case OTOR_PLUS:
+            value = is_int ? vm_add_int(a, b) : vm_add_real(a, b);
+            break;
+        case OTOR_MINUS:
+            value = is_int ? vm_subtract_int(a, b) : vm_subtract_real(a, b);
+            break;
+        case OTOR_STAR:
+            value = is_int ? vm_multiply_int(a, b) : vm_multiply_real(a, b);
+            break;
+        case OTOR_SLASH:
+            value = vm_divide_real(a, b);
+            break;
+        case OTOR_DIV:
+            value = vm_div_int(a, b);
+            break;
+        default:
+            return true; // Unreachable
+    }
+
+    ast_fold_node(ast, node, value);
+    return true;
+}
+
+// Children come before their parents, so one forward pass folds constant subtrees bottom up. Groupings and unary
+// plus are left in place, the parents look through them. Native calls are never folded, hosts may rely on them
+// running.
+static bool compiler_fold_constants(Compiler *compiler)
+{
+    AST *ast = &compiler->ast;
+    for (ASTIndex node = 0; node < ast->count; node++) {
+        ASTExpressionKind kind = ast->kinds[node];
+        if (kind == AST_EXPR_BINARY) {
+            if (!compiler_fold_binary(compiler, node)) {
+                return false;
+            }
+        } else if (kind == AST_EXPR_UNARY && ast->operators[node] == OTOR_MINUS) {
+            ASTIndex child = unwrap_ast_expression(ast, ast->firsts[node]);
+            if (ast->kinds[child] == AST_EXPR_VALUE) {
+                Value value = ast->values[ast->firsts[child]];
+                bool is_int = is_skard_type_of_kind(&ast->types[node], TYPE_INT);
+                ast_fold_node(ast, node, is_int ? vm_negate_int(value) : vm_negate_real(value));
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// Literal operands are promoted at compile time, anything else is left for the operation to promote. The kind the
+// operand has on the stack is stored into pushed.
+static bool compiler_generate_stack_operand(Compiler *compiler, ASTIndex node, TypeKind kind, TypeKind *pushed)
+{
+    AST *ast = &compiler->ast;
+    node = unwrap_ast_expression(ast, node);
+    *pushed = ast->types[node].kind;
+
+    if (needs_promotion(ast, node, kind) && ast->kinds[node] == AST_EXPR_VALUE) {
+        Value value = convert_value_to_real(ast->values[ast->firsts[node]]);
+        ASTSpan span = ast->spans[node];
+        chunk_write_op_constant(compiler->chunk, value, span.line, span.column);
+        *pushed = TYPE_REAL;
+        return true;
+    }
+
+    return compiler_generate_stack_expression(compiler, node);
+}
+
+static bool compiler_generate_stack_expression(Compiler *compiler, ASTIndex node)
+{
+    AST *ast = &compiler->ast;
+    node = unwrap_ast_expression(ast, node);
+    TypeKind kind = ast->types[node].kind;
+    ASTSpan span = ast->spans[node];
+
+    assert((COUNT_AST_EXPRS == 8) && "Exhaustive expression kinds handling");
+    switch (ast->kinds[node]) {
+        case AST_EXPR_VALUE:
+            chunk_write_op_constant(compiler->chunk, ast->values[ast->firsts[node]], span.line, span.column);
+            return true;
+        case AST_EXPR_UNARY: {
+            if (!compiler_generate_stack_expression(compiler, ast->firsts[node])) {
+                return false;
+            }
+            uint8_t op = kind == TYPE_INT ? OP_NEGATE_INT : OP_NEGATE_REAL;
+            chunk_write_byte(compiler->chunk, op, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_BINARY: {
+            ASTOperator operator = ast->operators[node];
+            TypeKind operand_kind = get_operand_kind(operator, kind);
+            TypeKind first;
+            TypeKind second;
+            if (!compiler_generate_stack_operand(compiler, ast->firsts[node], operand_kind, &first) ||
+                !compiler_generate_stack_operand(compiler, ast->seconds[node], operand_kind, &second)) {
+                return false;
+            }
+
+            uint8_t op = get_stack_op_binary(operator, first, second);
+            chunk_write_byte(compiler->chunk, op, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_STRUCT: {
+            size_t fields = ast->firsts[node] + AST_STRUCT_FIELDS;
+            for (size_t i = 0; i < ast->seconds[node]; i++) {
+                if (!compiler_generate_stack_expression(compiler, ast->extra[fields + 2 * i + 1])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case AST_EXPR_FIELD: {
+            size_t offset;
+            ASTIndex object = resolve_field_access(ast, node, &offset);
+            if (!compiler_generate_stack_expression(compiler, object)) {
+                return false;
+            }
+
+            size_t size = skard_type_size(&ast->types[object]);
+            size_t field_size = skard_type_size(&ast->types[node]);
+            if (size != field_size) {
+                uint8_t instruction[] = { OP_GET_FIELD, size, offset, field_size };
+                chunk_write_instruction(compiler->chunk, instruction, sizeof(instruction), span.line, span.column);
+            }
+            return true;
+        }
+        case AST_EXPR_YIELD: {
+            if (!compiler_generate_stack_expression(compiler, ast->firsts[node])) {
+                return false;
+            }
+            uint8_t op = kind == TYPE_INT ? OP_YIELD_INT : OP_YIELD_REAL;
+            chunk_write_byte(compiler->chunk, op, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_CALL: {
+            size_t list = ast->firsts[node];
+            size_t arguments_count = ast->seconds[node];
+            uint32_t native_index = ast->extra[list + AST_CALL_NATIVE];
+            const NativeFunction *native = &compiler->options.natives->functions[native_index];
+            for (size_t i = 0; i < arguments_count; i++) {
+                TypeKind pushed;
+                if (!compiler_generate_stack_operand(compiler, ast->extra[list + AST_CALL_ARGUMENTS + i],
+                                                     native->parameters[i], &pushed)) {
+                    return false;
+                }
+            }
+            uint8_t instruction[] = { OP_CALL_NATIVE, native_index, arguments_count };
+            chunk_write_instruction(compiler->chunk, instruction, sizeof(instruction), span.line, span.column);
+            return true;
+        }
+        default:
+            break;
+    }
+
+    compiler_generate_error(compiler, node, "Unknown expression kind.");
+    return false;
+}
+
+static bool compiler_generate_stack(Compiler *compiler, ASTIndex root)
+{
+    if (!compiler_generate_stack_expression(compiler, root)) {
+        return false;
+    }
+
+    ASTSpan span = compiler->ast.spans[root];
+    compiler_finish_stack(compiler, compiler->ast.types[root].kind, span.line, span.column);
+    return true;
+}
+
+// Dumps the result left on the stack and returns, then fuses the whole chunk
+static void compiler_finish_stack(Compiler *compiler, TypeKind kind, size_t line, size_t column)
+{
+    // TODO: Replace with dump statements once statements are parsed
+    uint8_t dump = kind == TYPE_INT ? OP_DUMP_INT : OP_DUMP_REAL;
+    chunk_write_byte(compiler->chunk, dump, line, column);
+    chunk_write_byte(compiler->chunk, OP_RETURN, line, column);
+
+    if (compiler->options.fusions != NULL) {
+        optimizer_fuse_superinstructions(compiler->chunk, compiler->options.fusions);
+    }
+}
+
+
+static bool compiler_reserve_register(Compiler *compiler, ASTIndex node, size_t target)
+{
+    if (target >= SKARD_MAX_REGISTERS) {
+        compiler_generate_error(compiler, node, "Expression needs too many registers.");
+        return false;
+    }
+
+    if (compiler->registers_count < target + 1) {
+        compiler->registers_count = target + 1;
+    }
+    return true;
+}
+
+// Produces an RK operand of the given kind for the node, small constants are addressed directly and never loaded
+static bool compiler_generate_register_operand(Compiler *compiler, ASTIndex node, size_t target, TypeKind kind,
+                                               uint8_t *operand)
+{
+    AST *ast = &compiler->ast;
+    node = unwrap_ast_expression(ast, node);
+
+    if (ast->kinds[node] == AST_EXPR_VALUE) {
+        Value value = ast->values[ast->firsts[node]];
+        if (needs_promotion(ast, node, kind)) {
+            value = convert_value_to_real(value);
+        }
+        // Constants already pooled below the limit stay addressable after the pool has outgrown it
+        size_t index;
+        bool is_pooled = chunk_find_constant(compiler->chunk, value, &index);
+        if (is_pooled ? index < SKARD_MAX_RK_CONSTANTS
+                      : compiler->chunk->constants.count < SKARD_MAX_RK_CONSTANTS) {
+            index = chunk_add_constant(compiler->chunk, value);
+            *operand = index | SKARD_RK_CONSTANT_FLAG;
+            return true;
+        }
+    }
+
+    if (!compiler_generate_register_expression(compiler, node, target)) {
+        return false;
+    }
+    if (needs_promotion(ast, node, kind)) {
+        ASTSpan span = ast->spans[node];
+        chunk_write_register_instruction(compiler->chunk, ROP_TO_REAL, target, target, 0, span.line, span.column);
+    }
+    *operand = target;
+    return true;
+}
+
+static bool compiler_generate_register_expression(Compiler *compiler, ASTIndex node, size_t target)
+{
+    AST *ast = &compiler->ast;
+    size_t size = skard_type_size(&ast->types[node]);
+    if (!compiler_reserve_register(compiler, node, target + size - 1)) {
+        return false;
+    }
+
+    node = unwrap_ast_expression(ast, node);
+    TypeKind kind = ast->types[node].kind;
+    ASTSpan span = ast->spans[node];
+
+    assert((COUNT_AST_EXPRS == 8) && "Exhaustive expression kinds handling");
+    switch (ast->kinds[node]) {
+        case AST_EXPR_VALUE:
+            chunk_write_register_constant(compiler->chunk, target, ast->values[ast->firsts[node]],
+                                          span.line, span.column);
+            return true;
+        case AST_EXPR_UNARY: {
+            uint8_t child;
+            if (!compiler_generate_register_operand(compiler, ast->firsts[node], target, kind, &child)) {
+                return false;
+            }
+            uint8_t op = kind == TYPE_INT ? ROP_NEGATE_INT : ROP_NEGATE_REAL;
+            chunk_write_register_instruction(compiler->chunk, op, target, child, 0, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_BINARY: {
+            ASTOperator operator = ast->operators[node];
+            TypeKind operand_kind = get_operand_kind(operator, kind);
+            uint8_t first;
+            uint8_t second;
+            if (!compiler_generate_register_operand(compiler, ast->firsts[node], target, operand_kind, &first) ||
+                !compiler_generate_register_operand(compiler, ast->seconds[node], target + 1, operand_kind,
+                                                    &second)) {
+                return false;
+            }
+
+            uint8_t op = get_register_op_binary(operator, operand_kind);
+            chunk_write_register_instruction(compiler->chunk, op, target, first, second, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_STRUCT: {
+            // Fields occupy consecutive registers starting at the target
+            size_t list = ast->firsts[node];
+            StructLayout *layout = ast->layouts[ast->extra[list + AST_STRUCT_LAYOUT]];
+            for (size_t i = 0; i < ast->seconds[node]; i++) {
+                size_t field_target = target + layout->fields[i].offset;
+                ASTIndex value = ast->extra[list + AST_STRUCT_FIELDS + 2 * i + 1];
+                if (!compiler_generate_register_expression(compiler, value, field_target)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case AST_EXPR_FIELD: {
+            size_t offset;
+            ASTIndex object = resolve_field_access(ast, node, &offset);
+            if (!compiler_generate_register_expression(compiler, object, target)) {
+                return false;
+            }
+
+            size_t field_size = skard_type_size(&ast->types[node]);
+            for (size_t i = 0; offset != 0 && i < field_size; i++) {
+                chunk_write_register_instruction(compiler->chunk, ROP_MOVE, target + i, target + offset + i, 0,
+                                                 span.line, span.column);
+            }
+            return true;
+        }
+        case AST_EXPR_YIELD: {
+            if (!compiler_generate_register_expression(compiler, ast->firsts[node], target)) {
+                return false;
+            }
+            uint8_t op = kind == TYPE_INT ? ROP_YIELD_INT : ROP_YIELD_REAL;
+            chunk_write_register_instruction(compiler->chunk, op, target, 0, 0, span.line, span.column);
+            return true;
+        }
+        case AST_EXPR_CALL: {
+            // Arguments occupy consecutive registers starting at the target, the result replaces the first one
+            size_t list = ast->firsts[node];
+            size_t arguments_count = ast->seconds[node];
+            uint32_t native_index = ast->extra[list + AST_CALL_NATIVE];
+            const NativeFunction *native = &compiler->options.natives->functions[native_index];
+            for (size_t i = 0; i < arguments_count; i++) {
+                ASTIndex argument = unwrap_ast_expression(ast, ast->extra[list + AST_CALL_ARGUMENTS + i]);
+                if (!needs_promotion(ast, argument, native->parameters[i])) {
+                    if (!compiler_generate_register_expression(compiler, argument, target + i)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (!compiler_reserve_register(compiler, argument, target + i)) {
+                    return false;
+                }
+                Value value = convert_value_to_real(ast->values[ast->firsts[argument]]);
+                ASTSpan argument_span = ast->spans[argument];
+                chunk_write_register_constant(compiler->chunk, target + i, value, argument_span.line,
+                                              argument_span.column);
+            }
+            chunk_write_register_instruction(compiler->chunk, ROP_CALL_NATIVE, target, arguments_count,
+                                             native_index, span.line, span.column);
+            return true;
+        }
+        default:
+            break;
+    }
+
+    compiler_generate_error(compiler, node, "Unknown expression kind.");
+    return false;
+}
+
+static bool compiler_generate_register(Compiler *compiler, ASTIndex root)
+{
+    compiler->registers_count = 0;
+    if (!compiler_generate_register_expression(compiler, root, 0)) {
+        return false;
+    }
+
+    // TODO: Replace with dump statements once statements are parsed
+    ASTSpan span = compiler->ast.spans[root];
+    uint8_t dump = is_skard_type_of_kind(&compiler->ast.types[root], TYPE_INT) ? ROP_DUMP_INT : ROP_DUMP_REAL;
+    chunk_write_register_instruction(compiler->chunk, dump, 0, 0, 0, span.line, span.column);
+    chunk_write_register_instruction(compiler->chunk, ROP_RETURN, 0, 0, 0, span.line, span.column);
+    compiler->chunk->registers_count = compiler->registers_count;
+    return true;
+}
+
+
+bool compiler_generate_bytecode(Compiler *compiler, ASTIndex root)
+{
+    compiler->chunk->format = compiler->options.format;
+
+    bool result = false;
+    assert((COUNT_CHUNK_FORMATS == 2) && "Exhaustive chunk formats handling");
+    switch (compiler->options.format) {
+        case CHUNK_FORMAT_STACK:
+            result = compiler_generate_stack(compiler, root);
+            break;
+        case CHUNK_FORMAT_REGISTER:
+            result = compiler_generate_register(compiler, root);
+            break;
+        default:
+            break;
+    }
+
+    return result && chunk_verify(compiler->chunk);
+}
+
+
+static TypedOperand *compiler_push_operand(Compiler *compiler, SkardType type, Token *token);
+static void compiler_push_literal(Compiler *compiler, Value value, SkardType type, Token *token);
+static TypedOperand *compiler_peek_operand(Compiler *compiler, size_t distance);
+static void compiler_flush_operand(Compiler *compiler, TypeKind kind);
+
+static const EmitRule *get_emit_rule(TokenType type);
+
+static void compiler_emit_precedence(Compiler *compiler, Precedence precedence);
+static void compiler_emit_expression(Compiler *compiler);
+static void compiler_emit_grouping(Compiler *compiler);
+static void compiler_emit_binary(Compiler *compiler);
+static void compiler_emit_unary(Compiler *compiler);
+static void compiler_emit_struct(Compiler *compiler);
+static void compiler_emit_field(Compiler *compiler);
+static void compiler_emit_yield(Compiler *compiler);
+static void compiler_emit_call(Compiler *compiler);
+static void compiler_emit_real(Compiler *compiler);
+static void compiler_emit_int(Compiler *compiler);
+
+
+static TypedOperand *compiler_push_operand(Compiler *compiler, SkardType type, Token *token)
+{
+    if (compiler->operands_capacity < compiler->operands_count + 1) {
+        compiler->operands_capacity = SKARD_GROW_CAPACITY(compiler->operands_capacity);
+        compiler->operands = SKARD_GROW_ARRAY(TypedOperand, compiler->operands, compiler->operands_capacity);
+    }
+
+    TypedOperand *operand = &compiler->operands[compiler->operands_count++];
+    operand->type = type;
+    operand->is_pending = false;
+    operand->line = token->line;
+    operand->column = token->column;
+    return operand;
+}
+
+static void compiler_push_literal(Compiler *compiler, Value value, SkardType type, Token *token)
+{
+    TypedOperand *operand = compiler_push_operand(compiler, type, token);
+    operand->is_pending = true;
+    operand->value = value;
+}
+
+static TypedOperand *compiler_peek_operand(Compiler *compiler, size_t distance)
+{
+    return &compiler->operands[compiler->operands_count - 1 - distance];
+}
+
+// Writes the literal on top of the operand stack unless that already happened, an Int literal consumed as a Real is
+// promoted on the way
+static void compiler_flush_operand(Compiler *compiler, TypeKind kind)
+{
+    TypedOperand *operand = compiler_peek_operand(compiler, 0);
+    if (!operand->is_pending) {
+        return;
+    }
+
+    if (kind == TYPE_REAL && is_skard_type_of_kind(&operand->type, TYPE_INT)) {
+        operand->value = vm_to_real(operand->value);
+        operand->type = make_skard_type_real();
+    }
+    chunk_write_op_constant(compiler->chunk, operand->value, operand->line, operand->column);
+    operand->is_pending = false;
+}
+
+
+static const EmitRule emit_rules[] = {
+    [TOKEN_EOF] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_EOL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_ERROR] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LEFT_PAREN] = { .prefix = compiler_emit_grouping, .infix = NULL },
+    [TOKEN_RIGHT_PAREN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LEFT_BRACE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_RIGHT_BRACE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_RIGHT_BRACKET] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LEFT_BRACKET] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_DOT] = { .prefix = NULL, .infix = compiler_emit_field },
+    [TOKEN_COMMA] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_COLON] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_PLUS] = { .prefix = compiler_emit_unary, .infix = compiler_emit_binary },
+    [TOKEN_PLUS_ASSIGN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_MINUS] = { .prefix = compiler_emit_unary, .infix = compiler_emit_binary },
+    [TOKEN_MINUS_ASSIGN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_RIGHT_ARROW] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_STAR] = { .prefix = NULL, .infix = compiler_emit_binary },
+    [TOKEN_STAR_ASSIGN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_SLASH] = { .prefix = NULL, .infix = compiler_emit_binary },
+    [TOKEN_SLASH_ASSIGN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_AT] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_NOT] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_NOT_EQUAL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_ASSIGN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_EQUAL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_GREATER] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_GREATER_EQUAL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LESS] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LESS_EQUAL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_DIV] = { .prefix = NULL, .infix = compiler_emit_binary },
+    [TOKEN_PIPE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_OR] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_AND] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_PACKAGE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_IMPORT] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_STRUCT] = { .prefix = compiler_emit_struct, .infix = NULL },
+    [TOKEN_KEY_SELF] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_LET] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_NIL] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_FN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_RETURN] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_IF] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_ELSE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_WHILE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_FOR] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_TRUE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_FALSE] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_MATCH] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_WITH] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_DUMP] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_KEY_YIELD] = { .prefix = compiler_emit_yield, .infix = NULL },
+    [TOKEN_IDENTIFIER] = { .prefix = compiler_emit_call, .infix = NULL },
+    [TOKEN_LIT_STRING] = { .prefix = NULL, .infix = NULL },
+    [TOKEN_LIT_REAL] = { .prefix = compiler_emit_real, .infix = NULL },
+    [TOKEN_LIT_INT] = { .prefix = compiler_emit_int, .infix = NULL },
+};
+
+
+static const EmitRule *get_emit_rule(TokenType type)
+{
+    assert(COUNT_TOKENS == 56);
+    return &emit_rules[type];
+}
+
+
+// Same grammar as compiler_parse_precedence, every rule leaves exactly one operand for its expression
+static void compiler_emit_precedence(Compiler *compiler, Precedence precedence)
+{
+    compiler_advance(compiler);
+    EmitFn prefix_rule = get_emit_rule(compiler->previous.type)->prefix;
+    if (prefix_rule == NULL) {
+        compiler_parse_error_at_previous(compiler, "Expected expression.");
+        compiler_push_operand(compiler, make_skard_type_invalid(), &compiler->previous);
+        return;
+    }
+
+    prefix_rule(compiler);
+
+    while (precedence <= get_parse_rule(compiler->current.type)->precedence) {
+        compiler_advance(compiler);
+        EmitFn infix_rule = get_emit_rule(compiler->previous.type)->infix;
+        if (infix_rule == NULL) {
+            compiler_parse_error_at_previous(compiler, "Unsupported operator.");
+            break;
+        }
+        infix_rule(compiler);
+    }
+}
+
+static void compiler_emit_expression(Compiler *compiler)
+{
+    compiler_emit_precedence(compiler, PREC_ASSIGNMENT);
+}
+
+static void compiler_emit_grouping(Compiler *compiler)
+{
+    compiler_emit_expression(compiler);
+    compiler_consume(compiler, TOKEN_RIGHT_PAREN, "Expected ')' after expression.");
+}
+
+// The left operand is written before the right one is parsed, only the right one can still be promoted at compile time
+static void compiler_emit_binary(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    ASTOperator operator = get_binary_operator(token.type);
+    compiler_flush_operand(compiler, TYPE_UNKNOWN);
+    compiler_emit_precedence(compiler, (Precedence) (get_parse_rule(token.type)->precedence + 1));
+
+    TypedOperand *first = compiler_peek_operand(compiler, 1);
+    TypedOperand *second = compiler_peek_operand(compiler, 0);
+    SkardType type = make_skard_type_invalid();
+    if (!is_skard_type_invalid(&first->type) && !is_skard_type_invalid(&second->type)) {
+        type = get_infer_rule(operator)->binary(compiler, &first->type, &second->type);
+    }
+
+    if (!is_skard_type_invalid(&type)) {
+        if (operator == OTOR_DIV && second->is_pending && second->value.as.sk_int == 0) {
+            compiler_error_at(compiler, token.line, token.column, "Integer division by zero.");
+        }
+        compiler_flush_operand(compiler, get_operand_kind(operator, type.kind));
+        uint8_t op = get_stack_op_binary(operator, first->type.kind, second->type.kind);
+        chunk_write_byte(compiler->chunk, op, token.line, token.column);
+    }
+
+    compiler->operands_count -= 2;
+    compiler_push_operand(compiler, type, &token);
+}
+
+// Unary plus produces no code and leaves a literal operand pending
+static void compiler_emit_unary(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    ASTOperator operator = get_unary_operator(token.type);
+    compiler_emit_precedence(compiler, PREC_UNARY);
+
+    TypedOperand *child = compiler_peek_operand(compiler, 0);
+    if (is_skard_type_invalid(&child->type)) {
+        return;
+    }
+
+    SkardType type = get_infer_rule(operator)->unary(compiler, &child->type);
+    if (is_skard_type_invalid(&type) || operator == OTOR_PLUS) {
+        child->type = type;
+        child->line = token.line;
+        child->column = token.column;
+        return;
+    }
+
+    compiler_flush_operand(compiler, TYPE_UNKNOWN);
+    uint8_t op = type.kind == TYPE_INT ? OP_NEGATE_INT : OP_NEGATE_REAL;
+    chunk_write_byte(compiler->chunk, op, token.line, token.column);
+
+    compiler->operands_count--;
+    compiler_push_operand(compiler, type, &token);
+}
+
+// Fields are left on the stack in declaration order, the layout grows as they are parsed
+static void compiler_emit_struct(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    uint32_t layout_index = ast_add_layout(compiler);
+    StructLayout *layout = compiler->ast.layouts[layout_index];
+    bool is_valid = true;
+
+    compiler_consume(compiler, TOKEN_LEFT_BRACE, "Expected '{' after 'struct'.");
+    do {
+        compiler_consume(compiler, TOKEN_IDENTIFIER, "Expected field name.");
+        Token name = compiler->previous;
+        compiler_consume(compiler, TOKEN_ASSIGN, "Expected '=' after field name.");
+        compiler_emit_expression(compiler);
+        compiler_flush_operand(compiler, TYPE_UNKNOWN);
+
+        SkardType field_type = compiler_peek_operand(compiler, 0)->type;
+        compiler->operands_count--;
+        if (is_valid && is_skard_type_invalid(&field_type)) {
+            is_valid = false;
+        } else if (is_valid && !struct_layout_add_field(layout, name.start, name.length, field_type)) {
+            fprintf(stderr, "ERROR: Duplicate field '%.*s' in struct.\n", (int) name.length, name.start);
+            is_valid = false;
+        }
+
+        if (compiler->current.type != TOKEN_COMMA) {
+            break;
+        }
+        compiler_advance(compiler);
+    } while (compiler->current.type != TOKEN_RIGHT_BRACE && !compiler->is_panic);
+    compiler_consume(compiler, TOKEN_RIGHT_BRACE, "Expected '}' after struct fields.");
+
+    if (is_valid && layout->size > SKARD_MAX_STRUCT_SIZE) {
+        fprintf(stderr, "ERROR: Struct of %zu values exceeds the limit of %d values.\n",
+                layout->size, SKARD_MAX_STRUCT_SIZE);
+        is_valid = false;
+    }
+
+    compiler_push_operand(compiler, is_valid ? make_skard_type_struct(layout) : make_skard_type_invalid(), &token);
+}
+
+// Chained accesses narrow the struct one step at a time
+static void compiler_emit_field(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    compiler_consume(compiler, TOKEN_IDENTIFIER, "Expected field name after '.'.");
+    Token name = compiler->previous;
+    compiler_flush_operand(compiler, TYPE_UNKNOWN);
+
+    TypedOperand *object = compiler_peek_operand(compiler, 0);
+    if (is_skard_type_invalid(&object->type)) {
+        return;
+    }
+
+    if (!is_skard_type_of_kind(&object->type, TYPE_STRUCT)) {
+        fprintf(stderr, "ERROR: Data type '%s' has no field '%.*s'.\n",
+                skard_type_translate(&object->type), (int) name.length, name.start);
+        object->type = make_skard_type_invalid();
+        return;
+    }
+
+    StructField *field = struct_layout_find_field(object->type.layout, name.start, name.length);
+    if (field == NULL) {
+        fprintf(stderr, "ERROR: Struct has no field '%.*s'.\n", (int) name.length, name.start);
+        object->type = make_skard_type_invalid();
+        return;
+    }
+
+    size_t size = skard_type_size(&object->type);
+    size_t field_size = skard_type_size(&field->type);
+    if (size != field_size) {
+        uint8_t instruction[] = { OP_GET_FIELD, size, field->offset, field_size };
+        chunk_write_instruction(compiler->chunk, instruction, sizeof(instruction), token.line, token.column);
+    }
+
+    compiler->operands_count--;
+    compiler_push_operand(compiler, copy_skard_type(&field->type), &token);
+}
+
+static void compiler_emit_yield(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    compiler_emit_expression(compiler);
+    compiler_flush_operand(compiler, TYPE_UNKNOWN);
+
+    TypedOperand *child = compiler_peek_operand(compiler, 0);
+    if (is_skard_type_invalid(&child->type)) {
+        return;
+    }
+
+    if (!is_skard_type_of_kind(&child->type, TYPE_INT) && !is_skard_type_of_kind(&child->type, TYPE_REAL)) {
+        fprintf(stderr, "ERROR: Cannot yield a value of data type '%s'.\n", skard_type_translate(&child->type));
+        child->type = make_skard_type_invalid();
+        return;
+    }
+
+    SkardType type = child->type;
+    uint8_t op = type.kind == TYPE_INT ? OP_YIELD_INT : OP_YIELD_REAL;
+    chunk_write_byte(compiler->chunk, op, token.line, token.column);
+
+    compiler->operands_count--;
+    compiler_push_operand(compiler, type, &token);
+}
+
+// The native is looked up before the arguments so Int literals can be promoted for Real parameters, errors are
+// reported in the order compiler_infer_type_call checks them
+static void compiler_emit_call(Compiler *compiler)
+{
+    Token token = compiler->previous;
+    size_t index = 0;
+    const NativeFunction *native = NULL;
+    if (compiler->options.natives != NULL) {
+        native = native_registry_find(compiler->options.natives, token.start, token.length, &index);
+    }
+
+    size_t arguments_count = 0;
+    bool is_failed = false;
+    size_t failed_argument = 0;
+    SkardType failed_type = make_skard_type_invalid();
+
+    compiler_consume(compiler, TOKEN_LEFT_PAREN, "Expected '(' after function name.");
+    while (compiler->current.type != TOKEN_RIGHT_PAREN && !compiler->is_panic) {
+        compiler_emit_expression(compiler);
+        bool has_parameter = native != NULL && arguments_count < native->arity;
+        TypeKind parameter = has_parameter ? native->parameters[arguments_count] : TYPE_UNKNOWN;
+        compiler_flush_operand(compiler, parameter);
+
+        SkardType argument_type = compiler_peek_operand(compiler, 0)->type;
+        compiler->operands_count--;
+        if (!is_failed && has_parameter &&
+            (is_skard_type_invalid(&argument_type) || !is_skard_type_of_kind(&argument_type, parameter))) {
+            is_failed = true;
+            failed_argument = arguments_count;
+            failed_type = argument_type;
+        }
+        arguments_count++;
+
+        if (compiler->current.type != TOKEN_COMMA) {
+            break;
+        }
+        compiler_advance(compiler);
+    }
+    compiler_consume(compiler, TOKEN_RIGHT_PAREN, "Expected ')' after arguments.");
+
+    if (native == NULL) {
+        fprintf(stderr, "ERROR: Unknown function '%.*s'.\n", (int) token.length, token.start);
+        compiler_push_operand(compiler, make_skard_type_invalid(), &token);
+        return;
+    }
+
+    if (arguments_count != native->arity) {
+        fprintf(stderr, "ERROR: Function '%.*s' takes %zu arguments but %zu were given.\n",
+                (int) token.length, token.start, native->arity, arguments_count);
+        compiler_push_operand(compiler, make_skard_type_invalid(), &token);
+        return;
+    }
+
+    if (is_failed) {
+        if (!is_skard_type_invalid(&failed_type)) {
+            SkardType parameter_type = make_skard_type_simple(native->parameters[failed_argument]);
+            fprintf(stderr, "ERROR: Argument %zu of function '%.*s' has data type '%s', expected '%s'.\n",
+                    failed_argument + 1, (int) token.length, token.start, skard_type_translate(&failed_type),
+                    skard_type_translate(&parameter_type));
+        }
+        compiler_push_operand(compiler, make_skard_type_invalid(), &token);
+        return;
+    }
+
+    uint8_t instruction[] = { OP_CALL_NATIVE, index, arguments_count };
+    chunk_write_instruction(compiler->chunk, instruction, sizeof(instruction), token.line, token.column);
+    compiler_push_operand(compiler, make_skard_type_simple(native->result), &token);
+}
+
+static void compiler_emit_real(Compiler *compiler)
+{
+    SkReal sk_real = strtod(compiler->previous.start, NULL);
+    compiler_push_literal(compiler, make_value_real(sk_real), make_skard_type_real(), &compiler->previous);
+}
+
+static void compiler_emit_int(Compiler *compiler)
+{
+    SkInt sk_int = strtoll(compiler->previous.start, NULL, 10);
+    compiler_push_literal(compiler, make_value_int(sk_int), make_skard_type_int(), &compiler->previous);
+}
+
+
+// Parses and writes the chunk in one go, types are only tracked for the operands still waiting for their consumer
+static bool compiler_generate_single_pass(Compiler *compiler)
+{
+    compiler_release_ast(compiler);
+    compiler->operands_count = 0;
+    compiler->chunk->format = CHUNK_FORMAT_STACK;
+
+    compiler_advance(compiler);
+    compiler_emit_expression(compiler);
+    compiler_consume(compiler, TOKEN_EOF, "Expected end of expression.");
+    if (compiler->is_error) {
+        return false;
+    }
+
+    TypedOperand *result = compiler_peek_operand(compiler, 0);
+    if (!check_dumped_type(&result->type)) {
+        compiler->is_error = true;
+        return false;
+    }
+
+    compiler_flush_operand(compiler, TYPE_UNKNOWN);
+    compiler_finish_stack(compiler, result->type.kind, result->line, result->column);
+    return chunk_verify(compiler->chunk);
 }
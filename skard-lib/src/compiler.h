@@ -2,10 +2,14 @@
 #define SKARD_COMPILER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "lexer.h"
 #include "chunk.h"
 #include "value.h"
+#include "optimizer.h"
+#include "native.h"
+#include "arena.h"
 
 typedef enum {
     OTOR_PLUS,
@@ -18,64 +22,109 @@ typedef enum {
 
 const char *ast_operator_translate(ASTOperator operator);
 
-typedef struct {
-    Value value;
-} ASTExpressionValue;
-
-typedef struct {
-    struct ASTNode *child;
-    ASTOperator operator;
-} ASTExpressionUnary;
-
-typedef struct {
-    struct ASTNode *first;
-    struct ASTNode *second;
-    ASTOperator operator;
-} ASTExpressionBinary;
-
-typedef struct {
-    struct ASTNode *child;
-} ASTExpressionGrouping;
-
 typedef enum {
     AST_EXPR_VALUE,
     AST_EXPR_UNARY,
     AST_EXPR_BINARY,
     AST_EXPR_GROUPING,
+    AST_EXPR_STRUCT,
+    AST_EXPR_FIELD,
+    AST_EXPR_YIELD,
+    AST_EXPR_CALL,
     COUNT_AST_EXPRS,
 } ASTExpressionKind;
 
+// Nodes are rows of the AST columns, children always come before their parent
+typedef uint32_t ASTIndex;
+
+#define SKARD_AST_NONE UINT32_MAX
+#define SKARD_AST_MAX_NODES (UINT32_MAX - 1)
+
 typedef struct {
-    ASTExpressionKind kind;
-    SkardType type;
-    union {
-        ASTExpressionValue node_value;
-        ASTExpressionUnary node_unary;
-        ASTExpressionBinary node_binary;
-        ASTExpressionGrouping node_grouping;
-    } as;
-} ASTNodeExpression;
+    uint32_t line;
+    uint32_t column;
+} ASTSpan;
+
+// Operands by expression kind, lists live in extra:
+//   VALUE     first is the index in values
+//   UNARY     first is the child
+//   BINARY    first and second are the children
+//   GROUPING  first is the child
+//   STRUCT    first starts [layout, name, value, name, value, ...] in extra, second is the fields count
+//   FIELD     first is the object, second starts [name, offset] in extra
+//   YIELD     first is the child
+//   CALL      first starts [name, native, argument, ...] in extra, second is the arguments count
+// Layouts, field offsets and natives are resolved by the typechecker.
+typedef struct {
+    size_t count;
+    size_t capacity;
+    uint8_t *kinds;
+    uint8_t *operators;
+    SkardType *types;
+    ASTIndex *firsts;
+    ASTIndex *seconds;
+    ASTSpan *spans;
+
+    size_t values_count;
+    size_t values_capacity;
+    Value *values;
+    size_t names_count;
+    size_t names_capacity;
+    Token *names;
+    size_t extra_count;
+    size_t extra_capacity;
+    uint32_t *extra;
+    // Lists being parsed, a nested list is pushed above the one enclosing it and moved to extra once complete
+    size_t scratch_count;
+    size_t scratch_capacity;
+    uint32_t *scratch;
+    // Allocated from the compiler arena so types can point at them, their fields live on the heap
+    size_t layouts_count;
+    size_t layouts_capacity;
+    StructLayout **layouts;
+} AST;
+
+void ast_node_print(AST *ast, ASTIndex node, bool end_line);
 
 typedef enum {
-    AST_NODE_EXPRESSION,
-    COUNT_AST_NODES,
-} ASTNodeKind;
+    COMPILE_MODE_AST,
+    // Emits while parsing and skips the AST, meant for short expressions. Only stack chunks are emitted this way,
+    // register chunks still go through the AST.
+    COMPILE_MODE_SINGLE_PASS,
+    COUNT_COMPILE_MODES,
+} CompileMode;
 
 typedef struct {
-    ASTNodeKind kind;
-    union {
-        ASTNodeExpression node_expression;
-    } as;
+    CompileMode mode;
+    ChunkFormat format;
+    const FusionSet *fusions;
+    // Host functions scripts may call, NULL allows none
+    const NativeRegistry *natives;
+} CompilerOptions;
+
+// Result of an expression the single pass has parsed
+typedef struct {
+    SkardType type;
+    // Literal not written yet, the consumer may still promote it
+    bool is_pending;
+    Value value;
     size_t line;
     size_t column;
-} ASTNode;
-
-void ast_node_free(ASTNode *node);
-
-void ast_node_print(ASTNode *node, bool end_line);
+} TypedOperand;
 
 typedef struct {
-    Lexer *lexer;
+    CompilerOptions options;
+    Lexer lexer;
+    // The columns keep their capacity from one compilation to the next
+    AST ast;
+    // Owns the struct layouts of the current compilation, they are released together once it is done
+    Arena arena;
+    // Types of the single pass, one entry per expression still waiting for its consumer
+    size_t operands_count;
+    size_t operands_capacity;
+    TypedOperand *operands;
+    Chunk *chunk;
+    size_t registers_count;
     Token current;
     Token previous;
     bool is_error;
@@ -96,8 +145,8 @@ typedef enum {
     PREC_PRIMARY
 } Precedence;
 
-typedef ASTNode *(*ParseFnPrefix)(Compiler *);
-typedef ASTNode *(*ParseFnInfix)(Compiler *, ASTNode *);
+typedef ASTIndex (*ParseFnPrefix)(Compiler *);
+typedef ASTIndex (*ParseFnInfix)(Compiler *, ASTIndex);
 
 typedef struct {
     ParseFnPrefix prefix;
@@ -105,6 +154,14 @@ typedef struct {
     Precedence precedence;
 } ParseRule;
 
+// Single pass counterparts of the parse functions, the infix ones find their left operand on the operand stack
+typedef void (*EmitFn)(Compiler *);
+
+typedef struct {
+    EmitFn prefix;
+    EmitFn infix;
+} EmitRule;
+
 typedef SkardType (*InferFnUnary)(Compiler *, SkardType *);
 typedef SkardType (*InferFnBinary)(Compiler *, SkardType *, SkardType *);
 
@@ -113,11 +170,14 @@ typedef struct {
     InferFnBinary binary;
 } InferRule;
 
+// Compilers share no state, one compiler per thread can compile concurrently
 void compiler_init(Compiler *compiler);
+void compiler_free(Compiler *compiler);
 
 bool compiler_compile_file(Compiler *compiler, const char *filename, Chunk *chunk);
 bool compiler_compile_source(Compiler *compiler, const char *source, Chunk *chunk);
-bool compiler_generate_ast(Compiler *compiler);
-bool compiler_generate_bytecode(Compiler *compiler, ASTNode *node);
+// Returns the root of compiler->ast or SKARD_AST_NONE, the AST stays valid until the next compilation or compiler_free
+ASTIndex compiler_generate_ast(Compiler *compiler);
+bool compiler_generate_bytecode(Compiler *compiler, ASTIndex root);
 
 #endif //SKARD_COMPILER_H
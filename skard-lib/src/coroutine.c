@@ -0,0 +1,80 @@
+#include "coroutine.h"
+
+#include <string.h>
+
+#include "utils.h"
+#include "verifier.h"
+
+bool coroutine_init(SkardCoroutine *coroutine, Chunk *chunk)
+{
+    coroutine->chunk = chunk;
+    coroutine->ip = NULL;
+    coroutine->stack_count = 0;
+    coroutine->stack_capacity = 0;
+    coroutine->stack = NULL;
+    coroutine->yielded = 0;
+    coroutine->yielded_kind = TYPE_UNKNOWN;
+    coroutine->is_finished = false;
+
+    if (!chunk->is_verified && !chunk_verify(chunk)) {
+        return false;
+    }
+
+    coroutine->stack_capacity = chunk->max_stack_depth;
+    coroutine->stack = SKARD_GROW_ARRAY(Value, NULL, coroutine->stack_capacity);
+    return true;
+}
+
+void coroutine_free(SkardCoroutine *coroutine)
+{
+    coroutine->stack = SKARD_FREE_ARRAY(Value, coroutine->stack);
+    coroutine->stack_capacity = 0;
+    coroutine->stack_count = 0;
+}
+
+static void copy_values(Value *destination, const Value *source, size_t count)
+{
+    if (count > 0) {
+        memcpy(destination, source, count * sizeof(Value));
+    }
+}
+
+InterpreterResult coroutine_resume(SkardCoroutine *coroutine, SkardVM *vm)
+{
+    if (coroutine->is_finished) {
+        return INTERPRETER_OK;
+    }
+
+    Chunk *chunk = coroutine->chunk;
+    InterpreterResult result;
+    if (coroutine->ip == NULL) {
+        result = vm_run(vm, chunk);
+    } else {
+        vm->chunk = chunk;
+        vm->ip = coroutine->ip;
+        vm_stack_reserve(&vm->stack, chunk->max_stack_depth);
+        copy_values(vm->stack.stack, coroutine->stack, coroutine->stack_count);
+        vm->stack.stack_top = vm->stack.stack + coroutine->stack_count;
+        result = vm_resume(vm);
+    }
+
+    // Generated code hands a yield over to the interpreter, so the VM has an instruction pointer here
+    if (result != INTERPRETER_YIELD && result != INTERPRETER_SUSPENDED) {
+        coroutine->is_finished = true;
+        return result;
+    }
+
+    coroutine->ip = vm->ip;
+    coroutine->stack_count = vm->stack.stack_top - vm->stack.stack;
+    copy_values(coroutine->stack, vm->stack.stack, coroutine->stack_count);
+    if (result == INTERPRETER_SUSPENDED) {
+        coroutine->yielded = vm->yielded - vm->stack.stack;
+        coroutine->yielded_kind = vm->yielded_kind;
+    }
+    return result;
+}
+
+Value *coroutine_yielded(SkardCoroutine *coroutine)
+{
+    return &coroutine->stack[coroutine->yielded];
+}
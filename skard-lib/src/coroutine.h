@@ -0,0 +1,36 @@
+#ifndef SKARD_COROUTINE_H
+#define SKARD_COROUTINE_H
+
+#include <stdbool.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+// Suspended run of a chunk. The frame keeps the instruction pointer and its own copy of the live stack segment, so
+// any number of coroutines can take turns on one VM and a resume only copies that segment back. The segment is
+// allocated up front to the verified stack depth of the chunk, yielding and resuming never allocate.
+typedef struct {
+    Chunk *chunk;
+    // NULL until the first resume
+    uint8_t *ip;
+    size_t stack_count;
+    size_t stack_capacity;
+    Value *stack;
+    // Slot and kind of the last yielded value, valid while the last resume returned INTERPRETER_SUSPENDED
+    size_t yielded;
+    TypeKind yielded_kind;
+    bool is_finished;
+} SkardCoroutine;
+
+// Returns false when the chunk does not verify
+bool coroutine_init(SkardCoroutine *coroutine, Chunk *chunk);
+void coroutine_free(SkardCoroutine *coroutine);
+
+// Runs the coroutine on the VM until it yields a value, spends the fuel of the VM or finishes. Finished coroutines
+// return INTERPRETER_OK from then on.
+InterpreterResult coroutine_resume(SkardCoroutine *coroutine, SkardVM *vm);
+
+// The last yielded value, whatever it holds on the next resume becomes the value of the yield expression
+Value *coroutine_yielded(SkardCoroutine *coroutine);
+
+#endif //SKARD_COROUTINE_H
@@ -3,23 +3,75 @@
 #include <stdio.h>
 #include <assert.h>
 
+static const char *op_names[COUNT_OPS] = {
+    [OP_RETURN] = "OP_RETURN",
+    [OP_DUMP_INT] = "OP_DUMP_INT",
+    [OP_DUMP_REAL] = "OP_DUMP_REAL",
+    [OP_CONSTANT] = "OP_CONSTANT",
+    [OP_CONSTANT_LONG] = "OP_CONSTANT_LONG",
+    [OP_NEGATE_INT] = "OP_NEGATE_INT",
+    [OP_NEGATE_REAL] = "OP_NEGATE_REAL",
+    [OP_ADD_INT] = "OP_ADD_INT",
+    [OP_ADD_REAL] = "OP_ADD_REAL",
+    [OP_ADD_INT_REAL] = "OP_ADD_INT_REAL",
+    [OP_ADD_REAL_INT] = "OP_ADD_REAL_INT",
+    [OP_SUBTRACT_INT] = "OP_SUBTRACT_INT",
+    [OP_SUBTRACT_REAL] = "OP_SUBTRACT_REAL",
+    [OP_SUBTRACT_INT_REAL] = "OP_SUBTRACT_INT_REAL",
+    [OP_SUBTRACT_REAL_INT] = "OP_SUBTRACT_REAL_INT",
+    [OP_MULTIPLY_INT] = "OP_MULTIPLY_INT",
+    [OP_MULTIPLY_REAL] = "OP_MULTIPLY_REAL",
+    [OP_MULTIPLY_INT_REAL] = "OP_MULTIPLY_INT_REAL",
+    [OP_MULTIPLY_REAL_INT] = "OP_MULTIPLY_REAL_INT",
+    [OP_DIVIDE_REAL] = "OP_DIVIDE_REAL",
+    [OP_DIVIDE_INT_REAL] = "OP_DIVIDE_INT_REAL",
+    [OP_DIVIDE_REAL_INT] = "OP_DIVIDE_REAL_INT",
+    [OP_DIVIDE_INT_INT] = "OP_DIVIDE_INT_INT",
+    [OP_DIV_INT] = "OP_DIV_INT",
+    [OP_GET_FIELD] = "OP_GET_FIELD",
+    [OP_YIELD_INT] = "OP_YIELD_INT",
+    [OP_YIELD_REAL] = "OP_YIELD_REAL",
+    [OP_CALL_NATIVE] = "OP_CALL_NATIVE",
+    [OP_CONSTANT_DUMP_INT] = "OP_CONSTANT_DUMP_INT",
+    [OP_CONSTANT_DUMP_REAL] = "OP_CONSTANT_DUMP_REAL",
+    [OP_ADD_CONSTANT_INT] = "OP_ADD_CONSTANT_INT",
+    [OP_ADD_CONSTANT_REAL] = "OP_ADD_CONSTANT_REAL",
+    [OP_SUBTRACT_CONSTANT_INT] = "OP_SUBTRACT_CONSTANT_INT",
+    [OP_SUBTRACT_CONSTANT_REAL] = "OP_SUBTRACT_CONSTANT_REAL",
+    [OP_MULTIPLY_CONSTANT_INT] = "OP_MULTIPLY_CONSTANT_INT",
+    [OP_MULTIPLY_CONSTANT_REAL] = "OP_MULTIPLY_CONSTANT_REAL",
+    [OP_DIVIDE_CONSTANT_REAL] = "OP_DIVIDE_CONSTANT_REAL",
+    [OP_DIV_CONSTANT_INT] = "OP_DIV_CONSTANT_INT",
+};
+
+const char *translate_op(uint8_t op)
+{
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+    if (op >= COUNT_OPS) {
+        return "UNKNOWN";
+    }
+
+    return op_names[op];
+}
+
+
 void disassemble_chunk(Chunk *chunk, const char *name)
 {
     printf("DISASSEMBLING CHUNK: %s\n", name);
-    printf("OFFSET |  LINE  | COLUMN |      OPCODE      | OPERAND | VALUE\n");
-    printf("-------------------------------------------------------------\n");
+    printf("OFFSET |  LINE  | COLUMN |        OPCODE        | OPERAND | VALUE\n");
+    printf("-----------------------------------------------------------------\n");
 
     size_t offset = 0;
     while (offset < chunk->count) {
         offset = disassemble_instruction(chunk, offset);
         printf("\n");
     }
-    printf("-------------------------------------------------------------\n");
+    printf("-----------------------------------------------------------------\n");
 }
 
 static void print_instruction_name(const char *name)
 {
-    printf("%-16s | ", name);
+    printf("%-20s | ", name);
 }
 
 static size_t disassemble_unknown_instruction(size_t offset)
@@ -43,6 +95,90 @@ static size_t disassemble_constant_instruction(const char *name, size_t offset,
     return offset + 2;
 }
 
+static size_t disassemble_field_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    printf("%03u/%03u | size %u", chunk->code[offset + 2], chunk->code[offset + 1], chunk->code[offset + 3]);
+    return offset + 4;
+}
+
+static size_t disassemble_native_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    printf("%07u | arity %u", chunk->code[offset + 1], chunk->code[offset + 2]);
+    return offset + 3;
+}
+
+static void print_register_operand(uint8_t operand)
+{
+    printf("R%03u", operand);
+}
+
+static void print_rk_operand(uint8_t operand)
+{
+    if (operand & SKARD_RK_CONSTANT_FLAG) {
+        printf("K%03u", operand & ~SKARD_RK_CONSTANT_FLAG);
+        return;
+    }
+    print_register_operand(operand);
+}
+
+static size_t disassemble_register_a_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    print_register_operand(chunk->code[offset + 1]);
+    return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
+static size_t disassemble_register_ab_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    print_register_operand(chunk->code[offset + 1]);
+    printf(" ");
+    print_rk_operand(chunk->code[offset + 2]);
+    return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
+static size_t disassemble_register_abc_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    print_register_operand(chunk->code[offset + 1]);
+    printf(" ");
+    print_rk_operand(chunk->code[offset + 2]);
+    printf(" ");
+    print_rk_operand(chunk->code[offset + 3]);
+    return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
+static size_t disassemble_register_native_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    print_register_operand(chunk->code[offset + 1]);
+    printf(" N%03u | arity %u", chunk->code[offset + 3], chunk->code[offset + 2]);
+    return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
+static size_t disassemble_register_constant_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    size_t index = chunk->code[offset + 2] | (chunk->code[offset + 3] << 8);
+    print_register_operand(chunk->code[offset + 1]);
+    printf(" K%07zu | ", index);
+    print_value(chunk->constants.values[index]);
+    return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
+static size_t disassemble_register_constant_long_instruction(const char *name, size_t offset, Chunk *chunk)
+{
+    print_instruction_name(name);
+    size_t extra = offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+    size_t index = chunk->code[extra] | (chunk->code[extra + 1] << 8) | (chunk->code[extra + 2] << 16);
+    print_register_operand(chunk->code[offset + 1]);
+    printf(" K%07zu | ", index);
+    print_value(chunk->constants.values[index]);
+    return extra + SKARD_REGISTER_INSTRUCTION_SIZE;
+}
+
 static size_t disassemble_constant_long_instruction(const char *name, size_t offset, Chunk *chunk)
 {
     print_instruction_name(name);
@@ -52,6 +188,144 @@ static size_t disassemble_constant_long_instruction(const char *name, size_t off
     return offset + 4;
 }
 
+static size_t disassemble_stack_instruction(Chunk *chunk, size_t offset)
+{
+    uint8_t byte = chunk->code[offset];
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+    switch (byte) {
+        case OP_RETURN:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DUMP_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DUMP_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_CONSTANT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_CONSTANT_LONG:
+            return disassemble_constant_long_instruction(translate_op(byte), offset, chunk);
+        case OP_NEGATE_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_NEGATE_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_ADD_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_ADD_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_ADD_INT_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_ADD_REAL_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_SUBTRACT_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_SUBTRACT_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_SUBTRACT_INT_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_SUBTRACT_REAL_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_MULTIPLY_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_MULTIPLY_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_MULTIPLY_INT_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_MULTIPLY_REAL_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DIVIDE_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DIVIDE_INT_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DIVIDE_REAL_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DIVIDE_INT_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_DIV_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_GET_FIELD:
+            return disassemble_field_instruction(translate_op(byte), offset, chunk);
+        case OP_YIELD_INT:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_YIELD_REAL:
+            return disassemble_simple_instruction(translate_op(byte), offset);
+        case OP_CALL_NATIVE:
+            return disassemble_native_instruction(translate_op(byte), offset, chunk);
+        case OP_CONSTANT_DUMP_INT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_CONSTANT_DUMP_REAL:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_ADD_CONSTANT_INT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_ADD_CONSTANT_REAL:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_SUBTRACT_CONSTANT_INT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_SUBTRACT_CONSTANT_REAL:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_MULTIPLY_CONSTANT_INT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_MULTIPLY_CONSTANT_REAL:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_DIVIDE_CONSTANT_REAL:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        case OP_DIV_CONSTANT_INT:
+            return disassemble_constant_instruction(translate_op(byte), offset, chunk);
+        default:
+            return disassemble_unknown_instruction(offset);
+    }
+}
+
+static size_t disassemble_register_instruction(Chunk *chunk, size_t offset)
+{
+    uint8_t byte = chunk->code[offset];
+    assert((COUNT_ROPS == 20) && "Exhaustive register ops handling");
+    switch (byte) {
+        case ROP_RETURN:
+            print_instruction_name("ROP_RETURN");
+            return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+        case ROP_DUMP_INT:
+            return disassemble_register_a_instruction("ROP_DUMP_INT", offset, chunk);
+        case ROP_DUMP_REAL:
+            return disassemble_register_a_instruction("ROP_DUMP_REAL", offset, chunk);
+        case ROP_CONSTANT:
+            return disassemble_register_constant_instruction("ROP_CONSTANT", offset, chunk);
+        case ROP_CONSTANT_LONG:
+            return disassemble_register_constant_long_instruction("ROP_CONSTANT_LONG", offset, chunk);
+        case ROP_NEGATE_INT:
+            return disassemble_register_ab_instruction("ROP_NEGATE_INT", offset, chunk);
+        case ROP_NEGATE_REAL:
+            return disassemble_register_ab_instruction("ROP_NEGATE_REAL", offset, chunk);
+        case ROP_ADD_INT:
+            return disassemble_register_abc_instruction("ROP_ADD_INT", offset, chunk);
+        case ROP_ADD_REAL:
+            return disassemble_register_abc_instruction("ROP_ADD_REAL", offset, chunk);
+        case ROP_SUBTRACT_INT:
+            return disassemble_register_abc_instruction("ROP_SUBTRACT_INT", offset, chunk);
+        case ROP_SUBTRACT_REAL:
+            return disassemble_register_abc_instruction("ROP_SUBTRACT_REAL", offset, chunk);
+        case ROP_MULTIPLY_INT:
+            return disassemble_register_abc_instruction("ROP_MULTIPLY_INT", offset, chunk);
+        case ROP_MULTIPLY_REAL:
+            return disassemble_register_abc_instruction("ROP_MULTIPLY_REAL", offset, chunk);
+        case ROP_DIVIDE_REAL:
+            return disassemble_register_abc_instruction("ROP_DIVIDE_REAL", offset, chunk);
+        case ROP_DIV_INT:
+            return disassemble_register_abc_instruction("ROP_DIV_INT", offset, chunk);
+        case ROP_TO_REAL:
+            return disassemble_register_ab_instruction("ROP_TO_REAL", offset, chunk);
+        case ROP_MOVE:
+            return disassemble_register_ab_instruction("ROP_MOVE", offset, chunk);
+        case ROP_YIELD_INT:
+            return disassemble_register_a_instruction("ROP_YIELD_INT", offset, chunk);
+        case ROP_YIELD_REAL:
+            return disassemble_register_a_instruction("ROP_YIELD_REAL", offset, chunk);
+        case ROP_CALL_NATIVE:
+            return disassemble_register_native_instruction("ROP_CALL_NATIVE", offset, chunk);
+        default:
+            print_instruction_name("UNKNOWN");
+            return offset + SKARD_REGISTER_INSTRUCTION_SIZE;
+    }
+}
+
 size_t disassemble_instruction(Chunk *chunk, size_t offset)
 {
     printf("%06zu | ", offset);
@@ -60,17 +334,12 @@ size_t disassemble_instruction(Chunk *chunk, size_t offset)
     printf("%06zu | ", line);
     printf("%06zu | ", column);
 
-    uint8_t byte = chunk->code[offset];
-    assert((COUNT_OPS == 4) && "Exhaustive ops handling");
-    switch (byte) {
-        case OP_RETURN:
-            return disassemble_simple_instruction("OP_RETURN", offset);
-        case OP_DUMP:
-            return disassemble_simple_instruction("OP_DUMP", offset);
-        case OP_CONSTANT:
-            return disassemble_constant_instruction("OP_CONSTANT", offset, chunk);
-        case OP_CONSTANT_LONG:
-            return disassemble_constant_long_instruction("OP_CONSTANT_LONG", offset, chunk);
+    assert((COUNT_CHUNK_FORMATS == 2) && "Exhaustive chunk formats handling");
+    switch (chunk->format) {
+        case CHUNK_FORMAT_STACK:
+            return disassemble_stack_instruction(chunk, offset);
+        case CHUNK_FORMAT_REGISTER:
+            return disassemble_register_instruction(chunk, offset);
         default:
             return disassemble_unknown_instruction(offset);
     }
@@ -6,4 +6,6 @@
 void disassemble_chunk(Chunk *chunk, const char *name);
 size_t disassemble_instruction(Chunk *chunk, size_t offset);
 
+const char *translate_op(uint8_t op);
+
 #endif //SKARD_DEBUG_H
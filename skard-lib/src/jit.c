@@ -0,0 +1,604 @@
+#include "jit.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "utils.h"
+
+#ifdef SKARD_JIT
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Generated code follows the System V calling convention: InterpreterResult (SkardVM *vm, Value *stack).
+// The stack top lives in rbx and the VM in r12 for the whole chunk, temporaries use rax, rcx and xmm0-1.
+typedef InterpreterResult (*JitFunction)(SkardVM *vm, Value *stack);
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    uint8_t *code;
+} JitBuffer;
+
+static void jit_buffer_init(JitBuffer *buffer)
+{
+    buffer->count = 0;
+    buffer->capacity = 0;
+    buffer->code = NULL;
+}
+
+static void jit_buffer_free(JitBuffer *buffer)
+{
+    SKARD_FREE_ARRAY(uint8_t, buffer->code);
+    jit_buffer_init(buffer);
+}
+
+static void emit_bytes(JitBuffer *buffer, const uint8_t *bytes, size_t count)
+{
+    while (buffer->capacity < buffer->count + count) {
+        buffer->capacity = SKARD_GROW_CAPACITY(buffer->capacity);
+        buffer->code = SKARD_GROW_ARRAY(uint8_t, buffer->code, buffer->capacity);
+    }
+    memcpy(buffer->code + buffer->count, bytes, count);
+    buffer->count += count;
+}
+
+#define SKARD_EMIT(buffer, ...) \
+    do { \
+        static const uint8_t bytes[] = { __VA_ARGS__ }; \
+        emit_bytes((buffer), bytes, sizeof(bytes)); \
+    } while (false)
+
+static void emit_imm64(JitBuffer *buffer, uint64_t imm)
+{
+    uint8_t bytes[8];
+    for (size_t i = 0; i < 8; i++) {
+        bytes[i] = (imm >> (8 * i)) & 0xFF;
+    }
+    emit_bytes(buffer, bytes, sizeof(bytes));
+}
+
+static void emit_imm32(JitBuffer *buffer, uint32_t imm)
+{
+    uint8_t bytes[4];
+    for (size_t i = 0; i < 4; i++) {
+        bytes[i] = (imm >> (8 * i)) & 0xFF;
+    }
+    emit_bytes(buffer, bytes, sizeof(bytes));
+}
+
+// Emits a short jump with the given opcode and returns the position of its displacement for patch_jump
+static size_t emit_jump(JitBuffer *buffer, uint8_t op)
+{
+    uint8_t bytes[] = { op, 0x00 };
+    emit_bytes(buffer, bytes, sizeof(bytes));
+    return buffer->count - 1;
+}
+
+static void patch_jump(JitBuffer *buffer, size_t position)
+{
+    size_t distance = buffer->count - position - 1;
+    assert((distance <= INT8_MAX) && "Short jump out of range");
+    buffer->code[position] = (uint8_t) distance;
+}
+
+static uint64_t value_bits(Value value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+static void jit_dump_int(SkInt value)
+{
+    print_value_of_kind(make_value_int(value), TYPE_INT);
+    printf("\n");
+}
+
+static void jit_dump_real(SkReal value)
+{
+    print_value_of_kind(make_value_real(value), TYPE_REAL);
+    printf("\n");
+}
+
+static void jit_div_by_zero(SkardVM *vm, size_t offset)
+{
+    vm_runtime_error(vm, offset, "Integer division by zero.");
+}
+
+// Leaves the VM where the interpreter would suspend at the yield, vm_resume carries on interpreting from there
+static void jit_suspend(SkardVM *vm, Value *stack_top, size_t resume_offset, TypeKind kind)
+{
+    vm->ip = vm->chunk->code + resume_offset;
+    vm->stack.stack_top = stack_top;
+    vm->yielded = stack_top - 1;
+    vm->yielded_kind = kind;
+}
+
+// Natives are resolved through the running VM, chunks compiled once may be shared by VMs with different registries
+static void jit_call_native(SkardVM *vm, Value *arguments, size_t index)
+{
+    const NativeFunction *native = &vm->natives->functions[index];
+    *arguments = native->trampoline(native->function, arguments);
+}
+
+
+static void emit_prologue(JitBuffer *buffer)
+{
+    SKARD_EMIT(buffer, 0x53); // push rbx
+    SKARD_EMIT(buffer, 0x41, 0x54); // push r12
+    SKARD_EMIT(buffer, 0x41, 0x55); // push r13, keeps rsp 16-byte aligned for calls
+    SKARD_EMIT(buffer, 0x49, 0x89, 0xFC); // mov r12, rdi
+    SKARD_EMIT(buffer, 0x48, 0x89, 0xF3); // mov rbx, rsi
+}
+
+static void emit_return(JitBuffer *buffer, InterpreterResult result)
+{
+    SKARD_EMIT(buffer, 0xB8); // mov eax, imm32
+    emit_imm32(buffer, (uint32_t) result);
+    SKARD_EMIT(buffer, 0x41, 0x5D); // pop r13
+    SKARD_EMIT(buffer, 0x41, 0x5C); // pop r12
+    SKARD_EMIT(buffer, 0x5B); // pop rbx
+    SKARD_EMIT(buffer, 0xC3); // ret
+}
+
+static void emit_call(JitBuffer *buffer, uintptr_t function)
+{
+    SKARD_EMIT(buffer, 0x48, 0xB8); // mov rax, imm64
+    emit_imm64(buffer, function);
+    SKARD_EMIT(buffer, 0xFF, 0xD0); // call rax
+}
+
+static void emit_push_constant(JitBuffer *buffer, Value constant)
+{
+    SKARD_EMIT(buffer, 0x48, 0xB8); // mov rax, imm64
+    emit_imm64(buffer, value_bits(constant));
+    SKARD_EMIT(buffer, 0x48, 0x89, 0x03); // mov [rbx], rax
+    SKARD_EMIT(buffer, 0x48, 0x83, 0xC3, 0x08); // add rbx, 8
+}
+
+static void emit_pop(JitBuffer *buffer)
+{
+    SKARD_EMIT(buffer, 0x48, 0x83, 0xEB, 0x08); // sub rbx, 8
+}
+
+static void emit_dump(JitBuffer *buffer, TypeKind kind)
+{
+    emit_pop(buffer);
+    if (kind == TYPE_INT) {
+        SKARD_EMIT(buffer, 0x48, 0x8B, 0x3B); // mov rdi, [rbx]
+        emit_call(buffer, (uintptr_t) jit_dump_int);
+    } else {
+        SKARD_EMIT(buffer, 0xF2, 0x0F, 0x10, 0x03); // movsd xmm0, [rbx]
+        emit_call(buffer, (uintptr_t) jit_dump_real);
+    }
+}
+
+// The chunk's stack may be empty, so the constant goes straight into the argument register
+static void emit_constant_dump(JitBuffer *buffer, Value constant, TypeKind kind)
+{
+    if (kind == TYPE_INT) {
+        SKARD_EMIT(buffer, 0x48, 0xBF); // mov rdi, imm64
+        emit_imm64(buffer, value_bits(constant));
+        emit_call(buffer, (uintptr_t) jit_dump_int);
+    } else {
+        SKARD_EMIT(buffer, 0x48, 0xB8); // mov rax, imm64
+        emit_imm64(buffer, value_bits(constant));
+        SKARD_EMIT(buffer, 0x66, 0x48, 0x0F, 0x6E, 0xC0); // movq xmm0, rax
+        emit_call(buffer, (uintptr_t) jit_dump_real);
+    }
+}
+
+static void emit_negate(JitBuffer *buffer, TypeKind kind)
+{
+    if (kind == TYPE_INT) {
+        SKARD_EMIT(buffer, 0x48, 0xF7, 0x5B, 0xF8); // neg qword [rbx - 8]
+        return;
+    }
+    SKARD_EMIT(buffer, 0x48, 0xB8); // mov rax, sign bit
+    emit_imm64(buffer, UINT64_C(0x8000000000000000));
+    SKARD_EMIT(buffer, 0x48, 0x31, 0x43, 0xF8); // xor [rbx - 8], rax
+}
+
+typedef enum {
+    JIT_ARITHMETIC_ADD,
+    JIT_ARITHMETIC_SUBTRACT,
+    JIT_ARITHMETIC_MULTIPLY,
+    JIT_ARITHMETIC_DIVIDE,
+    COUNT_JIT_ARITHMETICS,
+} JitArithmetic;
+
+static void emit_arithmetic_int(JitBuffer *buffer, JitArithmetic arithmetic)
+{
+    switch (arithmetic) {
+        case JIT_ARITHMETIC_ADD:
+            SKARD_EMIT(buffer, 0x48, 0x8B, 0x43, 0xF8); // mov rax, [rbx - 8]
+            SKARD_EMIT(buffer, 0x48, 0x01, 0x43, 0xF0); // add [rbx - 16], rax
+            break;
+        case JIT_ARITHMETIC_SUBTRACT:
+            SKARD_EMIT(buffer, 0x48, 0x8B, 0x43, 0xF8); // mov rax, [rbx - 8]
+            SKARD_EMIT(buffer, 0x48, 0x29, 0x43, 0xF0); // sub [rbx - 16], rax
+            break;
+        case JIT_ARITHMETIC_MULTIPLY:
+            SKARD_EMIT(buffer, 0x48, 0x8B, 0x43, 0xF0); // mov rax, [rbx - 16]
+            SKARD_EMIT(buffer, 0x48, 0x0F, 0xAF, 0x43, 0xF8); // imul rax, [rbx - 8]
+            SKARD_EMIT(buffer, 0x48, 0x89, 0x43, 0xF0); // mov [rbx - 16], rax
+            break;
+        default:
+            break;
+    }
+    emit_pop(buffer);
+}
+
+// Int operands are converted while loading, which gives the fused promoting instructions for free
+static void emit_arithmetic_real(JitBuffer *buffer, JitArithmetic arithmetic, TypeKind first, TypeKind second)
+{
+    if (first == TYPE_INT) {
+        SKARD_EMIT(buffer, 0xF2, 0x48, 0x0F, 0x2A, 0x43, 0xF0); // cvtsi2sd xmm0, qword [rbx - 16]
+    } else {
+        SKARD_EMIT(buffer, 0xF2, 0x0F, 0x10, 0x43, 0xF0); // movsd xmm0, [rbx - 16]
+    }
+    if (second == TYPE_INT) {
+        SKARD_EMIT(buffer, 0xF2, 0x48, 0x0F, 0x2A, 0x4B, 0xF8); // cvtsi2sd xmm1, qword [rbx - 8]
+    } else {
+        SKARD_EMIT(buffer, 0xF2, 0x0F, 0x10, 0x4B, 0xF8); // movsd xmm1, [rbx - 8]
+    }
+
+    static const uint8_t opcodes[COUNT_JIT_ARITHMETICS] = {
+        [JIT_ARITHMETIC_ADD] = 0x58,
+        [JIT_ARITHMETIC_SUBTRACT] = 0x5C,
+        [JIT_ARITHMETIC_MULTIPLY] = 0x59,
+        [JIT_ARITHMETIC_DIVIDE] = 0x5E,
+    };
+    uint8_t operation[] = { 0xF2, 0x0F, opcodes[arithmetic], 0xC1 }; // <op>sd xmm0, xmm1
+    emit_bytes(buffer, operation, sizeof(operation));
+
+    SKARD_EMIT(buffer, 0xF2, 0x0F, 0x11, 0x43, 0xF0); // movsd [rbx - 16], xmm0
+    emit_pop(buffer);
+}
+
+static void emit_div_int(JitBuffer *buffer, size_t offset)
+{
+    SKARD_EMIT(buffer, 0x48, 0x8B, 0x4B, 0xF8); // mov rcx, [rbx - 8]
+    SKARD_EMIT(buffer, 0x48, 0x85, 0xC9); // test rcx, rcx
+    size_t non_zero = emit_jump(buffer, 0x75); // jnz
+    SKARD_EMIT(buffer, 0x4C, 0x89, 0xE7); // mov rdi, r12
+    SKARD_EMIT(buffer, 0x48, 0xBE); // mov rsi, imm64
+    emit_imm64(buffer, offset);
+    emit_call(buffer, (uintptr_t) jit_div_by_zero);
+    emit_return(buffer, INTERPRETER_NOK_RUNTIME);
+    patch_jump(buffer, non_zero);
+
+    // idiv faults on INT64_MIN / -1, so the interpreter's negation is used instead
+    SKARD_EMIT(buffer, 0x48, 0x83, 0xF9, 0xFF); // cmp rcx, -1
+    size_t not_minus_one = emit_jump(buffer, 0x75); // jne
+    SKARD_EMIT(buffer, 0x48, 0xF7, 0x5B, 0xF0); // neg qword [rbx - 16]
+    size_t done = emit_jump(buffer, 0xEB); // jmp
+    patch_jump(buffer, not_minus_one);
+    SKARD_EMIT(buffer, 0x48, 0x8B, 0x43, 0xF0); // mov rax, [rbx - 16]
+    SKARD_EMIT(buffer, 0x48, 0x99); // cqo
+    SKARD_EMIT(buffer, 0x48, 0xF7, 0xF9); // idiv rcx
+    SKARD_EMIT(buffer, 0x48, 0x89, 0x43, 0xF0); // mov [rbx - 16], rax
+    patch_jump(buffer, done);
+    emit_pop(buffer);
+}
+
+static void emit_suspend(JitBuffer *buffer, size_t resume_offset, TypeKind kind)
+{
+    SKARD_EMIT(buffer, 0x4C, 0x89, 0xE7); // mov rdi, r12
+    SKARD_EMIT(buffer, 0x48, 0x89, 0xDE); // mov rsi, rbx
+    SKARD_EMIT(buffer, 0x48, 0xBA); // mov rdx, imm64
+    emit_imm64(buffer, resume_offset);
+    SKARD_EMIT(buffer, 0xB9); // mov ecx, imm32
+    emit_imm32(buffer, (uint32_t) kind);
+    emit_call(buffer, (uintptr_t) jit_suspend);
+    emit_return(buffer, INTERPRETER_SUSPENDED);
+}
+
+static void emit_call_native(JitBuffer *buffer, size_t index, size_t arity)
+{
+    if (arity > 0) {
+        SKARD_EMIT(buffer, 0x48, 0x83, 0xEB); // sub rbx, imm8
+        uint8_t size = (uint8_t) (arity * sizeof(Value));
+        emit_bytes(buffer, &size, 1);
+    }
+    SKARD_EMIT(buffer, 0x4C, 0x89, 0xE7); // mov rdi, r12
+    SKARD_EMIT(buffer, 0x48, 0x89, 0xDE); // mov rsi, rbx
+    SKARD_EMIT(buffer, 0xBA); // mov edx, imm32
+    emit_imm32(buffer, (uint32_t) index);
+    emit_call(buffer, (uintptr_t) jit_call_native);
+    SKARD_EMIT(buffer, 0x48, 0x83, 0xC3, 0x08); // add rbx, 8
+}
+
+// Field offsets are known at compile time, so the field is moved down with plain displacements
+static void emit_get_field(JitBuffer *buffer, size_t size, size_t field_offset, size_t field_size)
+{
+    int32_t base = -(int32_t) (size * sizeof(Value));
+    for (size_t i = 0; i < field_size; i++) {
+        int32_t slot = (int32_t) (i * sizeof(Value));
+        SKARD_EMIT(buffer, 0x48, 0x8B, 0x83); // mov rax, [rbx + disp32]
+        emit_imm32(buffer, (uint32_t) (base + (int32_t) (field_offset * sizeof(Value)) + slot));
+        SKARD_EMIT(buffer, 0x48, 0x89, 0x83); // mov [rbx + disp32], rax
+        emit_imm32(buffer, (uint32_t) (base + slot));
+    }
+
+    if (size > field_size) {
+        SKARD_EMIT(buffer, 0x48, 0x81, 0xEB); // sub rbx, imm32
+        emit_imm32(buffer, (uint32_t) ((size - field_size) * sizeof(Value)));
+    }
+}
+
+static size_t read_constant_index(Chunk *chunk, size_t offset)
+{
+    if (chunk->code[offset] == OP_CONSTANT_LONG) {
+        return chunk->code[offset + 1] | (chunk->code[offset + 2] << 8) | (chunk->code[offset + 3] << 16);
+    }
+
+    return chunk->code[offset + 1];
+}
+
+// Emits the template of one instruction, fused arithmetic expands back into its constant and operation
+static bool emit_instruction(JitBuffer *buffer, Chunk *chunk, size_t offset)
+{
+    uint8_t op = chunk->code[offset];
+    if (op == OP_CONSTANT_DUMP_INT || op == OP_CONSTANT_DUMP_REAL) {
+        TypeKind kind = op == OP_CONSTANT_DUMP_INT ? TYPE_INT : TYPE_REAL;
+        emit_constant_dump(buffer, chunk->constants.values[read_constant_index(chunk, offset)], kind);
+        return true;
+    }
+    if (stack_instruction_has_constant(op)) {
+        emit_push_constant(buffer, chunk->constants.values[read_constant_index(chunk, offset)]);
+    }
+
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+    switch (op) {
+        case OP_RETURN:
+            emit_return(buffer, INTERPRETER_OK);
+            return true;
+        case OP_DUMP_INT:
+            emit_dump(buffer, TYPE_INT);
+            return true;
+        case OP_DUMP_REAL:
+            emit_dump(buffer, TYPE_REAL);
+            return true;
+        case OP_CONSTANT_DUMP_INT:
+        case OP_CONSTANT_DUMP_REAL:
+        case OP_CONSTANT:
+        case OP_CONSTANT_LONG:
+            return true;
+        case OP_NEGATE_INT:
+            emit_negate(buffer, TYPE_INT);
+            return true;
+        case OP_NEGATE_REAL:
+            emit_negate(buffer, TYPE_REAL);
+            return true;
+        case OP_ADD_INT:
+        case OP_ADD_CONSTANT_INT:
+            emit_arithmetic_int(buffer, JIT_ARITHMETIC_ADD);
+            return true;
+        case OP_SUBTRACT_INT:
+        case OP_SUBTRACT_CONSTANT_INT:
+            emit_arithmetic_int(buffer, JIT_ARITHMETIC_SUBTRACT);
+            return true;
+        case OP_MULTIPLY_INT:
+        case OP_MULTIPLY_CONSTANT_INT:
+            emit_arithmetic_int(buffer, JIT_ARITHMETIC_MULTIPLY);
+            return true;
+        case OP_ADD_REAL:
+        case OP_ADD_CONSTANT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_ADD, TYPE_REAL, TYPE_REAL);
+            return true;
+        case OP_ADD_INT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_ADD, TYPE_INT, TYPE_REAL);
+            return true;
+        case OP_ADD_REAL_INT:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_ADD, TYPE_REAL, TYPE_INT);
+            return true;
+        case OP_SUBTRACT_REAL:
+        case OP_SUBTRACT_CONSTANT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_SUBTRACT, TYPE_REAL, TYPE_REAL);
+            return true;
+        case OP_SUBTRACT_INT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_SUBTRACT, TYPE_INT, TYPE_REAL);
+            return true;
+        case OP_SUBTRACT_REAL_INT:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_SUBTRACT, TYPE_REAL, TYPE_INT);
+            return true;
+        case OP_MULTIPLY_REAL:
+        case OP_MULTIPLY_CONSTANT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_MULTIPLY, TYPE_REAL, TYPE_REAL);
+            return true;
+        case OP_MULTIPLY_INT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_MULTIPLY, TYPE_INT, TYPE_REAL);
+            return true;
+        case OP_MULTIPLY_REAL_INT:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_MULTIPLY, TYPE_REAL, TYPE_INT);
+            return true;
+        case OP_DIVIDE_REAL:
+        case OP_DIVIDE_CONSTANT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_DIVIDE, TYPE_REAL, TYPE_REAL);
+            return true;
+        case OP_DIVIDE_INT_REAL:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_DIVIDE, TYPE_INT, TYPE_REAL);
+            return true;
+        case OP_DIVIDE_REAL_INT:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_DIVIDE, TYPE_REAL, TYPE_INT);
+            return true;
+        case OP_DIVIDE_INT_INT:
+            emit_arithmetic_real(buffer, JIT_ARITHMETIC_DIVIDE, TYPE_INT, TYPE_INT);
+            return true;
+        case OP_DIV_INT:
+        case OP_DIV_CONSTANT_INT:
+            emit_div_int(buffer, offset);
+            return true;
+        case OP_GET_FIELD:
+            emit_get_field(buffer, chunk->code[offset + 1], chunk->code[offset + 2], chunk->code[offset + 3]);
+            return true;
+        case OP_YIELD_INT:
+            emit_suspend(buffer, offset + stack_instruction_size(op), TYPE_INT);
+            return true;
+        case OP_YIELD_REAL:
+            emit_suspend(buffer, offset + stack_instruction_size(op), TYPE_REAL);
+            return true;
+        case OP_CALL_NATIVE:
+            emit_call_native(buffer, chunk->code[offset + 1], chunk->code[offset + 2]);
+            return true;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static void jit_write_perf_map(void *code, size_t size)
+{
+    static size_t compiled_count = 0;
+    size_t index = __atomic_fetch_add(&compiled_count, 1, __ATOMIC_RELAXED);
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "/tmp/perf-%ld.map", (long) getpid());
+    FILE *map = fopen(filename, "a");
+    if (map == NULL) {
+        return;
+    }
+    fprintf(map, "%" PRIxPTR " %zx skard_chunk_%zu\n", (uintptr_t) code, size, index);
+    fclose(map);
+}
+
+// Copies the generated code into its own pages, which are never writable and executable at the same time
+static void *jit_install(JitBuffer *buffer, size_t *size)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    *size = (buffer->count + page_size - 1) / page_size * page_size;
+
+    void *code = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return NULL;
+    }
+    memcpy(code, buffer->code, buffer->count);
+    if (mprotect(code, *size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, *size);
+        return NULL;
+    }
+
+    return code;
+}
+
+bool jit_is_available(void)
+{
+    return true;
+}
+
+// Only verified stack chunks are compiled, chunks the JIT cannot handle are left to the interpreter for good
+bool jit_compile(Chunk *chunk)
+{
+    if (chunk->jit_code != NULL) {
+        return true;
+    }
+    if (chunk->is_jit_rejected || chunk->format != CHUNK_FORMAT_STACK || !chunk->is_verified) {
+        return false;
+    }
+
+    JitBuffer buffer;
+    jit_buffer_init(&buffer);
+    emit_prologue(&buffer);
+
+    bool is_supported = true;
+    size_t offset = 0;
+    while (is_supported && offset < chunk->count) {
+        is_supported = emit_instruction(&buffer, chunk, offset);
+        offset += stack_instruction_size(chunk->code[offset]);
+    }
+
+    if (is_supported) {
+        chunk->jit_code = jit_install(&buffer, &chunk->jit_code_size);
+    }
+    if (chunk->jit_code == NULL) {
+        chunk->is_jit_rejected = true;
+    } else {
+        jit_write_perf_map(chunk->jit_code, buffer.count);
+    }
+
+    jit_buffer_free(&buffer);
+    return chunk->jit_code != NULL;
+}
+
+// Counts entries into the chunk and compiles it once it gets hot, returns whether native code should run
+bool jit_enter(SkardVM *vm, Chunk *chunk)
+{
+    // Generated code runs to the end without counting fuel, enter it only when the budget covers every instruction
+    if (vm->jit_threshold == 0 || vm->trace != NULL || vm->fuel < chunk->count) {
+        return false;
+    }
+    if (chunk->jit_code != NULL) {
+        return true;
+    }
+    // Frozen chunks are shared between threads, they are only compiled by chunk_freeze
+    if (chunk->is_jit_rejected || chunk->is_frozen) {
+        return false;
+    }
+
+    chunk->entry_count++;
+    return chunk->entry_count >= vm->jit_threshold && jit_compile(chunk);
+}
+
+InterpreterResult jit_run(SkardVM *vm, Chunk *chunk)
+{
+    JitFunction function;
+    void *code = chunk->jit_code;
+    memcpy(&function, &code, sizeof(function));
+    return function(vm, vm->stack.stack_top);
+}
+
+void jit_release(Chunk *chunk)
+{
+    if (chunk->jit_code != NULL) {
+        munmap(chunk->jit_code, chunk->jit_code_size);
+    }
+    chunk->jit_code = NULL;
+    chunk->jit_code_size = 0;
+    chunk->is_jit_rejected = false;
+    chunk->entry_count = 0;
+}
+
+#undef SKARD_EMIT
+
+#else
+
+bool jit_is_available(void)
+{
+    return false;
+}
+
+bool jit_compile(Chunk *chunk)
+{
+    chunk->is_jit_rejected = true;
+    return false;
+}
+
+bool jit_enter(SkardVM *vm, Chunk *chunk)
+{
+    (void) vm;
+    (void) chunk;
+    return false;
+}
+
+InterpreterResult jit_run(SkardVM *vm, Chunk *chunk)
+{
+    (void) vm;
+    (void) chunk;
+    return INTERPRETER_NOK_RUNTIME;
+}
+
+void jit_release(Chunk *chunk)
+{
+    chunk->jit_code = NULL;
+    chunk->jit_code_size = 0;
+    chunk->is_jit_rejected = false;
+    chunk->entry_count = 0;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SKARD_JIT_H
+#define SKARD_JIT_H
+
+#include <stdbool.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+// Generated code keeps values in untagged 8-byte stack slots and cannot emit per-instruction profiles
+#if defined(SKARD_JIT) && \
+    (!defined(__x86_64__) || !defined(__linux__) || defined(SKARD_VALUE_TAGS) || defined(SKARD_PROFILE))
+#undef SKARD_JIT
+#endif
+
+#define SKARD_JIT_DEFAULT_THRESHOLD 16
+
+// False when the library is built without the JIT or for a platform it does not support
+bool jit_is_available(void);
+bool jit_compile(Chunk *chunk);
+bool jit_enter(SkardVM *vm, Chunk *chunk);
+InterpreterResult jit_run(SkardVM *vm, Chunk *chunk);
+void jit_release(Chunk *chunk);
+
+#endif //SKARD_JIT_H
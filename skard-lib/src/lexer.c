@@ -266,6 +266,9 @@ static TokenType lexer_determine_identifier_type(Lexer *lexer)
                         break;
                 }
             }
+            break;
+        case 'y':
+            return lexer_check_keyword(lexer, 1, "ield", TOKEN_KEY_YIELD);
         default:
             break;
     }
@@ -424,7 +427,7 @@ void lexer_print(Lexer *lexer)
 }
 
 const char *translate_token_type(TokenType type) {
-    assert((COUNT_TOKENS == 55) && "Exhaustive token types handling");
+    assert((COUNT_TOKENS == 56) && "Exhaustive token types handling");
     switch (type) {
         case TOKEN_EOF:
             return "TOKEN_EOF";
@@ -528,6 +531,8 @@ const char *translate_token_type(TokenType type) {
             return "TOKEN_KEY_WITH";
         case TOKEN_KEY_DUMP:
             return "TOKEN_KEY_DUMP";
+        case TOKEN_KEY_YIELD:
+            return "TOKEN_KEY_YIELD";
         case TOKEN_IDENTIFIER:
             return "TOKEN_IDENTIFIER";
         case TOKEN_LIT_STRING:
@@ -30,7 +30,7 @@ typedef enum {
     TOKEN_KEY_WHILE, TOKEN_KEY_FOR, // while, for
     TOKEN_KEY_TRUE, TOKEN_KEY_FALSE, // true, false
     TOKEN_KEY_MATCH, TOKEN_KEY_WITH, // match, with
-    TOKEN_KEY_DUMP, // dump
+    TOKEN_KEY_DUMP, TOKEN_KEY_YIELD, // dump, yield
 
     TOKEN_IDENTIFIER, TOKEN_LIT_STRING, TOKEN_LIT_REAL, TOKEN_LIT_INT,
 
@@ -0,0 +1,248 @@
+#include "native.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "utils.h"
+
+#define SKARD_C_Int SkInt
+#define SKARD_C_Real SkReal
+#define SKARD_FIELD_Int sk_int
+#define SKARD_FIELD_Real sk_real
+#define SKARD_WRAP_Int make_value_int
+#define SKARD_WRAP_Real make_value_real
+#define SKARD_ARGUMENT(kind, index) (arguments[index].as.SKARD_FIELD_##kind)
+
+#define SKARD_TRAMPOLINE_0(R) \
+    static Value trampoline_##R(SkardNativeFunction function, const Value *arguments) \
+    { \
+        (void) arguments; \
+        return SKARD_WRAP_##R(((SKARD_C_##R (*)(void)) function)()); \
+    }
+#define SKARD_TRAMPOLINE_1(R, A) \
+    static Value trampoline_##R##_##A(SkardNativeFunction function, const Value *arguments) \
+    { \
+        return SKARD_WRAP_##R(((SKARD_C_##R (*)(SKARD_C_##A)) function)(SKARD_ARGUMENT(A, 0))); \
+    }
+#define SKARD_TRAMPOLINE_2(R, A, B) \
+    static Value trampoline_##R##_##A##_##B(SkardNativeFunction function, const Value *arguments) \
+    { \
+        return SKARD_WRAP_##R(((SKARD_C_##R (*)(SKARD_C_##A, SKARD_C_##B)) function)( \
+            SKARD_ARGUMENT(A, 0), SKARD_ARGUMENT(B, 1))); \
+    }
+#define SKARD_TRAMPOLINE_3(R, A, B, C) \
+    static Value trampoline_##R##_##A##_##B##_##C(SkardNativeFunction function, const Value *arguments) \
+    { \
+        return SKARD_WRAP_##R(((SKARD_C_##R (*)(SKARD_C_##A, SKARD_C_##B, SKARD_C_##C)) function)( \
+            SKARD_ARGUMENT(A, 0), SKARD_ARGUMENT(B, 1), SKARD_ARGUMENT(C, 2))); \
+    }
+
+// Parameter lists in the order of signature_code, bit i of the code is set when parameter i is Real
+#define SKARD_TRAMPOLINES(R, X0, X1, X2, X3) \
+    X0(R) \
+    X1(R, Int) X1(R, Real) \
+    X2(R, Int, Int) X2(R, Real, Int) X2(R, Int, Real) X2(R, Real, Real) \
+    X3(R, Int, Int, Int) X3(R, Real, Int, Int) X3(R, Int, Real, Int) X3(R, Real, Real, Int) \
+    X3(R, Int, Int, Real) X3(R, Real, Int, Real) X3(R, Int, Real, Real) X3(R, Real, Real, Real)
+
+SKARD_TRAMPOLINES(Int, SKARD_TRAMPOLINE_0, SKARD_TRAMPOLINE_1, SKARD_TRAMPOLINE_2, SKARD_TRAMPOLINE_3)
+SKARD_TRAMPOLINES(Real, SKARD_TRAMPOLINE_0, SKARD_TRAMPOLINE_1, SKARD_TRAMPOLINE_2, SKARD_TRAMPOLINE_3)
+
+#define SKARD_ENTRY_0(R) trampoline_##R,
+#define SKARD_ENTRY_1(R, A) trampoline_##R##_##A,
+#define SKARD_ENTRY_2(R, A, B) trampoline_##R##_##A##_##B,
+#define SKARD_ENTRY_3(R, A, B, C) trampoline_##R##_##A##_##B##_##C,
+
+#define SKARD_SIGNATURES_COUNT ((1 << (SKARD_NATIVE_MAX_ARITY + 1)) - 1)
+
+static const NativeTrampoline trampolines[2][SKARD_SIGNATURES_COUNT] = {
+    { SKARD_TRAMPOLINES(Int, SKARD_ENTRY_0, SKARD_ENTRY_1, SKARD_ENTRY_2, SKARD_ENTRY_3) },
+    { SKARD_TRAMPOLINES(Real, SKARD_ENTRY_0, SKARD_ENTRY_1, SKARD_ENTRY_2, SKARD_ENTRY_3) },
+};
+
+#undef SKARD_C_Int
+#undef SKARD_C_Real
+#undef SKARD_FIELD_Int
+#undef SKARD_FIELD_Real
+#undef SKARD_WRAP_Int
+#undef SKARD_WRAP_Real
+#undef SKARD_ARGUMENT
+#undef SKARD_TRAMPOLINE_0
+#undef SKARD_TRAMPOLINE_1
+#undef SKARD_TRAMPOLINE_2
+#undef SKARD_TRAMPOLINE_3
+#undef SKARD_TRAMPOLINES
+#undef SKARD_ENTRY_0
+#undef SKARD_ENTRY_1
+#undef SKARD_ENTRY_2
+#undef SKARD_ENTRY_3
+
+static NativeTrampoline get_trampoline(const NativeFunction *native)
+{
+    size_t signature_code = ((size_t) 1 << native->arity) - 1;
+    for (size_t i = 0; i < native->arity; i++) {
+        signature_code += (size_t) (native->parameters[i] == TYPE_REAL) << i;
+    }
+
+    return trampolines[native->result == TYPE_REAL][signature_code];
+}
+
+
+void native_registry_init(NativeRegistry *registry)
+{
+    registry->count = 0;
+    registry->capacity = 0;
+    registry->functions = NULL;
+}
+
+void native_registry_free(NativeRegistry *registry)
+{
+    for (size_t i = 0; i < registry->count; i++) {
+        SKARD_FREE_ARRAY(char, registry->functions[i].name);
+    }
+    SKARD_FREE_ARRAY(NativeFunction, registry->functions);
+    native_registry_init(registry);
+}
+
+
+static const char *skip_spaces(const char *text)
+{
+    while (isspace((unsigned char) *text)) {
+        text++;
+    }
+    return text;
+}
+
+static const char *parse_type_kind(const char *text, TypeKind *kind)
+{
+    text = skip_spaces(text);
+    if (strncmp(text, "Int", 3) == 0 && !isalnum((unsigned char) text[3])) {
+        *kind = TYPE_INT;
+        return text + 3;
+    }
+    if (strncmp(text, "Real", 4) == 0 && !isalnum((unsigned char) text[4])) {
+        *kind = TYPE_REAL;
+        return text + 4;
+    }
+    return NULL;
+}
+
+static bool parse_signature(const char *text, NativeFunction *native)
+{
+    text = skip_spaces(text);
+    if (*text++ != '(') {
+        return false;
+    }
+
+    native->arity = 0;
+    text = skip_spaces(text);
+    while (*text != ')') {
+        if (native->arity == SKARD_NATIVE_MAX_ARITY) {
+            return false;
+        }
+        text = parse_type_kind(text, &native->parameters[native->arity]);
+        if (text == NULL) {
+            return false;
+        }
+        native->arity++;
+
+        text = skip_spaces(text);
+        if (*text == ',') {
+            text = skip_spaces(text + 1);
+        } else if (*text != ')') {
+            return false;
+        }
+    }
+
+    text = skip_spaces(text + 1);
+    if (strncmp(text, "->", 2) != 0) {
+        return false;
+    }
+    text = parse_type_kind(text + 2, &native->result);
+    return text != NULL && *skip_spaces(text) == '\0';
+}
+
+static bool is_native_name_valid(const char *name)
+{
+    if (!isalpha((unsigned char) name[0]) && name[0] != '_') {
+        return false;
+    }
+    for (const char *character = name; *character != '\0'; character++) {
+        if (!isalnum((unsigned char) *character) && *character != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool native_registry_add(NativeRegistry *registry, const char *name, const char *signature,
+                         SkardNativeFunction function)
+{
+    if (!is_native_name_valid(name)) {
+        fprintf(stderr, "ERROR: Invalid native function name \"%s\".\n", name);
+        return false;
+    }
+
+    NativeFunction native;
+    if (!parse_signature(signature, &native)) {
+        fprintf(stderr, "ERROR: Invalid signature \"%s\" of native function '%s'.\n", signature, name);
+        return false;
+    }
+
+    size_t name_length = strlen(name);
+    if (native_registry_find(registry, name, name_length, NULL) != NULL) {
+        fprintf(stderr, "ERROR: Native function '%s' is already registered.\n", name);
+        return false;
+    }
+    if (registry->count == SKARD_MAX_NATIVES) {
+        fprintf(stderr, "ERROR: Cannot register more than %d native functions.\n", SKARD_MAX_NATIVES);
+        return false;
+    }
+
+    native.name = SKARD_GROW_ARRAY(char, NULL, name_length + 1);
+    memcpy(native.name, name, name_length + 1);
+    native.name_length = name_length;
+    native.function = function;
+    native.trampoline = get_trampoline(&native);
+
+    if (registry->capacity < registry->count + 1) {
+        registry->capacity = SKARD_GROW_CAPACITY(registry->capacity);
+        registry->functions = SKARD_GROW_ARRAY(NativeFunction, registry->functions, registry->capacity);
+    }
+    registry->functions[registry->count++] = native;
+    return true;
+}
+
+const NativeFunction *native_registry_find(const NativeRegistry *registry, const char *name, size_t name_length,
+                                           size_t *index)
+{
+    for (size_t i = 0; i < registry->count; i++) {
+        const NativeFunction *native = &registry->functions[i];
+        if (native->name_length == name_length && memcmp(native->name, name, name_length) == 0) {
+            if (index != NULL) {
+                *index = i;
+            }
+            return native;
+        }
+    }
+
+    return NULL;
+}
+
+uint64_t native_registry_hash(const NativeRegistry *registry, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < registry->count; i++) {
+        const NativeFunction *native = &registry->functions[i];
+        uint8_t signature[SKARD_NATIVE_MAX_ARITY + 2] = { 0 };
+        signature[0] = (uint8_t) native->arity;
+        signature[1] = (uint8_t) native->result;
+        for (size_t j = 0; j < native->arity; j++) {
+            signature[j + 2] = (uint8_t) native->parameters[j];
+        }
+        hash = hash_bytes(native->name, native->name_length + 1, hash);
+        hash = hash_bytes(signature, sizeof(signature), hash);
+    }
+    return hash;
+}
@@ -0,0 +1,49 @@
+#ifndef SKARD_NATIVE_H
+#define SKARD_NATIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "value.h"
+
+#define SKARD_MAX_NATIVES 256
+#define SKARD_NATIVE_MAX_ARITY 3
+
+// Host functions are registered through this generic pointer type and called through their real C type, SkInt and
+// SkReal parameters and results map to Int and Real
+typedef void (*SkardNativeFunction)(void);
+#define SKARD_NATIVE(function) ((SkardNativeFunction) (function))
+
+// Calls the host function with arguments unpacked from consecutive value slots, one trampoline per signature
+typedef Value (*NativeTrampoline)(SkardNativeFunction function, const Value *arguments);
+
+typedef struct {
+    char *name;
+    size_t name_length;
+    size_t arity;
+    TypeKind parameters[SKARD_NATIVE_MAX_ARITY];
+    TypeKind result;
+    SkardNativeFunction function;
+    NativeTrampoline trampoline;
+} NativeFunction;
+
+// Chunks address natives by their index, run a chunk with the registry it was compiled against or one that extends it
+typedef struct {
+    size_t count;
+    size_t capacity;
+    NativeFunction *functions;
+} NativeRegistry;
+
+void native_registry_init(NativeRegistry *registry);
+void native_registry_free(NativeRegistry *registry);
+
+// The signature is written like "(Int, Real) -> Real", returns false and reports when it or the name is not usable
+bool native_registry_add(NativeRegistry *registry, const char *name, const char *signature,
+                         SkardNativeFunction function);
+const NativeFunction *native_registry_find(const NativeRegistry *registry, const char *name, size_t name_length,
+                                           size_t *index);
+
+// Covers names and signatures, compiled chunks can be reused by any registry with the same hash
+uint64_t native_registry_hash(const NativeRegistry *registry, uint64_t seed);
+
+#endif //SKARD_NATIVE_H
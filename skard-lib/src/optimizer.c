@@ -0,0 +1,155 @@
+#include "optimizer.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "utils.h"
+#include "jit.h"
+
+typedef struct {
+    uint8_t first;
+    uint8_t second;
+    uint8_t fused;
+} Superinstruction;
+
+// A fused instruction takes the short constant index of its first instruction, the second has no operands
+static const Superinstruction superinstructions[] = {
+    { .first = OP_CONSTANT, .second = OP_DUMP_INT, .fused = OP_CONSTANT_DUMP_INT },
+    { .first = OP_CONSTANT, .second = OP_DUMP_REAL, .fused = OP_CONSTANT_DUMP_REAL },
+    { .first = OP_CONSTANT, .second = OP_ADD_INT, .fused = OP_ADD_CONSTANT_INT },
+    { .first = OP_CONSTANT, .second = OP_ADD_REAL, .fused = OP_ADD_CONSTANT_REAL },
+    { .first = OP_CONSTANT, .second = OP_SUBTRACT_INT, .fused = OP_SUBTRACT_CONSTANT_INT },
+    { .first = OP_CONSTANT, .second = OP_SUBTRACT_REAL, .fused = OP_SUBTRACT_CONSTANT_REAL },
+    { .first = OP_CONSTANT, .second = OP_MULTIPLY_INT, .fused = OP_MULTIPLY_CONSTANT_INT },
+    { .first = OP_CONSTANT, .second = OP_MULTIPLY_REAL, .fused = OP_MULTIPLY_CONSTANT_REAL },
+    { .first = OP_CONSTANT, .second = OP_DIVIDE_REAL, .fused = OP_DIVIDE_CONSTANT_REAL },
+    { .first = OP_CONSTANT, .second = OP_DIV_INT, .fused = OP_DIV_CONSTANT_INT },
+};
+
+#define SKARD_SUPERINSTRUCTIONS_COUNT (sizeof(superinstructions) / sizeof(superinstructions[0]))
+
+
+void op_pair_histogram_init(OpPairHistogram *histogram)
+{
+    for (size_t first = 0; first < COUNT_OPS; first++) {
+        for (size_t second = 0; second < COUNT_OPS; second++) {
+            histogram->counts[first][second] = 0;
+        }
+    }
+}
+
+void fusion_set_init(FusionSet *fusions)
+{
+    for (size_t op = 0; op < COUNT_OPS; op++) {
+        fusions->enabled[op] = false;
+    }
+}
+
+void fusion_set_init_all(FusionSet *fusions)
+{
+    fusion_set_init(fusions);
+    for (size_t i = 0; i < SKARD_SUPERINSTRUCTIONS_COUNT; i++) {
+        fusions->enabled[superinstructions[i].fused] = true;
+    }
+}
+
+// Straight-line chunks execute every instruction exactly once, so static pair counts equal a training run's counts
+void optimizer_collect_op_pairs(Chunk *chunk, OpPairHistogram *histogram)
+{
+    if (chunk->format != CHUNK_FORMAT_STACK || chunk->count == 0) {
+        return;
+    }
+
+    size_t offset = 0;
+    size_t next = stack_instruction_size(chunk->code[offset]);
+    while (next < chunk->count) {
+        uint8_t first = chunk->code[offset];
+        uint8_t second = chunk->code[next];
+        if (first < COUNT_OPS && second < COUNT_OPS) {
+            histogram->counts[first][second]++;
+        }
+
+        offset = next;
+        next += stack_instruction_size(second);
+    }
+}
+
+void optimizer_select_fusions(OpPairHistogram *histogram, uint64_t threshold, FusionSet *fusions)
+{
+    fusion_set_init(fusions);
+    for (size_t i = 0; i < SKARD_SUPERINSTRUCTIONS_COUNT; i++) {
+        const Superinstruction *superinstruction = &superinstructions[i];
+        if (histogram->counts[superinstruction->first][superinstruction->second] >= threshold) {
+            fusions->enabled[superinstruction->fused] = true;
+        }
+    }
+}
+
+
+static const Superinstruction *find_superinstruction(const FusionSet *fusions, uint8_t first, uint8_t second)
+{
+    for (size_t i = 0; i < SKARD_SUPERINSTRUCTIONS_COUNT; i++) {
+        const Superinstruction *superinstruction = &superinstructions[i];
+        if (superinstruction->first == first && superinstruction->second == second &&
+            fusions->enabled[superinstruction->fused]) {
+            return superinstruction;
+        }
+    }
+
+    return NULL;
+}
+
+// Rewrites the chunk in place, returns the number of fused pairs
+size_t optimizer_fuse_superinstructions(Chunk *chunk, const FusionSet *fusions)
+{
+    assert(chunk->packed == NULL && chunk->mapping == NULL && "Finalized and mapped chunks cannot be rewritten");
+    if (chunk->format != CHUNK_FORMAT_STACK) {
+        return 0;
+    }
+
+    Chunk fused;
+    chunk_init(&fused);
+    size_t fused_count = 0;
+
+    size_t offset = 0;
+    while (offset < chunk->count) {
+        uint8_t first = chunk->code[offset];
+        size_t first_size = stack_instruction_size(first);
+        size_t next = offset + first_size;
+
+        if (next < chunk->count) {
+            const Superinstruction *superinstruction = find_superinstruction(fusions, first, chunk->code[next]);
+            if (superinstruction != NULL) {
+                // The fused instruction reports the location of the operation, not of its constant
+                size_t line = debug_info_read_line(&chunk->debug_info, next);
+                size_t column = debug_info_read_column(&chunk->debug_info, next);
+                size_t end = next + stack_instruction_size(chunk->code[next]);
+                size_t operands = end - next - 1;
+                uint8_t instruction[8] = { superinstruction->fused, chunk->code[offset + 1] };
+                assert(2 + operands <= sizeof(instruction) && "Fused instruction too long");
+                memcpy(instruction + 2, &chunk->code[next + 1], operands);
+                chunk_write_instruction(&fused, instruction, 2 + operands, line, column);
+
+                offset = end;
+                fused_count++;
+                continue;
+            }
+        }
+
+        chunk_write_instruction(&fused, &chunk->code[offset], next - offset,
+                                debug_info_read_line(&chunk->debug_info, offset),
+                                debug_info_read_column(&chunk->debug_info, offset));
+        offset = next;
+    }
+
+    SKARD_FREE_ARRAY(uint8_t, chunk->code);
+    debug_info_free(&chunk->debug_info);
+    chunk->code = fused.code;
+    chunk->count = fused.count;
+    chunk->capacity = fused.capacity;
+    chunk->debug_info = fused.debug_info;
+    chunk->is_verified = false;
+    jit_release(chunk);
+
+    return fused_count;
+}
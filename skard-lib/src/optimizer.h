@@ -0,0 +1,29 @@
+#ifndef SKARD_OPTIMIZER_H
+#define SKARD_OPTIMIZER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chunk.h"
+
+#define SKARD_FUSION_DEFAULT_THRESHOLD 1
+
+typedef struct {
+    uint64_t counts[COUNT_OPS][COUNT_OPS];
+} OpPairHistogram;
+
+void op_pair_histogram_init(OpPairHistogram *histogram);
+
+// Indexed by the fused opcode
+typedef struct {
+    bool enabled[COUNT_OPS];
+} FusionSet;
+
+void fusion_set_init(FusionSet *fusions);
+void fusion_set_init_all(FusionSet *fusions);
+
+void optimizer_collect_op_pairs(Chunk *chunk, OpPairHistogram *histogram);
+void optimizer_select_fusions(OpPairHistogram *histogram, uint64_t threshold, FusionSet *fusions);
+size_t optimizer_fuse_superinstructions(Chunk *chunk, const FusionSet *fusions);
+
+#endif //SKARD_OPTIMIZER_H
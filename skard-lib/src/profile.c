@@ -0,0 +1,91 @@
+#include "profile.h"
+
+#include <inttypes.h>
+
+#include "debug.h"
+
+#define SKARD_PROFILE_TOP_PAIRS 10
+
+void vm_profile_reset(VMProfile *profile)
+{
+    for (size_t op = 0; op < COUNT_OPS; op++) {
+        profile->counts[op] = 0;
+        profile->ticks[op] = 0;
+    }
+    op_pair_histogram_init(&profile->pairs);
+    profile->previous_op = SKARD_PROFILE_NO_OP;
+    profile->previous_start = 0;
+}
+
+// Insertion sort, there are only a few dozen opcodes
+static void sort_ops_by_ticks(const VMProfile *profile, uint8_t *ops)
+{
+    for (size_t i = 0; i < COUNT_OPS; i++) {
+        ops[i] = (uint8_t) i;
+    }
+
+    for (size_t i = 1; i < COUNT_OPS; i++) {
+        uint8_t op = ops[i];
+        size_t j = i;
+        while (j > 0 && profile->ticks[ops[j - 1]] < profile->ticks[op]) {
+            ops[j] = ops[j - 1];
+            j--;
+        }
+        ops[j] = op;
+    }
+}
+
+static void print_top_pairs(const VMProfile *profile, FILE *file)
+{
+    bool printed[COUNT_OPS][COUNT_OPS] = { { false } };
+
+    fprintf(file, "%-26s %-26s %14s\n", "FIRST", "SECOND", "COUNT");
+    for (size_t rank = 0; rank < SKARD_PROFILE_TOP_PAIRS; rank++) {
+        size_t best_first = 0;
+        size_t best_second = 0;
+        uint64_t best_count = 0;
+        for (size_t first = 0; first < COUNT_OPS; first++) {
+            for (size_t second = 0; second < COUNT_OPS; second++) {
+                uint64_t count = profile->pairs.counts[first][second];
+                if (!printed[first][second] && count > best_count) {
+                    best_first = first;
+                    best_second = second;
+                    best_count = count;
+                }
+            }
+        }
+
+        if (best_count == 0) {
+            break;
+        }
+        printed[best_first][best_second] = true;
+        fprintf(file, "%-26s %-26s %14" PRIu64 "\n", translate_op(best_first), translate_op(best_second), best_count);
+    }
+}
+
+// Prints executed opcodes sorted by the time spent in them, followed by the most frequent opcode pairs
+void vm_profile_print(const VMProfile *profile, FILE *file)
+{
+    uint64_t total_ticks = 0;
+    for (size_t op = 0; op < COUNT_OPS; op++) {
+        total_ticks += profile->ticks[op];
+    }
+
+    uint8_t ops[COUNT_OPS];
+    sort_ops_by_ticks(profile, ops);
+
+    fprintf(file, "%-26s %14s %16s %12s %8s\n", "OPCODE", "COUNT", "TICKS", "TICKS/OP", "TIME");
+    for (size_t i = 0; i < COUNT_OPS; i++) {
+        uint8_t op = ops[i];
+        if (profile->counts[op] == 0) {
+            continue;
+        }
+
+        double share = total_ticks == 0 ? 0.0 : 100.0 * (double) profile->ticks[op] / (double) total_ticks;
+        fprintf(file, "%-26s %14" PRIu64 " %16" PRIu64 " %12.1f %7.2f%%\n", translate_op(op), profile->counts[op],
+                profile->ticks[op], (double) profile->ticks[op] / (double) profile->counts[op], share);
+    }
+
+    fprintf(file, "\n");
+    print_top_pairs(profile, file);
+}
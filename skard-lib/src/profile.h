@@ -0,0 +1,64 @@
+#ifndef SKARD_PROFILE_H
+#define SKARD_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "chunk.h"
+#include "optimizer.h"
+
+#define SKARD_PROFILE_NO_OP UINT8_MAX
+
+// Execution counts and time spent per stack opcode, time is measured in ticks of profile_clock() from one dispatch
+// to the next. Pair counts use the optimizer's histogram so a profiled run can drive superinstruction selection.
+typedef struct {
+    uint64_t counts[COUNT_OPS];
+    uint64_t ticks[COUNT_OPS];
+    OpPairHistogram pairs;
+    uint8_t previous_op;
+    uint64_t previous_start;
+} VMProfile;
+
+void vm_profile_reset(VMProfile *profile);
+void vm_profile_print(const VMProfile *profile, FILE *file);
+
+#ifdef SKARD_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static inline uint64_t profile_clock(void)
+{
+    return __rdtsc();
+}
+#else
+#include <time.h>
+
+static inline uint64_t profile_clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+#endif
+
+// Called by the dispatch loop right before the op executes
+static inline void vm_profile_step(VMProfile *profile, uint8_t op)
+{
+    uint64_t now = profile_clock();
+    if (op >= COUNT_OPS) {
+        return;
+    }
+
+    if (profile->previous_op != SKARD_PROFILE_NO_OP) {
+        profile->ticks[profile->previous_op] += now - profile->previous_start;
+        profile->pairs.counts[profile->previous_op][op]++;
+    }
+    profile->counts[op]++;
+    profile->previous_op = op;
+    profile->previous_start = now;
+}
+
+#endif
+
+#endif //SKARD_PROFILE_H
@@ -0,0 +1,171 @@
+#include "sampler.h"
+
+#include <stdint.h>
+#include <assert.h>
+
+#include "utils.h"
+#include "debug.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKARD_SAMPLER_SUPPORTED
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+void vm_sampler_init(VMSampler *sampler, SkardVM *vm, size_t capacity)
+{
+    sampler->vm = vm;
+    sampler->samples_count = 0;
+    sampler->samples_capacity = capacity;
+    sampler->samples = SKARD_GROW_ARRAY(size_t, NULL, capacity);
+    sampler->dropped_count = 0;
+}
+
+void vm_sampler_free(VMSampler *sampler)
+{
+    vm_sampler_stop(sampler);
+    sampler->samples = SKARD_FREE_ARRAY(size_t, sampler->samples);
+    sampler->samples_count = 0;
+    sampler->samples_capacity = 0;
+}
+
+#ifdef SKARD_SAMPLER_SUPPORTED
+
+static VMSampler *volatile active_sampler = NULL;
+static struct sigaction previous_action;
+
+static void sampler_handle_signal(int signal)
+{
+    (void) signal;
+    VMSampler *sampler = active_sampler;
+    if (sampler == NULL) {
+        return;
+    }
+
+    // The only VM field read here, see SkardVM.sampled_offset
+    sig_atomic_t offset = sampler->vm->sampled_offset;
+    if (offset == SKARD_SAMPLED_IDLE || sampler->samples_count == sampler->samples_capacity) {
+        sampler->dropped_count++;
+        return;
+    }
+
+    sampler->samples[sampler->samples_count++] = offset == SKARD_SAMPLED_NATIVE ? SKARD_SAMPLE_NATIVE : (size_t) offset;
+}
+
+bool vm_sampler_start(VMSampler *sampler, size_t interval_us)
+{
+    if (active_sampler != NULL) {
+        return false;
+    }
+
+    struct sigaction action;
+    action.sa_handler = sampler_handle_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &previous_action) != 0) {
+        return false;
+    }
+    sampler->vm->is_sampled = true;
+    active_sampler = sampler;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = (time_t) (interval_us / 1000000);
+    timer.it_interval.tv_usec = (suseconds_t) (interval_us % 1000000);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        active_sampler = NULL;
+        sampler->vm->is_sampled = false;
+        sigaction(SIGPROF, &previous_action, NULL);
+        return false;
+    }
+
+    return true;
+}
+
+void vm_sampler_stop(VMSampler *sampler)
+{
+    if (active_sampler != sampler) {
+        return;
+    }
+
+    struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &previous_action, NULL);
+    active_sampler = NULL;
+    sampler->vm->is_sampled = false;
+}
+
+#else
+
+bool vm_sampler_start(VMSampler *sampler, size_t interval_us)
+{
+    (void) sampler;
+    (void) interval_us;
+    return false;
+}
+
+void vm_sampler_stop(VMSampler *sampler)
+{
+    (void) sampler;
+}
+
+#endif
+
+static size_t chunk_instruction_size(Chunk *chunk, size_t offset)
+{
+    assert((COUNT_CHUNK_FORMATS == 2) && "Exhaustive chunk formats handling");
+    switch (chunk->format) {
+        case CHUNK_FORMAT_STACK:
+            return stack_instruction_size(chunk->code[offset]);
+        case CHUNK_FORMAT_REGISTER:
+            return SKARD_REGISTER_INSTRUCTION_SIZE;
+        default:
+            break;
+    }
+
+    return 1;
+}
+
+void vm_sampler_write_folded(const VMSampler *sampler, Chunk *chunk, const char *name, FILE *file)
+{
+    // Samples are offsets of instructions as the VM published them before executing each one
+    size_t *counts = SKARD_GROW_ARRAY(size_t, NULL, chunk->count);
+    for (size_t offset = 0; offset < chunk->count; offset++) {
+        counts[offset] = 0;
+    }
+    size_t native_count = 0;
+    for (size_t i = 0; i < sampler->samples_count; i++) {
+        size_t sample = sampler->samples[i];
+        if (sample == SKARD_SAMPLE_NATIVE) {
+            native_count++;
+        } else if (sample < chunk->count) {
+            counts[sample]++;
+        }
+    }
+
+    size_t offset = 0;
+    while (offset < chunk->count) {
+        size_t size = chunk_instruction_size(chunk, offset);
+        size_t count = 0;
+        for (size_t i = offset; i < offset + size && i < chunk->count; i++) {
+            count += counts[i];
+        }
+
+        if (count > 0) {
+            size_t line = debug_info_read_line(&chunk->debug_info, offset);
+            size_t column = debug_info_read_column(&chunk->debug_info, offset);
+            fprintf(file, "%s;%s:%zu;%s:%zu:%zu", name, name, line, name, line, column);
+            if (chunk->format == CHUNK_FORMAT_STACK) {
+                fprintf(file, ";%s", translate_op(chunk->code[offset]));
+            }
+            fprintf(file, " %zu\n", count);
+        }
+        offset += size;
+    }
+
+    if (native_count > 0) {
+        fprintf(file, "%s;[native] %zu\n", name, native_count);
+    }
+
+    counts = SKARD_FREE_ARRAY(size_t, counts);
+}
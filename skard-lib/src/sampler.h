@@ -0,0 +1,36 @@
+#ifndef SKARD_SAMPLER_H
+#define SKARD_SAMPLER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+#define SKARD_SAMPLER_DEFAULT_INTERVAL_US 1000
+#define SKARD_SAMPLER_DEFAULT_CAPACITY 65536
+// Recorded while the VM runs generated code, which does not maintain the instruction pointer
+#define SKARD_SAMPLE_NATIVE SIZE_MAX
+
+// Samples the instruction a VM runs from a SIGPROF timer. Samples are stored as offsets into the chunk the VM was
+// running, read from the offset the VM publishes while sampled. The buffer is allocated up front because the signal
+// handler cannot allocate.
+typedef struct {
+    SkardVM *vm;
+    size_t samples_count;
+    size_t samples_capacity;
+    size_t *samples;
+    size_t dropped_count;
+} VMSampler;
+
+void vm_sampler_init(VMSampler *sampler, SkardVM *vm, size_t capacity);
+void vm_sampler_free(VMSampler *sampler);
+
+// Only one sampler can be active per process, returns false when another one is or timers are unavailable
+bool vm_sampler_start(VMSampler *sampler, size_t interval_us);
+void vm_sampler_stop(VMSampler *sampler);
+
+// Writes folded stacks (name;name:line;name:line:column;op count) as consumed by flamegraph.pl
+void vm_sampler_write_folded(const VMSampler *sampler, Chunk *chunk, const char *name, FILE *file);
+
+#endif //SKARD_SAMPLER_H
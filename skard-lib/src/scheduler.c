@@ -0,0 +1,269 @@
+#include "scheduler.h"
+
+#include "utils.h"
+
+#ifdef SKARD_SCHEDULER
+
+#define SKARD_TASK_QUEUE_MIN_CAPACITY 16
+
+void skard_task_init(SkardTask *task, FrozenChunk *chunk)
+{
+    vm_init(&task->vm);
+    task->chunk = frozen_chunk_retain(chunk);
+    task->is_started = false;
+    task->slices_count = 0;
+    task->result = INTERPRETER_OK;
+    task->on_yield = NULL;
+    task->on_finish = NULL;
+    task->data = NULL;
+}
+
+void skard_task_free(SkardTask *task)
+{
+    vm_free(&task->vm);
+    frozen_chunk_release(task->chunk);
+    task->chunk = NULL;
+}
+
+static void task_queue_init(TaskQueue *queue)
+{
+    pthread_mutex_init(&queue->lock, NULL);
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = 0;
+    queue->tasks = NULL;
+}
+
+static void task_queue_free(TaskQueue *queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    queue->tasks = SKARD_FREE_ARRAY(SkardTask *, queue->tasks);
+    queue->capacity = 0;
+    queue->count = 0;
+}
+
+static void task_queue_push_back(TaskQueue *queue, SkardTask *task)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity < SKARD_TASK_QUEUE_MIN_CAPACITY
+                          ? SKARD_TASK_QUEUE_MIN_CAPACITY
+                          : queue->capacity * 2;
+        SkardTask **tasks = SKARD_GROW_ARRAY(SkardTask *, NULL, capacity);
+        for (size_t i = 0; i < queue->count; i++) {
+            tasks[i] = queue->tasks[(queue->head + i) & (queue->capacity - 1)];
+        }
+        SKARD_FREE_ARRAY(SkardTask *, queue->tasks);
+        queue->tasks = tasks;
+        queue->capacity = capacity;
+        queue->head = 0;
+    }
+    queue->tasks[(queue->head + queue->count) & (queue->capacity - 1)] = task;
+    queue->count++;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static SkardTask *task_queue_pop_front(TaskQueue *queue)
+{
+    SkardTask *task = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0) {
+        task = queue->tasks[queue->head];
+        queue->head = (queue->head + 1) & (queue->capacity - 1);
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return task;
+}
+
+static SkardTask *task_queue_pop_back(TaskQueue *queue)
+{
+    SkardTask *task = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0) {
+        queue->count--;
+        task = queue->tasks[(queue->head + queue->count) & (queue->capacity - 1)];
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return task;
+}
+
+// Pushes under the scheduler lock so a worker about to sleep cannot miss the task. The count goes up before the task
+// is visible, a thief that takes it right away can only count it down after that.
+static void scheduler_enqueue(Scheduler *scheduler, size_t queue_index, SkardTask *task)
+{
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->queued_count++;
+    task_queue_push_back(&scheduler->queues[queue_index], task);
+    if (scheduler->sleeping_count > 0) {
+        pthread_cond_signal(&scheduler->has_work);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+static SkardTask *scheduler_take(Scheduler *scheduler, size_t worker_index)
+{
+    SkardTask *task = task_queue_pop_front(&scheduler->queues[worker_index]);
+    for (size_t i = 1; task == NULL && i < scheduler->workers_count; i++) {
+        task = task_queue_pop_back(&scheduler->queues[(worker_index + i) % scheduler->workers_count]);
+        if (task != NULL) {
+            __atomic_add_fetch(&scheduler->steals_count, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (task != NULL) {
+        pthread_mutex_lock(&scheduler->lock);
+        scheduler->queued_count--;
+        pthread_mutex_unlock(&scheduler->lock);
+    }
+    return task;
+}
+
+static void scheduler_run_slice(Scheduler *scheduler, size_t worker_index, SkardTask *task)
+{
+    task->vm.fuel = scheduler->slice;
+    task->slices_count++;
+    InterpreterResult result = task->is_started ? vm_resume(&task->vm) : vm_run(&task->vm, &task->chunk->chunk);
+    task->is_started = true;
+    // A yielded value is handed over within the slice, the rest of the budget stays with the task
+    while (result == INTERPRETER_SUSPENDED) {
+        if (task->on_yield != NULL) {
+            task->on_yield(task, task->vm.yielded, task->vm.yielded_kind, task->data);
+        }
+        result = vm_resume(&task->vm);
+    }
+
+    if (result == INTERPRETER_YIELD) {
+        scheduler_enqueue(scheduler, worker_index, task);
+        return;
+    }
+
+    task->result = result;
+    if (task->on_finish != NULL) {
+        task->on_finish(task, task->data);
+    }
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->pending_count--;
+    if (scheduler->pending_count == 0) {
+        pthread_cond_broadcast(&scheduler->is_done);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+typedef struct {
+    Scheduler *scheduler;
+    size_t index;
+} WorkerContext;
+
+static void *scheduler_worker(void *argument)
+{
+    WorkerContext context = *(WorkerContext *) argument;
+    free(argument);
+    Scheduler *scheduler = context.scheduler;
+
+    while (true) {
+        SkardTask *task = scheduler_take(scheduler, context.index);
+        if (task != NULL) {
+            scheduler_run_slice(scheduler, context.index, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler->lock);
+        while (scheduler->queued_count == 0 && !scheduler->is_stopping) {
+            scheduler->sleeping_count++;
+            pthread_cond_wait(&scheduler->has_work, &scheduler->lock);
+            scheduler->sleeping_count--;
+        }
+        bool is_stopping = scheduler->is_stopping;
+        pthread_mutex_unlock(&scheduler->lock);
+        if (is_stopping) {
+            return NULL;
+        }
+    }
+}
+
+// Stops the first started_count workers, which is fewer than the pool when scheduler_init failed halfway
+static void scheduler_shutdown(Scheduler *scheduler, size_t started_count)
+{
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->is_stopping = true;
+    pthread_cond_broadcast(&scheduler->has_work);
+    pthread_mutex_unlock(&scheduler->lock);
+
+    for (size_t i = 0; i < started_count; i++) {
+        pthread_join(scheduler->workers[i], NULL);
+    }
+
+    for (size_t i = 0; i < scheduler->workers_count; i++) {
+        task_queue_free(&scheduler->queues[i]);
+    }
+    scheduler->queues = SKARD_FREE_ARRAY(TaskQueue, scheduler->queues);
+    scheduler->workers = SKARD_FREE_ARRAY(pthread_t, scheduler->workers);
+    scheduler->workers_count = 0;
+
+    pthread_cond_destroy(&scheduler->is_done);
+    pthread_cond_destroy(&scheduler->has_work);
+    pthread_mutex_destroy(&scheduler->lock);
+}
+
+bool scheduler_init(Scheduler *scheduler, size_t workers_count, size_t slice)
+{
+    scheduler->slice = slice == 0 ? SKARD_SCHEDULER_DEFAULT_SLICE : slice;
+    scheduler->workers_count = workers_count == 0 ? 1 : workers_count;
+    scheduler->workers = SKARD_GROW_ARRAY(pthread_t, NULL, scheduler->workers_count);
+    scheduler->queues = SKARD_GROW_ARRAY(TaskQueue, NULL, scheduler->workers_count);
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->has_work, NULL);
+    pthread_cond_init(&scheduler->is_done, NULL);
+    scheduler->queued_count = 0;
+    scheduler->sleeping_count = 0;
+    scheduler->pending_count = 0;
+    scheduler->next_queue = 0;
+    scheduler->is_stopping = false;
+    scheduler->steals_count = 0;
+
+    for (size_t i = 0; i < scheduler->workers_count; i++) {
+        task_queue_init(&scheduler->queues[i]);
+    }
+
+    for (size_t i = 0; i < scheduler->workers_count; i++) {
+        WorkerContext *context = SKARD_ALLOCATE(WorkerContext);
+        context->scheduler = scheduler;
+        context->index = i;
+        if (pthread_create(&scheduler->workers[i], NULL, scheduler_worker, context) != 0) {
+            free(context);
+            scheduler_shutdown(scheduler, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void scheduler_free(Scheduler *scheduler)
+{
+    scheduler_shutdown(scheduler, scheduler->workers_count);
+}
+
+void scheduler_submit(Scheduler *scheduler, SkardTask *task)
+{
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->pending_count++;
+    size_t queue_index = scheduler->next_queue;
+    scheduler->next_queue = (scheduler->next_queue + 1) % scheduler->workers_count;
+    pthread_mutex_unlock(&scheduler->lock);
+
+    scheduler_enqueue(scheduler, queue_index, task);
+}
+
+void scheduler_wait(Scheduler *scheduler)
+{
+    pthread_mutex_lock(&scheduler->lock);
+    while (scheduler->pending_count > 0) {
+        pthread_cond_wait(&scheduler->is_done, &scheduler->lock);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+#endif
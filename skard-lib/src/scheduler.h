@@ -0,0 +1,74 @@
+#ifndef SKARD_SCHEDULER_H
+#define SKARD_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chunk.h"
+#include "vm.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKARD_SCHEDULER
+#endif
+
+#ifdef SKARD_SCHEDULER
+
+#include <pthread.h>
+
+#define SKARD_SCHEDULER_DEFAULT_SLICE 10000
+
+// One script run, the VM keeps its state between time slices and may continue on any worker
+typedef struct SkardTask {
+    SkardVM vm;
+    FrozenChunk *chunk;
+    bool is_started;
+    size_t slices_count;
+    InterpreterResult result;
+    // Called on the worker that ran the yield, the task continues with whatever value is left in the slot.
+    // Without it yielded values pass through unchanged.
+    void (*on_yield)(struct SkardTask *task, Value *value, TypeKind kind, void *data);
+    // Called on the worker that finished the task
+    void (*on_finish)(struct SkardTask *task, void *data);
+    void *data;
+} SkardTask;
+
+void skard_task_init(SkardTask *task, FrozenChunk *chunk);
+void skard_task_free(SkardTask *task);
+
+// Double-ended ring of runnable tasks, the owning worker takes from the front and thieves from the back
+typedef struct {
+    pthread_mutex_t lock;
+    size_t head;
+    size_t count;
+    size_t capacity;
+    SkardTask **tasks;
+} TaskQueue;
+
+// Runs tasks on a fixed pool of workers. Every task gets slice instructions before it is put back at the end of its
+// worker's queue, idle workers steal from the others.
+typedef struct {
+    size_t slice;
+    size_t workers_count;
+    pthread_t *workers;
+    TaskQueue *queues;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work;
+    pthread_cond_t is_done;
+    size_t queued_count;
+    size_t sleeping_count;
+    size_t pending_count;
+    size_t next_queue;
+    bool is_stopping;
+    uint64_t steals_count;
+} Scheduler;
+
+bool scheduler_init(Scheduler *scheduler, size_t workers_count, size_t slice);
+void scheduler_free(Scheduler *scheduler);
+
+void scheduler_submit(Scheduler *scheduler, SkardTask *task);
+// Blocks until every submitted task finished
+void scheduler_wait(Scheduler *scheduler);
+
+#endif
+
+#endif //SKARD_SCHEDULER_H
@@ -12,8 +12,17 @@
 
 #include "chunk.h"
 #include "vm.h"
+#include "native.h"
+#include "coroutine.h"
+#include "jit.h"
 #include "debug.h"
+#include "profile.h"
+#include "sampler.h"
+#include "trace.h"
 #include "compiler.h"
+#include "chunk_cache.h"
+#include "skc.h"
+#include "scheduler.h"
 
 
 #endif //SKARD_SKARD_H
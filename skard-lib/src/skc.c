@@ -0,0 +1,435 @@
+#include "skc.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKARD_SKC_MAPPABLE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static void skc_report(FILE *errors, const char *format, ...)
+{
+    if (errors == NULL) {
+        return;
+    }
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(errors, format, arguments);
+    va_end(arguments);
+}
+
+static long skc_process_id(void)
+{
+#ifdef SKARD_SKC_MAPPABLE
+    return (long) getpid();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t skc_align(uint64_t offset)
+{
+    return (offset + SKARD_SKC_ALIGNMENT - 1) / SKARD_SKC_ALIGNMENT * SKARD_SKC_ALIGNMENT;
+}
+
+static bool skc_write_section(FILE *file, uint64_t *position, uint64_t offset, const void *data, size_t size)
+{
+    static const uint8_t padding[SKARD_SKC_ALIGNMENT] = { 0 };
+    if (fwrite(padding, 1, offset - *position, file) != offset - *position) {
+        return false;
+    }
+    if (size > 0 && fwrite(data, 1, size, file) != size) {
+        return false;
+    }
+    *position = offset + size;
+    return true;
+}
+
+typedef struct {
+    uint64_t offset;
+    const void *data;
+    size_t size;
+} SkcSection;
+
+// Sections have to be sorted by offset. Errors are reported to the given stream, NULL keeps quiet.
+static bool skc_write_sections(const char *filename, const SkcSection *sections, size_t sections_count, FILE *errors)
+{
+    // Written next to the destination and renamed over it, readers never see a partial file
+    size_t temporary_size = strlen(filename) + 32;
+    char *temporary = SKARD_GROW_ARRAY(char, NULL, temporary_size);
+    snprintf(temporary, temporary_size, "%s.%ld.tmp", filename, skc_process_id());
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL) {
+        skc_report(errors, "ERROR: Could not open file \"%s\"\n", temporary);
+        SKARD_FREE_ARRAY(char, temporary);
+        return false;
+    }
+
+    uint64_t position = 0;
+    bool result = true;
+    for (size_t i = 0; i < sections_count && result; i++) {
+        result = skc_write_section(file, &position, sections[i].offset, sections[i].data, sections[i].size);
+    }
+    result = fclose(file) == 0 && result;
+    if (result && rename(temporary, filename) != 0) {
+        result = false;
+    }
+    if (!result) {
+        remove(temporary);
+        skc_report(errors, "ERROR: Could not write file \"%s\"\n", filename);
+    }
+    SKARD_FREE_ARRAY(char, temporary);
+    return result;
+}
+
+// Ties a stripped chunk to its side file, never 0
+static uint64_t skc_debug_id(Chunk *chunk)
+{
+    uint64_t hash = hash_bytes(chunk->code, chunk->count, SKARD_HASH_SEED);
+    hash = hash_bytes(chunk->debug_info.bytes, chunk->debug_info.bytes_count, hash);
+    return hash | 1;
+}
+
+static bool skc_write_debug(Chunk *chunk, const char *filename, uint64_t debug_id, FILE *errors)
+{
+    const DebugInfo *debug_info = &chunk->debug_info;
+    SkdHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SKARD_SKD_MAGIC, sizeof(header.magic));
+    header.byte_order = SKARD_SKC_BYTE_ORDER;
+    header.version = SKARD_SKC_VERSION;
+    header.debug_entry_size = sizeof(DebugCheckpoint);
+    header.debug_id = debug_id;
+    header.code_count = chunk->count;
+    header.locations_size = debug_info->bytes_count;
+    header.locations_offset = skc_align(sizeof(header));
+    header.checkpoints_count = debug_info->checkpoints_count;
+    header.checkpoints_offset = skc_align(header.locations_offset + header.locations_size);
+
+    SkcSection sections[] = {
+        { 0, &header, sizeof(header) },
+        { header.locations_offset, debug_info->bytes, debug_info->bytes_count },
+        { header.checkpoints_offset, debug_info->checkpoints, debug_info->checkpoints_count * sizeof(DebugCheckpoint) },
+    };
+    return skc_write_sections(filename, sections, sizeof(sections) / sizeof(sections[0]), errors);
+}
+
+static uint64_t skc_natives_hash(const NativeRegistry *natives)
+{
+    return natives != NULL ? native_registry_hash(natives, SKARD_HASH_SEED) : SKARD_HASH_SEED;
+}
+
+static uint64_t skc_source_hash(const char *source, size_t source_length)
+{
+    return source != NULL ? hash_bytes_mixed(source, source_length) : 0;
+}
+
+static bool skc_write(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source,
+                      bool is_stripped, FILE *errors)
+{
+    const DebugInfo *debug_info = &chunk->debug_info;
+    SkcHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SKARD_SKC_MAGIC, sizeof(header.magic));
+    header.byte_order = SKARD_SKC_BYTE_ORDER;
+    header.version = SKARD_SKC_VERSION;
+    header.value_size = sizeof(Value);
+    header.debug_entry_size = sizeof(DebugCheckpoint);
+    header.format = chunk->format;
+    header.registers_count = chunk->registers_count;
+    header.natives_hash = skc_natives_hash(natives);
+    header.source_length = source != NULL ? strlen(source) : 0;
+    header.source_hash = skc_source_hash(source, header.source_length);
+
+    header.code_count = chunk->count;
+    header.code_offset = skc_align(sizeof(header));
+    header.constants_count = chunk->constants.count;
+    header.constants_offset = skc_align(header.code_offset + header.code_count);
+    header.locations_size = is_stripped ? 0 : debug_info->bytes_count;
+    header.locations_offset = skc_align(header.constants_offset + header.constants_count * sizeof(Value));
+    header.checkpoints_count = is_stripped ? 0 : debug_info->checkpoints_count;
+    header.checkpoints_offset = skc_align(header.locations_offset + header.locations_size);
+
+    if (is_stripped) {
+        header.debug_id = skc_debug_id(chunk);
+        char *debug_filename = skc_debug_filename(filename);
+        bool is_written = skc_write_debug(chunk, debug_filename, header.debug_id, errors);
+        SKARD_FREE_ARRAY(char, debug_filename);
+        if (!is_written) {
+            return false;
+        }
+    }
+
+    SkcSection sections[] = {
+        { 0, &header, sizeof(header) },
+        { header.code_offset, chunk->code, chunk->count },
+        { header.constants_offset, chunk->constants.values, chunk->constants.count * sizeof(Value) },
+        { header.locations_offset, debug_info->bytes, header.locations_size },
+        { header.checkpoints_offset, debug_info->checkpoints, header.checkpoints_count * sizeof(DebugCheckpoint) },
+    };
+    return skc_write_sections(filename, sections, sizeof(sections) / sizeof(sections[0]), errors);
+}
+
+bool skc_write_file(Chunk *chunk, const char *filename, const NativeRegistry *natives)
+{
+    return skc_write(chunk, filename, natives, NULL, false, stderr);
+}
+
+bool skc_write_stripped_file(Chunk *chunk, const char *filename, const NativeRegistry *natives)
+{
+    return skc_write(chunk, filename, natives, NULL, true, stderr);
+}
+
+bool skc_try_write_file(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source)
+{
+    return skc_write(chunk, filename, natives, source, false, NULL);
+}
+
+static bool skc_section_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size)
+{
+    return offset % SKARD_SKC_ALIGNMENT == 0 && offset <= file_size &&
+           count <= (file_size - offset) / element_size;
+}
+
+// A NULL source accepts the file whatever it was compiled from
+static const char *skc_validate_header(const SkcHeader *header, uint64_t file_size, uint64_t natives_hash,
+                                       const char *source)
+{
+    if (memcmp(header->magic, SKARD_SKC_MAGIC, sizeof(header->magic)) != 0) {
+        return "not a compiled Skard file";
+    }
+    if (header->byte_order != SKARD_SKC_BYTE_ORDER) {
+        return "compiled on a machine with a different byte order";
+    }
+    if (header->version != SKARD_SKC_VERSION) {
+        return "unsupported version";
+    }
+    if (header->value_size != sizeof(Value) || header->debug_entry_size != sizeof(DebugCheckpoint)) {
+        return "compiled with a different value layout";
+    }
+    if (header->format >= COUNT_CHUNK_FORMATS) {
+        return "unknown chunk format";
+    }
+    if (header->natives_hash != natives_hash) {
+        return "compiled against different native functions";
+    }
+    if (source != NULL) {
+        size_t source_length = strlen(source);
+        if (header->source_length != source_length ||
+            header->source_hash != skc_source_hash(source, source_length)) {
+            return "compiled from a different source";
+        }
+    }
+    if (!skc_section_fits(header->code_offset, header->code_count, 1, file_size) ||
+        !skc_section_fits(header->constants_offset, header->constants_count, sizeof(Value), file_size) ||
+        !skc_section_fits(header->locations_offset, header->locations_size, 1, file_size) ||
+        !skc_section_fits(header->checkpoints_offset, header->checkpoints_count, sizeof(DebugCheckpoint),
+                          file_size)) {
+        return "section out of bounds";
+    }
+    if (header->debug_id != 0 && (header->locations_size != 0 || header->checkpoints_count != 0)) {
+        return "malformed debug info";
+    }
+    return NULL;
+}
+
+// Points the debug info into the mapping, or at the side file of a stripped chunk
+static const char *skc_attach_debug_info(DebugInfo *debug_info, const SkcHeader *header, const uint8_t *mapping,
+                                         const char *filename)
+{
+    if (header->debug_id != 0) {
+        debug_info->count = header->code_count;
+        debug_info->side_path = skc_debug_filename(filename);
+        debug_info->side_id = header->debug_id;
+        return NULL;
+    }
+
+    debug_info->count = header->code_count;
+    debug_info->bytes = (uint8_t *) (mapping + header->locations_offset);
+    debug_info->bytes_count = header->locations_size;
+    debug_info->checkpoints = (DebugCheckpoint *) (mapping + header->checkpoints_offset);
+    debug_info->checkpoints_count = header->checkpoints_count;
+    return debug_info_is_valid(debug_info) ? NULL : "malformed debug info";
+}
+
+#ifdef SKARD_SKC_MAPPABLE
+
+static bool skc_map(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source,
+                    FILE *errors)
+{
+    chunk_init(chunk);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        skc_report(errors, "ERROR: Could not open file \"%s\"\n", filename);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t) info.st_size < sizeof(SkcHeader)) {
+        close(fd);
+        skc_report(errors, "ERROR: Invalid compiled file \"%s\": truncated\n", filename);
+        return false;
+    }
+
+    size_t size = (size_t) info.st_size;
+    uint8_t *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        skc_report(errors, "ERROR: Could not map file \"%s\"\n", filename);
+        return false;
+    }
+
+    const SkcHeader *header = (const SkcHeader *) mapping;
+    const char *problem = skc_validate_header(header, size, skc_natives_hash(natives), source);
+    if (problem == NULL) {
+        problem = skc_attach_debug_info(&chunk->debug_info, header, mapping, filename);
+    }
+    if (problem != NULL) {
+        SKARD_FREE_ARRAY(char, chunk->debug_info.side_path);
+        chunk_init(chunk);
+        munmap(mapping, size);
+        skc_report(errors, "ERROR: Invalid compiled file \"%s\": %s\n", filename, problem);
+        return false;
+    }
+
+    // Capacities stay 0, nothing may grow arrays that live in the mapping
+    chunk->mapping = mapping;
+    chunk->mapping_size = size;
+    chunk->format = (ChunkFormat) header->format;
+    chunk->registers_count = header->registers_count;
+    chunk->code = mapping + header->code_offset;
+    chunk->count = header->code_count;
+    chunk->constants.values = (Value *) (mapping + header->constants_offset);
+    chunk->constants.count = header->constants_count;
+    return true;
+}
+
+void skc_unmap(Chunk *chunk)
+{
+    if (chunk->mapping != NULL) {
+        munmap(chunk->mapping, chunk->mapping_size);
+    }
+    chunk->mapping = NULL;
+    chunk->mapping_size = 0;
+}
+
+#else
+
+static bool skc_map(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source,
+                    FILE *errors)
+{
+    (void) natives;
+    (void) source;
+    chunk_init(chunk);
+    skc_report(errors, "ERROR: Cannot map \"%s\", compiled files are not supported on this platform\n", filename);
+    return false;
+}
+
+void skc_unmap(Chunk *chunk)
+{
+    chunk->mapping = NULL;
+    chunk->mapping_size = 0;
+}
+
+#endif
+
+bool skc_map_file(Chunk *chunk, const char *filename, const NativeRegistry *natives)
+{
+    return skc_map(chunk, filename, natives, NULL, stderr);
+}
+
+bool skc_try_map_file(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source)
+{
+    return skc_map(chunk, filename, natives, source, NULL);
+}
+
+char *skc_debug_filename(const char *filename)
+{
+    size_t length = strlen(filename);
+    bool has_extension = length >= 4 && strcmp(filename + length - 4, ".skc") == 0;
+    char *debug_filename = SKARD_GROW_ARRAY(char, NULL, length + 5);
+    memcpy(debug_filename, filename, length);
+    strcpy(debug_filename + (has_extension ? length - 4 : length), ".skd");
+    return debug_filename;
+}
+
+static const char *skc_validate_debug_header(const SkdHeader *header, uint64_t file_size, uint64_t debug_id)
+{
+    if (memcmp(header->magic, SKARD_SKD_MAGIC, sizeof(header->magic)) != 0 ||
+        header->byte_order != SKARD_SKC_BYTE_ORDER || header->version != SKARD_SKC_VERSION ||
+        header->debug_entry_size != sizeof(DebugCheckpoint)) {
+        return "not a compatible debug file";
+    }
+    if (header->debug_id != debug_id) {
+        return "belongs to another chunk";
+    }
+    if (!skc_section_fits(header->locations_offset, header->locations_size, 1, file_size) ||
+        !skc_section_fits(header->checkpoints_offset, header->checkpoints_count, sizeof(DebugCheckpoint),
+                          file_size)) {
+        return "section out of bounds";
+    }
+    return NULL;
+}
+
+// Read rather than mapped, the tables are small and this also works where files cannot be mapped
+bool skc_load_debug_file(DebugInfo *debug_info, const char *filename, uint64_t debug_id)
+{
+    debug_info_init(debug_info);
+    char *contents = NULL;
+    size_t size = 0;
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long end = ftell(file);
+        if (end >= (long) sizeof(SkdHeader) && fseek(file, 0, SEEK_SET) == 0) {
+            size = (size_t) end;
+            contents = SKARD_GROW_ARRAY(char, NULL, size);
+            if (fread(contents, 1, size, file) != size) {
+                contents = SKARD_FREE_ARRAY(char, contents);
+            }
+        }
+    }
+    fclose(file);
+    if (contents == NULL) {
+        return false;
+    }
+
+    SkdHeader header;
+    memcpy(&header, contents, sizeof(header));
+    if (skc_validate_debug_header(&header, size, debug_id) != NULL) {
+        SKARD_FREE_ARRAY(char, contents);
+        return false;
+    }
+
+    debug_info->count = header.code_count;
+    debug_info->bytes_count = header.locations_size;
+    debug_info->bytes_capacity = header.locations_size;
+    debug_info->bytes = SKARD_GROW_ARRAY(uint8_t, NULL, debug_info->bytes_capacity);
+    debug_info->checkpoints_count = header.checkpoints_count;
+    debug_info->checkpoints_capacity = header.checkpoints_count;
+    debug_info->checkpoints = SKARD_GROW_ARRAY(DebugCheckpoint, NULL, debug_info->checkpoints_capacity);
+    if (header.locations_size > 0) {
+        memcpy(debug_info->bytes, contents + header.locations_offset, header.locations_size);
+    }
+    if (header.checkpoints_count > 0) {
+        memcpy(debug_info->checkpoints, contents + header.checkpoints_offset,
+               header.checkpoints_count * sizeof(DebugCheckpoint));
+    }
+    SKARD_FREE_ARRAY(char, contents);
+
+    if (!debug_info_is_valid(debug_info)) {
+        debug_info_free(debug_info);
+        return false;
+    }
+    return true;
+}
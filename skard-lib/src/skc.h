@@ -0,0 +1,78 @@
+#ifndef SKARD_SKC_H
+#define SKARD_SKC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chunk.h"
+
+#define SKARD_SKC_MAGIC "SKC"
+#define SKARD_SKD_MAGIC "SKD"
+#define SKARD_SKC_BYTE_ORDER 0x01020304u
+#define SKARD_SKC_VERSION 6
+#define SKARD_SKC_ALIGNMENT 8
+
+// Compiled chunk file. Sections are addressed by offsets from the start of the file and aligned to 8 bytes, so the
+// mapped file is used as the chunk's code, constant pool and debug info without copying. Values and debug
+// checkpoints are stored in the in-memory layout of the writer, the header records enough of it to refuse
+// incompatible files.
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t value_size;
+    uint32_t debug_entry_size;
+    uint32_t format;
+    uint64_t registers_count;
+    uint64_t code_offset;
+    uint64_t code_count;
+    uint64_t constants_offset;
+    uint64_t constants_count;
+    uint64_t locations_offset;
+    uint64_t locations_size;
+    uint64_t checkpoints_offset;
+    uint64_t checkpoints_count;
+    // Nonzero when the debug info was stripped into a side file, which carries the same id
+    uint64_t debug_id;
+    // Chunks address natives by index, a file only runs against the registry it was compiled with
+    uint64_t natives_hash;
+    // Source of a chunk written by a cache, checked before the file is used. Both are 0 for other files.
+    uint64_t source_length;
+    uint64_t source_hash;
+} SkcHeader;
+
+// Side file with the debug info of a stripped chunk, read into memory only when a location is looked up
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t debug_entry_size;
+    uint64_t debug_id;
+    uint64_t code_count;
+    uint64_t locations_offset;
+    uint64_t locations_size;
+    uint64_t checkpoints_offset;
+    uint64_t checkpoints_count;
+} SkdHeader;
+
+// Replaces the file atomically, concurrent writers and readers see either the old or the new contents. The natives are
+// the registry the chunk was compiled against, NULL when there is none.
+bool skc_write_file(Chunk *chunk, const char *filename, const NativeRegistry *natives);
+// Leaves the debug info out of the file and writes it next to it, to the name given by skc_debug_filename
+bool skc_write_stripped_file(Chunk *chunk, const char *filename, const NativeRegistry *natives);
+// Maps the file read-only and points the chunk into it, chunk_free unmaps it again. Files written with different
+// natives are refused.
+bool skc_map_file(Chunk *chunk, const char *filename, const NativeRegistry *natives);
+
+// Variants for caches that print nothing, a missing or incompatible file is just a miss there. Caches name files
+// after a hash of the source, the source is recorded in the file too so a collision or a stale file is a miss.
+bool skc_try_write_file(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source);
+bool skc_try_map_file(Chunk *chunk, const char *filename, const NativeRegistry *natives, const char *source);
+void skc_unmap(Chunk *chunk);
+
+// file.skc becomes file.skd, anything else gets the extension appended. The result is owned by the caller.
+char *skc_debug_filename(const char *filename);
+// Quietly fails when the file is missing, malformed or belongs to another chunk
+bool skc_load_debug_file(DebugInfo *debug_info, const char *filename, uint64_t debug_id);
+
+#endif //SKARD_SKC_H
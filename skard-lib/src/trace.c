@@ -0,0 +1,57 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "utils.h"
+#include "debug.h"
+
+void trace_buffer_init(TraceBuffer *buffer, size_t capacity)
+{
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+
+    buffer->capacity = rounded;
+    buffer->count = 0;
+    buffer->records = SKARD_GROW_ARRAY(TraceRecord, NULL, rounded);
+}
+
+void trace_buffer_free(TraceBuffer *buffer)
+{
+    buffer->records = SKARD_FREE_ARRAY(TraceRecord, buffer->records);
+    buffer->capacity = 0;
+    buffer->count = 0;
+}
+
+void trace_buffer_clear(TraceBuffer *buffer)
+{
+    buffer->count = 0;
+}
+
+void trace_buffer_print(const TraceBuffer *buffer, Chunk *chunk, size_t count)
+{
+    uint64_t kept = buffer->count < buffer->capacity ? buffer->count : buffer->capacity;
+    if (count == 0 || count > kept) {
+        count = (size_t) kept;
+    }
+
+    if (buffer->count > count) {
+        printf("... %" PRIu64 " earlier instructions\n", buffer->count - count);
+    }
+    for (uint64_t i = buffer->count - count; i < buffer->count; i++) {
+        const TraceRecord *record = &buffer->records[i & (buffer->capacity - 1)];
+        printf("{ depth %u | top ", record->depth);
+        print_value(record->top);
+        printf(" }\n");
+
+        // The chunk may have been rewritten since the record was taken
+        if (record->offset >= chunk->count || chunk->code[record->offset] != record->op) {
+            printf("%06u | stale record for op %u\n", record->offset, record->op);
+            continue;
+        }
+        disassemble_instruction(chunk, record->offset);
+        printf("\n");
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SKARD_TRACE_H
+#define SKARD_TRACE_H
+
+#include <stdint.h>
+
+#include "chunk.h"
+#include "value.h"
+
+#define SKARD_TRACE_DEFAULT_CAPACITY 4096
+
+// One executed instruction, top holds the value on top of the stack (the A register for register chunks) right
+// before the instruction ran
+typedef struct {
+    uint32_t offset;
+    uint16_t depth;
+    uint8_t op;
+    Value top;
+} TraceRecord;
+
+// Fixed-size ring of the most recently executed instructions, the capacity is a power of two
+typedef struct {
+    size_t capacity;
+    uint64_t count;
+    TraceRecord *records;
+} TraceBuffer;
+
+void trace_buffer_init(TraceBuffer *buffer, size_t capacity);
+void trace_buffer_free(TraceBuffer *buffer);
+void trace_buffer_clear(TraceBuffer *buffer);
+
+// Disassembles the last count records of the buffer, oldest first, count 0 prints everything that was kept
+void trace_buffer_print(const TraceBuffer *buffer, Chunk *chunk, size_t count);
+
+static inline void trace_buffer_append(TraceBuffer *buffer, size_t offset, uint8_t op, size_t depth, Value top)
+{
+    TraceRecord *record = &buffer->records[buffer->count & (buffer->capacity - 1)];
+    record->offset = (uint32_t) offset;
+    record->depth = depth > UINT16_MAX ? UINT16_MAX : (uint16_t) depth;
+    record->op = op;
+    record->top = top;
+    buffer->count++;
+}
+
+#endif //SKARD_TRACE_H
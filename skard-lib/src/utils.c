@@ -56,3 +56,32 @@ char *read_file(const char *filename)
     fclose(file);
     return buffer;
 }
+
+// FNV-1a, chaining calls with the previous result as seed hashes the concatenation
+uint64_t hash_bytes(const void *data, size_t length, uint64_t seed)
+{
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+// Multiplies by the golden ratio and folds the high bits back in after every byte, then finalizes like splitmix64
+uint64_t hash_bytes_mixed(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint64_t hash = length;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash + bytes[i] + 1) * 0x9E3779B97F4A7C15u;
+        hash ^= hash >> 29;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9u;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBu;
+    hash ^= hash >> 31;
+    return hash;
+}
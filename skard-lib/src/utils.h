@@ -2,6 +2,7 @@
 #define SKARD_UTILS_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
 void *reallocate(void *pointer, size_t new_size);
 void *allocate(size_t new_size);
@@ -20,4 +21,10 @@ void *allocate(size_t new_size);
 
 char *read_file(const char *filename);
 
+#define SKARD_HASH_SEED 14695981039346656037u
+
+uint64_t hash_bytes(const void *data, size_t length, uint64_t seed);
+// Unrelated to hash_bytes, confirms that inputs with the same hash_bytes value are really the same
+uint64_t hash_bytes_mixed(const void *data, size_t length);
+
 #endif //SKARD_UTILS_H
@@ -1,6 +1,8 @@
 #include "value.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
 #include <assert.h>
 
 #include "utils.h"
@@ -10,6 +12,7 @@ SkardType make_skard_type_simple(TypeKind type)
 {
     SkardType skard_type;
     skard_type.kind = type;
+    skard_type.layout = NULL;
     return skard_type;
 }
 
@@ -33,10 +36,18 @@ SkardType make_skard_type_int(void)
     return make_skard_type_simple(TYPE_INT);
 }
 
+SkardType make_skard_type_struct(StructLayout *layout)
+{
+    SkardType skard_type = make_skard_type_simple(TYPE_STRUCT);
+    skard_type.layout = layout;
+    return skard_type;
+}
+
 SkardType copy_skard_type(SkardType *source)
 {
     SkardType destination;
     destination.kind = source->kind;
+    destination.layout = source->layout;
     return destination;
 }
 
@@ -57,15 +68,85 @@ bool is_skard_type_invalid(SkardType *skard_type)
 }
 
 
+// Number of value slots the type occupies
+size_t skard_type_size(SkardType *skard_type)
+{
+    if (skard_type->kind == TYPE_STRUCT) {
+        return skard_type->layout->size;
+    }
+
+    return 1;
+}
+
+
+void struct_layout_init(StructLayout *layout)
+{
+    layout->fields_count = 0;
+    layout->fields_capacity = 0;
+    layout->fields = NULL;
+    layout->size = 0;
+}
+
+void struct_layout_free(StructLayout *layout)
+{
+    SKARD_FREE_ARRAY(StructField, layout->fields);
+    struct_layout_init(layout);
+}
+
+// Places the field right after the previous one, returns false when the name is already taken
+bool struct_layout_add_field(StructLayout *layout, const char *name, size_t name_length, SkardType type)
+{
+    if (struct_layout_find_field(layout, name, name_length) != NULL) {
+        return false;
+    }
+
+    if (layout->fields_capacity < layout->fields_count + 1) {
+        layout->fields_capacity = SKARD_GROW_CAPACITY(layout->fields_capacity);
+        layout->fields = SKARD_GROW_ARRAY(StructField, layout->fields, layout->fields_capacity);
+    }
+    layout->fields[layout->fields_count] = (StructField) {
+        .name = name,
+        .name_length = name_length,
+        .type = type,
+        .offset = layout->size };
+    layout->fields_count++;
+    layout->size += skard_type_size(&type);
+    return true;
+}
+
+StructField *struct_layout_find_field(StructLayout *layout, const char *name, size_t name_length)
+{
+    for (size_t i = 0; i < layout->fields_count; i++) {
+        StructField *field = &layout->fields[i];
+        if (field->name_length == name_length && memcmp(field->name, name, name_length) == 0) {
+            return field;
+        }
+    }
+
+    return NULL;
+}
+
+
 void skard_type_print(SkardType *skard_type)
 {
-    assert((COUNT_TYPES == 4) && "Exhaustive types handling");
+    assert((COUNT_TYPES == 5) && "Exhaustive types handling");
     switch (skard_type->kind) {
         case TYPE_UNKNOWN:
         case TYPE_REAL:
         case TYPE_INT:
         case TYPE_INVALID:
             printf("%s", skard_type_translate(skard_type));
+            break;
+        case TYPE_STRUCT:
+            printf("%s { ", skard_type_translate(skard_type));
+            for (size_t i = 0; i < skard_type->layout->fields_count; i++) {
+                StructField *field = &skard_type->layout->fields[i];
+                printf("%.*s@%zu: ", (int) field->name_length, field->name, field->offset);
+                skard_type_print(&field->type);
+                printf(i + 1 < skard_type->layout->fields_count ? ", " : " ");
+            }
+            printf("}");
+            break;
         default:
             break;
     }
@@ -74,7 +155,7 @@ void skard_type_print(SkardType *skard_type)
 
 const char *skard_type_translate(SkardType *skard_type)
 {
-    assert((COUNT_TYPES == 4) && "Exhaustive types handling");
+    assert((COUNT_TYPES == 5) && "Exhaustive types handling");
     switch (skard_type->kind) {
         case TYPE_UNKNOWN:
             return "*Unknown";
@@ -84,6 +165,8 @@ const char *skard_type_translate(SkardType *skard_type)
             return "Real";
         case TYPE_INT:
             return "Int";
+        case TYPE_STRUCT:
+            return "Struct";
         default:
             break;
     }
@@ -94,24 +177,46 @@ const char *skard_type_translate(SkardType *skard_type)
 
 Value make_value_real(SkReal sk_real)
 {
+#ifdef SKARD_VALUE_TAGS
     return (Value) { .type = TYPE_REAL, .as.sk_real = sk_real };
+#else
+    return (Value) { .as.sk_real = sk_real };
+#endif
 }
 
 Value make_value_int(SkInt sk_int)
 {
+#ifdef SKARD_VALUE_TAGS
     return (Value) { .type = TYPE_INT, .as.sk_int = sk_int };
+#else
+    return (Value) { .as.sk_int = sk_int };
+#endif
+}
+
+Value convert_value_to_real(Value value)
+{
+    return make_value_real((SkReal) value.as.sk_int);
 }
 
 
 void print_value(Value value)
 {
-    assert((COUNT_TYPES == 4) && "Exhaustive types handling");
-    switch (value.type) {
+#ifdef SKARD_VALUE_TAGS
+    print_value_of_kind(value, value.type);
+#else
+    printf("0x%016" PRIx64, (uint64_t) value.as.sk_int);
+#endif
+}
+
+void print_value_of_kind(Value value, TypeKind kind)
+{
+    assert((COUNT_TYPES == 5) && "Exhaustive types handling");
+    switch (kind) {
         case TYPE_REAL:
             printf("%lf", value.as.sk_real);
             break;
         case TYPE_INT:
-            printf("%lld", value.as.sk_int);
+            printf("%" PRId64, value.as.sk_int);
             break;
         default:
             printf("UNKNOWN TYPE");
@@ -14,30 +14,64 @@ typedef enum {
     TYPE_INVALID,
     TYPE_REAL,
     TYPE_INT,
+    TYPE_STRUCT,
     COUNT_TYPES,
 } TypeKind;
 
+// Struct types point to the layout the typechecker computed for them, other types leave it NULL
 typedef struct {
     TypeKind kind;
+    struct StructLayout *layout;
 } SkardType;
 
+// Fields are stored inline and unboxed, offsets and sizes are counted in value slots
+typedef struct {
+    const char *name;
+    size_t name_length;
+    SkardType type;
+    size_t offset;
+} StructField;
+
+typedef struct StructLayout {
+    size_t fields_count;
+    size_t fields_capacity;
+    StructField *fields;
+    size_t size;
+} StructLayout;
+
+void struct_layout_init(StructLayout *layout);
+void struct_layout_free(StructLayout *layout);
+bool struct_layout_add_field(StructLayout *layout, const char *name, size_t name_length, SkardType type);
+StructField *struct_layout_find_field(StructLayout *layout, const char *name, size_t name_length);
+
 SkardType make_skard_type_simple(TypeKind type);
 SkardType make_skard_type_unknown(void);
 SkardType make_skard_type_invalid();
 SkardType make_skard_type_real(void);
 SkardType make_skard_type_int(void);
+SkardType make_skard_type_struct(StructLayout *layout);
 SkardType copy_skard_type(SkardType *source);
 
 bool is_skard_type_of_kind(SkardType *skard_type, TypeKind type);
 bool is_skard_type_unknown(SkardType *skard_type);
 bool is_skard_type_invalid(SkardType *skard_type);
 
+size_t skard_type_size(SkardType *skard_type);
+
 void skard_type_print(SkardType *skard_type);
 
 const char *skard_type_translate(SkardType *skard_type);
 
+// Every type is proven at compile time and the VM takes kinds from the instruction stream, so values only carry
+// their tag in debug builds (or with SKARD_VALUE_TAGS) and otherwise fit in a single 8-byte slot.
+#if defined(SKARD_DEBUG) && !defined(SKARD_VALUE_TAGS)
+#define SKARD_VALUE_TAGS
+#endif
+
 typedef struct {
+#ifdef SKARD_VALUE_TAGS
     TypeKind type;
+#endif
     union {
         SkReal sk_real;
         SkInt sk_int;
@@ -46,8 +80,10 @@ typedef struct {
 
 Value make_value_real(SkReal sk_real);
 Value make_value_int(SkInt sk_int);
+Value convert_value_to_real(Value value);
 
 void print_value(Value value);
+void print_value_of_kind(Value value, TypeKind kind);
 
 typedef struct {
     size_t count;
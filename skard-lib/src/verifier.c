@@ -0,0 +1,316 @@
+#include "verifier.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "native.h"
+
+typedef struct {
+    size_t pops;
+    size_t pushes;
+} StackEffect;
+
+static void report_verify_error(size_t offset, const char *message)
+{
+    fprintf(stderr, "Bytecode verification failed at offset %zu: %s\n", offset, message);
+}
+
+// Natives are resolved against the VM's registry when the chunk runs, which checks the arity recorded here
+static bool verify_native_call(Chunk *chunk, size_t offset, uint8_t index, uint8_t arity)
+{
+    if (arity > SKARD_NATIVE_MAX_ARITY) {
+        report_verify_error(offset, "Too many native call arguments.");
+        return false;
+    }
+
+    while (chunk->natives_count < (size_t) index + 1) {
+        chunk->native_arities[chunk->natives_count++] = SKARD_NATIVE_UNUSED;
+    }
+    if (chunk->native_arities[index] != SKARD_NATIVE_UNUSED && chunk->native_arities[index] != arity) {
+        report_verify_error(offset, "Inconsistent native call arity.");
+        return false;
+    }
+    chunk->native_arities[index] = arity;
+    return true;
+}
+
+// Operands of the instruction are only read for instructions with a variable effect, their size is checked already
+static bool get_stack_effect(uint8_t *instruction, StackEffect *effect)
+{
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+    switch (instruction[0]) {
+        case OP_RETURN:
+        case OP_CONSTANT_DUMP_INT:
+        case OP_CONSTANT_DUMP_REAL:
+            *effect = (StackEffect) { .pops = 0, .pushes = 0 };
+            return true;
+        case OP_DUMP_INT:
+        case OP_DUMP_REAL:
+            *effect = (StackEffect) { .pops = 1, .pushes = 0 };
+            return true;
+        case OP_CONSTANT:
+        case OP_CONSTANT_LONG:
+            *effect = (StackEffect) { .pops = 0, .pushes = 1 };
+            return true;
+        case OP_NEGATE_INT:
+        case OP_NEGATE_REAL:
+        case OP_YIELD_INT:
+        case OP_YIELD_REAL:
+        case OP_ADD_CONSTANT_INT:
+        case OP_ADD_CONSTANT_REAL:
+        case OP_SUBTRACT_CONSTANT_INT:
+        case OP_SUBTRACT_CONSTANT_REAL:
+        case OP_MULTIPLY_CONSTANT_INT:
+        case OP_MULTIPLY_CONSTANT_REAL:
+        case OP_DIVIDE_CONSTANT_REAL:
+        case OP_DIV_CONSTANT_INT:
+            *effect = (StackEffect) { .pops = 1, .pushes = 1 };
+            return true;
+        case OP_ADD_INT:
+        case OP_ADD_REAL:
+        case OP_ADD_INT_REAL:
+        case OP_ADD_REAL_INT:
+        case OP_SUBTRACT_INT:
+        case OP_SUBTRACT_REAL:
+        case OP_SUBTRACT_INT_REAL:
+        case OP_SUBTRACT_REAL_INT:
+        case OP_MULTIPLY_INT:
+        case OP_MULTIPLY_REAL:
+        case OP_MULTIPLY_INT_REAL:
+        case OP_MULTIPLY_REAL_INT:
+        case OP_DIVIDE_REAL:
+        case OP_DIVIDE_INT_REAL:
+        case OP_DIVIDE_REAL_INT:
+        case OP_DIVIDE_INT_INT:
+        case OP_DIV_INT:
+            *effect = (StackEffect) { .pops = 2, .pushes = 1 };
+            return true;
+        case OP_GET_FIELD:
+            *effect = (StackEffect) { .pops = instruction[1], .pushes = instruction[3] };
+            return true;
+        case OP_CALL_NATIVE:
+            *effect = (StackEffect) { .pops = instruction[2], .pushes = 1 };
+            return true;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+// The field has to lie within the struct
+static bool is_field_operand_valid(uint8_t *instruction)
+{
+    size_t size = instruction[1];
+    size_t offset = instruction[2];
+    size_t field_size = instruction[3];
+    return field_size != 0 && offset + field_size <= size;
+}
+
+static size_t read_constant_index(Chunk *chunk, size_t offset)
+{
+    if (chunk->code[offset] == OP_CONSTANT_LONG) {
+        return chunk->code[offset + 1] | (chunk->code[offset + 2] << 8) | (chunk->code[offset + 3] << 16);
+    }
+
+    return chunk->code[offset + 1];
+}
+
+static bool verify_stack_chunk(Chunk *chunk)
+{
+    size_t depth = 0;
+    size_t max_depth = 0;
+    chunk->natives_count = 0;
+
+    size_t offset = 0;
+    while (offset < chunk->count) {
+        uint8_t op = chunk->code[offset];
+        size_t size = stack_instruction_size(op);
+        if (offset + size > chunk->count) {
+            report_verify_error(offset, "Truncated instruction operands.");
+            return false;
+        }
+
+        StackEffect effect;
+        if (!get_stack_effect(&chunk->code[offset], &effect)) {
+            report_verify_error(offset, "Unknown opcode.");
+            return false;
+        }
+
+        if (stack_instruction_has_constant(op) && read_constant_index(chunk, offset) >= chunk->constants.count) {
+            report_verify_error(offset, "Constant index out of range.");
+            return false;
+        }
+
+        if (op == OP_GET_FIELD && !is_field_operand_valid(&chunk->code[offset])) {
+            report_verify_error(offset, "Field out of struct bounds.");
+            return false;
+        }
+
+        if (op == OP_CALL_NATIVE && !verify_native_call(chunk, offset, chunk->code[offset + 1], chunk->code[offset + 2])) {
+            return false;
+        }
+
+        if (depth < effect.pops) {
+            report_verify_error(offset, "Stack underflow.");
+            return false;
+        }
+        depth = depth - effect.pops + effect.pushes;
+        if (depth > max_depth) {
+            max_depth = depth;
+        }
+
+        if (op == OP_RETURN) {
+            chunk->max_stack_depth = max_depth;
+            return true;
+        }
+        offset += size;
+    }
+
+    report_verify_error(offset, "Missing return at end of chunk.");
+    return false;
+}
+
+
+static bool verify_register_operand(Chunk *chunk, size_t offset, uint8_t operand)
+{
+    if (operand >= chunk->registers_count) {
+        report_verify_error(offset, "Register operand out of range.");
+        return false;
+    }
+
+    return true;
+}
+
+static bool verify_rk_operand(Chunk *chunk, size_t offset, uint8_t operand)
+{
+    if (!(operand & SKARD_RK_CONSTANT_FLAG)) {
+        return verify_register_operand(chunk, offset, operand);
+    }
+
+    if ((size_t) (operand & ~SKARD_RK_CONSTANT_FLAG) >= chunk->constants.count) {
+        report_verify_error(offset, "Constant index out of range.");
+        return false;
+    }
+
+    return true;
+}
+
+static bool verify_register_chunk(Chunk *chunk)
+{
+    if (chunk->registers_count > SKARD_MAX_REGISTERS) {
+        report_verify_error(0, "Too many registers.");
+        return false;
+    }
+    chunk->natives_count = 0;
+
+    size_t offset = 0;
+    while (offset + SKARD_REGISTER_INSTRUCTION_SIZE <= chunk->count) {
+        uint8_t *instruction = &chunk->code[offset];
+        uint8_t op = instruction[0];
+        bool is_valid;
+
+        assert((COUNT_ROPS == 20) && "Exhaustive register ops handling");
+        switch (op) {
+            case ROP_RETURN:
+                chunk->max_stack_depth = chunk->registers_count;
+                return true;
+            case ROP_DUMP_INT:
+            case ROP_DUMP_REAL:
+            case ROP_YIELD_INT:
+            case ROP_YIELD_REAL:
+                is_valid = verify_register_operand(chunk, offset, instruction[1]);
+                break;
+            case ROP_CONSTANT: {
+                size_t index = instruction[2] | (instruction[3] << 8);
+                is_valid = verify_register_operand(chunk, offset, instruction[1]);
+                if (is_valid && index >= chunk->constants.count) {
+                    report_verify_error(offset, "Constant index out of range.");
+                    is_valid = false;
+                }
+                break;
+            }
+            case ROP_CONSTANT_LONG: {
+                if (!verify_register_operand(chunk, offset, instruction[1])) {
+                    return false;
+                }
+                offset += SKARD_REGISTER_INSTRUCTION_SIZE;
+                if (offset + SKARD_REGISTER_INSTRUCTION_SIZE > chunk->count) {
+                    report_verify_error(offset, "Truncated instruction operands.");
+                    return false;
+                }
+                size_t index = chunk->code[offset] | (chunk->code[offset + 1] << 8) | (chunk->code[offset + 2] << 16);
+                is_valid = index < chunk->constants.count;
+                if (!is_valid) {
+                    report_verify_error(offset, "Constant index out of range.");
+                }
+                break;
+            }
+            case ROP_NEGATE_INT:
+            case ROP_NEGATE_REAL:
+            case ROP_TO_REAL:
+                is_valid = verify_register_operand(chunk, offset, instruction[1]) &&
+                           verify_rk_operand(chunk, offset, instruction[2]);
+                break;
+            case ROP_MOVE:
+                is_valid = verify_register_operand(chunk, offset, instruction[1]) &&
+                           verify_register_operand(chunk, offset, instruction[2]);
+                break;
+            case ROP_CALL_NATIVE:
+                // The result is written to R[A] even without arguments
+                is_valid = verify_native_call(chunk, offset, instruction[3], instruction[2]) &&
+                           verify_register_operand(chunk, offset, instruction[1]) &&
+                           (instruction[2] == 0 ||
+                            verify_register_operand(chunk, offset, instruction[1] + instruction[2] - 1));
+                break;
+            case ROP_ADD_INT:
+            case ROP_ADD_REAL:
+            case ROP_SUBTRACT_INT:
+            case ROP_SUBTRACT_REAL:
+            case ROP_MULTIPLY_INT:
+            case ROP_MULTIPLY_REAL:
+            case ROP_DIVIDE_REAL:
+            case ROP_DIV_INT:
+                is_valid = verify_register_operand(chunk, offset, instruction[1]) &&
+                           verify_rk_operand(chunk, offset, instruction[2]) &&
+                           verify_rk_operand(chunk, offset, instruction[3]);
+                break;
+            default:
+                report_verify_error(offset, "Unknown opcode.");
+                is_valid = false;
+                break;
+        }
+
+        if (!is_valid) {
+            return false;
+        }
+        offset += SKARD_REGISTER_INSTRUCTION_SIZE;
+    }
+
+    report_verify_error(offset, "Missing return at end of chunk.");
+    return false;
+}
+
+
+// Checks every instruction once and records the stack the chunk needs, verified chunks run without per-push checks
+bool chunk_verify(Chunk *chunk)
+{
+    chunk->is_verified = false;
+
+    bool result = false;
+    assert((COUNT_CHUNK_FORMATS == 2) && "Exhaustive chunk formats handling");
+    switch (chunk->format) {
+        case CHUNK_FORMAT_STACK:
+            result = verify_stack_chunk(chunk);
+            break;
+        case CHUNK_FORMAT_REGISTER:
+            result = verify_register_chunk(chunk);
+            break;
+        default:
+            report_verify_error(0, "Unknown chunk format.");
+            break;
+    }
+
+    chunk->is_verified = result;
+    return result;
+}
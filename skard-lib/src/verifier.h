@@ -0,0 +1,10 @@
+#ifndef SKARD_VERIFIER_H
+#define SKARD_VERIFIER_H
+
+#include <stdbool.h>
+
+#include "chunk.h"
+
+bool chunk_verify(Chunk *chunk);
+
+#endif //SKARD_VERIFIER_H
@@ -2,9 +2,12 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <assert.h>
 
 #include "utils.h"
-#include "debug.h"
+#include "verifier.h"
+#include "jit.h"
+#include "arithmetic.h"
 
 void vm_stack_init(VMStack *stack)
 {
@@ -19,6 +22,18 @@ void vm_stack_free(VMStack *stack)
     vm_stack_init(stack);
 }
 
+void vm_stack_reserve(VMStack *stack, size_t capacity)
+{
+    if (stack->capacity >= capacity) {
+        return;
+    }
+
+    size_t offset = stack->stack == stack->stack_top ? 0 : stack->stack_top - stack->stack;
+    stack->capacity = capacity < SKARD_VM_STACK_MIN_SIZE ? SKARD_VM_STACK_MIN_SIZE : capacity;
+    stack->stack = SKARD_GROW_ARRAY(Value, stack->stack, stack->capacity);
+    stack->stack_top = stack->stack + offset;
+}
+
 void vm_stack_push(VMStack *stack, Value value)
 {
     size_t offset = stack->stack == stack->stack_top ? 0 : stack->stack_top - stack->stack;
@@ -41,7 +56,20 @@ Value vm_stack_pop(VMStack *stack)
 
 void vm_init(SkardVM *vm)
 {
+    vm->chunk = NULL;
+    vm->ip = NULL;
+    vm->trace = NULL;
+    vm->fuel = SKARD_FUEL_UNLIMITED;
+    vm->natives = NULL;
+    vm->yielded = NULL;
+    vm->yielded_kind = TYPE_UNKNOWN;
+    vm->is_sampled = false;
+    vm->sampled_offset = SKARD_SAMPLED_IDLE;
     vm_stack_init(&vm->stack);
+    vm->jit_threshold = SKARD_JIT_DEFAULT_THRESHOLD;
+#ifdef SKARD_PROFILE
+    vm_profile_reset(&vm->profile);
+#endif
 }
 
 void vm_free(SkardVM *vm)
@@ -49,66 +77,643 @@ void vm_free(SkardVM *vm)
     vm_stack_free(&vm->stack);
 }
 
-static void vm_debug_print_stack(SkardVM *vm)
-{
-    printf("{ ");
-    size_t offset = vm->stack.stack == vm->stack.stack_top ? 0 : vm->stack.stack_top - vm->stack.stack;
-    for (size_t i = 0; i < offset; i++) {
-        printf("[ ");
-        print_value(vm->stack.stack[i]);
-        printf(" ]");
-    }
-    printf(" }");
-}
 
-static void vm_debug_trace(SkardVM *vm)
+void vm_runtime_error(SkardVM *vm, size_t offset, const char *message)
 {
-    vm_debug_print_stack(vm);
-    printf("\n");
-    disassemble_instruction(vm->chunk, vm->ip - vm->chunk->code);
-    printf("\n");
+    size_t line = debug_info_read_line(&vm->chunk->debug_info, offset);
+    size_t column = debug_info_read_column(&vm->chunk->debug_info, offset);
+    fprintf(stderr, "[line %zu][column %zu] Runtime error: %s\n", line, column, message);
 }
 
+
+// Tracing is armed at runtime by pointing vm->trace to a buffer
+#ifdef SKARD_TRACING
+#define SKARD_TRACE() \
+    do { \
+        if (vm->trace != NULL) { \
+            SKARD_TRACE_RECORD(); \
+        } \
+    } while (false)
+#else
+#define SKARD_TRACE() ((void) 0)
+#endif
+
+// Yields before the next instruction once the budget is spent, ip still points at it so vm_resume continues there
+#define SKARD_FUEL() \
+    do { \
+        if (fuel == 0) { \
+            vm->fuel = 0; \
+            return INTERPRETER_YIELD; \
+        } \
+        fuel--; \
+    } while (false)
+
+// Leaves ip after the yield instruction and keeps the unspent budget for vm_resume
+#define SKARD_SUSPEND(slot, kind) \
+    do { \
+        vm->fuel = fuel; \
+        vm->yielded = (slot); \
+        vm->yielded_kind = (kind); \
+        return INTERPRETER_SUSPENDED; \
+    } while (false)
+
+// ip points at the instruction about to run
+#define SKARD_SAMPLE() \
+    do { \
+        if (vm->is_sampled) { \
+            vm->sampled_offset = (sig_atomic_t) (vm->ip - vm->chunk->code); \
+        } \
+    } while (false)
+
+#ifdef SKARD_PROFILE
+#define SKARD_IS_PROFILED true
+#else
+#define SKARD_IS_PROFILED false
+#endif
+
+// Chunks have no jumps, so the bytes left bound the instructions left. When the budget covers them the loop runs
+// without counting, like generated code does, and an armed trace, a running sampler or a profiling build are the
+// only other reasons to look at every instruction.
+#define SKARD_IS_INSPECTED() (vm->trace != NULL || vm->is_sampled || SKARD_IS_PROFILED)
+#define SKARD_IS_METERED(remaining) (fuel < (remaining) || is_inspected)
+
+// Every loop keeps the budget in a local fuel, sets is_inspected and is_metered once on entry and defines
+// SKARD_READ_OPCODE(), SKARD_OPCODE_SIZE, SKARD_TRACE_RECORD(), SKARD_PROFILE_STEP(), a dispatch_table and a
+// metered_table before using these
+#ifdef SKARD_COMPUTED_GOTO
+// Metered runs dispatch through metered_table, its entries point at a prologue in front of every handler. The opcode
+// is already read there, ip only goes back to the instruction when it yields, traces, samples or profiles. Unmetered
+// runs go straight to the handlers.
+#define SKARD_DISPATCH() \
+    void **dispatch = is_metered ? metered_table : dispatch_table; \
+    goto *dispatch[SKARD_READ_OPCODE()];
+#define SKARD_NEXT() goto *dispatch[SKARD_READ_OPCODE()]
+#define SKARD_CASE(op) \
+    label_metered_##op: \
+    if (fuel == 0 || is_inspected) { \
+        vm->ip -= SKARD_OPCODE_SIZE; \
+        SKARD_FUEL(); \
+        SKARD_TRACE(); \
+        SKARD_SAMPLE(); \
+        SKARD_PROFILE_STEP(); \
+        vm->ip += SKARD_OPCODE_SIZE; \
+    } else { \
+        fuel--; \
+    } \
+    label_##op
+#define SKARD_CASE_UNKNOWN label_unknown
+#else
+#define SKARD_DISPATCH() \
+    if (is_metered) { \
+        SKARD_FUEL(); \
+        SKARD_TRACE(); \
+        SKARD_SAMPLE(); \
+        SKARD_PROFILE_STEP(); \
+    } \
+    switch (SKARD_READ_OPCODE())
+#define SKARD_NEXT() continue
+#define SKARD_CASE(op) case op
+#define SKARD_CASE_UNKNOWN default
+#endif
+
+#ifdef SKARD_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+
 static InterpreterResult vm_loop(SkardVM *vm)
 {
 #define SKARD_READ_BYTE() (*vm->ip++)
+#define SKARD_READ_OPCODE() SKARD_READ_BYTE()
+#define SKARD_OPCODE_SIZE 1
+#define SKARD_TRACE_RECORD() \
+    do { \
+        size_t depth = vm->stack.stack_top - vm->stack.stack; \
+        trace_buffer_append(vm->trace, vm->ip - vm->chunk->code, *vm->ip, depth, \
+                            depth == 0 ? make_value_int(0) : vm->stack.stack_top[-1]); \
+    } while (false)
+#ifdef SKARD_PROFILE
+#define SKARD_PROFILE_STEP() vm_profile_step(&vm->profile, *vm->ip)
+#else
+#define SKARD_PROFILE_STEP() ((void) 0)
+#endif
 #define SKARD_READ_CONSTANT() (vm->chunk->constants.values[SKARD_READ_BYTE()])
 #define SKARD_READ_CONSTANT_LONG() \
     (vm->chunk->constants.values[(vm->ip += 3, (vm->ip[-3]) | (vm->ip[-2]) << 8 | (vm->ip[-1]) << 16)])
+// The chunk is verified and the stack preallocated to its maximum depth, so these never check capacity
+#define SKARD_PUSH(value) (*vm->stack.stack_top++ = (value))
+#define SKARD_POP() (*--vm->stack.stack_top)
+#define SKARD_PEEK() (vm->stack.stack_top[-1])
+#define SKARD_BINARY_OP(operation) \
+    do { \
+        Value second = SKARD_POP(); \
+        SKARD_PEEK() = operation(SKARD_PEEK(), second); \
+    } while (false)
+#define SKARD_BINARY_OP_PROMOTE(operation, promote_first, promote_second) \
+    do { \
+        Value second = promote_second(SKARD_POP()); \
+        SKARD_PEEK() = operation(promote_first(SKARD_PEEK()), second); \
+    } while (false)
+#define SKARD_BINARY_OP_CONSTANT(operation) (SKARD_PEEK() = operation(SKARD_PEEK(), SKARD_READ_CONSTANT()))
+#define SKARD_DIV_BY_ZERO_ERROR() \
+    do { \
+        vm_runtime_error(vm, vm->ip - vm->chunk->code - 1, "Integer division by zero."); \
+        return INTERPRETER_NOK_RUNTIME; \
+    } while (false)
+#define SKARD_DUMP(value, kind) \
+    do { \
+        print_value_of_kind((value), (kind)); \
+        printf("\n"); \
+    } while (false)
 
-    while (true) {
+    assert((COUNT_OPS == 38) && "Exhaustive ops handling");
+
+    size_t fuel = vm->fuel;
+    bool is_inspected = SKARD_IS_INSPECTED();
+    bool is_metered = SKARD_IS_METERED((size_t) (vm->chunk->code + vm->chunk->count - vm->ip));
 
-#ifdef SKARD_DEBUG_TRACE
-        vm_debug_trace(vm);
+#ifdef SKARD_COMPUTED_GOTO
+    static void *dispatch_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&label_unknown,
+        [OP_RETURN] = &&label_OP_RETURN,
+        [OP_DUMP_INT] = &&label_OP_DUMP_INT,
+        [OP_DUMP_REAL] = &&label_OP_DUMP_REAL,
+        [OP_CONSTANT] = &&label_OP_CONSTANT,
+        [OP_CONSTANT_LONG] = &&label_OP_CONSTANT_LONG,
+        [OP_NEGATE_INT] = &&label_OP_NEGATE_INT,
+        [OP_NEGATE_REAL] = &&label_OP_NEGATE_REAL,
+        [OP_ADD_INT] = &&label_OP_ADD_INT,
+        [OP_ADD_REAL] = &&label_OP_ADD_REAL,
+        [OP_ADD_INT_REAL] = &&label_OP_ADD_INT_REAL,
+        [OP_ADD_REAL_INT] = &&label_OP_ADD_REAL_INT,
+        [OP_SUBTRACT_INT] = &&label_OP_SUBTRACT_INT,
+        [OP_SUBTRACT_REAL] = &&label_OP_SUBTRACT_REAL,
+        [OP_SUBTRACT_INT_REAL] = &&label_OP_SUBTRACT_INT_REAL,
+        [OP_SUBTRACT_REAL_INT] = &&label_OP_SUBTRACT_REAL_INT,
+        [OP_MULTIPLY_INT] = &&label_OP_MULTIPLY_INT,
+        [OP_MULTIPLY_REAL] = &&label_OP_MULTIPLY_REAL,
+        [OP_MULTIPLY_INT_REAL] = &&label_OP_MULTIPLY_INT_REAL,
+        [OP_MULTIPLY_REAL_INT] = &&label_OP_MULTIPLY_REAL_INT,
+        [OP_DIVIDE_REAL] = &&label_OP_DIVIDE_REAL,
+        [OP_DIVIDE_INT_REAL] = &&label_OP_DIVIDE_INT_REAL,
+        [OP_DIVIDE_REAL_INT] = &&label_OP_DIVIDE_REAL_INT,
+        [OP_DIVIDE_INT_INT] = &&label_OP_DIVIDE_INT_INT,
+        [OP_DIV_INT] = &&label_OP_DIV_INT,
+        [OP_GET_FIELD] = &&label_OP_GET_FIELD,
+        [OP_YIELD_INT] = &&label_OP_YIELD_INT,
+        [OP_YIELD_REAL] = &&label_OP_YIELD_REAL,
+        [OP_CALL_NATIVE] = &&label_OP_CALL_NATIVE,
+        [OP_CONSTANT_DUMP_INT] = &&label_OP_CONSTANT_DUMP_INT,
+        [OP_CONSTANT_DUMP_REAL] = &&label_OP_CONSTANT_DUMP_REAL,
+        [OP_ADD_CONSTANT_INT] = &&label_OP_ADD_CONSTANT_INT,
+        [OP_ADD_CONSTANT_REAL] = &&label_OP_ADD_CONSTANT_REAL,
+        [OP_SUBTRACT_CONSTANT_INT] = &&label_OP_SUBTRACT_CONSTANT_INT,
+        [OP_SUBTRACT_CONSTANT_REAL] = &&label_OP_SUBTRACT_CONSTANT_REAL,
+        [OP_MULTIPLY_CONSTANT_INT] = &&label_OP_MULTIPLY_CONSTANT_INT,
+        [OP_MULTIPLY_CONSTANT_REAL] = &&label_OP_MULTIPLY_CONSTANT_REAL,
+        [OP_DIVIDE_CONSTANT_REAL] = &&label_OP_DIVIDE_CONSTANT_REAL,
+        [OP_DIV_CONSTANT_INT] = &&label_OP_DIV_CONSTANT_INT,
+    };
+
+    static void *metered_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&label_unknown,
+        [OP_RETURN] = &&label_metered_OP_RETURN,
+        [OP_DUMP_INT] = &&label_metered_OP_DUMP_INT,
+        [OP_DUMP_REAL] = &&label_metered_OP_DUMP_REAL,
+        [OP_CONSTANT] = &&label_metered_OP_CONSTANT,
+        [OP_CONSTANT_LONG] = &&label_metered_OP_CONSTANT_LONG,
+        [OP_NEGATE_INT] = &&label_metered_OP_NEGATE_INT,
+        [OP_NEGATE_REAL] = &&label_metered_OP_NEGATE_REAL,
+        [OP_ADD_INT] = &&label_metered_OP_ADD_INT,
+        [OP_ADD_REAL] = &&label_metered_OP_ADD_REAL,
+        [OP_ADD_INT_REAL] = &&label_metered_OP_ADD_INT_REAL,
+        [OP_ADD_REAL_INT] = &&label_metered_OP_ADD_REAL_INT,
+        [OP_SUBTRACT_INT] = &&label_metered_OP_SUBTRACT_INT,
+        [OP_SUBTRACT_REAL] = &&label_metered_OP_SUBTRACT_REAL,
+        [OP_SUBTRACT_INT_REAL] = &&label_metered_OP_SUBTRACT_INT_REAL,
+        [OP_SUBTRACT_REAL_INT] = &&label_metered_OP_SUBTRACT_REAL_INT,
+        [OP_MULTIPLY_INT] = &&label_metered_OP_MULTIPLY_INT,
+        [OP_MULTIPLY_REAL] = &&label_metered_OP_MULTIPLY_REAL,
+        [OP_MULTIPLY_INT_REAL] = &&label_metered_OP_MULTIPLY_INT_REAL,
+        [OP_MULTIPLY_REAL_INT] = &&label_metered_OP_MULTIPLY_REAL_INT,
+        [OP_DIVIDE_REAL] = &&label_metered_OP_DIVIDE_REAL,
+        [OP_DIVIDE_INT_REAL] = &&label_metered_OP_DIVIDE_INT_REAL,
+        [OP_DIVIDE_REAL_INT] = &&label_metered_OP_DIVIDE_REAL_INT,
+        [OP_DIVIDE_INT_INT] = &&label_metered_OP_DIVIDE_INT_INT,
+        [OP_DIV_INT] = &&label_metered_OP_DIV_INT,
+        [OP_GET_FIELD] = &&label_metered_OP_GET_FIELD,
+        [OP_YIELD_INT] = &&label_metered_OP_YIELD_INT,
+        [OP_YIELD_REAL] = &&label_metered_OP_YIELD_REAL,
+        [OP_CALL_NATIVE] = &&label_metered_OP_CALL_NATIVE,
+        [OP_CONSTANT_DUMP_INT] = &&label_metered_OP_CONSTANT_DUMP_INT,
+        [OP_CONSTANT_DUMP_REAL] = &&label_metered_OP_CONSTANT_DUMP_REAL,
+        [OP_ADD_CONSTANT_INT] = &&label_metered_OP_ADD_CONSTANT_INT,
+        [OP_ADD_CONSTANT_REAL] = &&label_metered_OP_ADD_CONSTANT_REAL,
+        [OP_SUBTRACT_CONSTANT_INT] = &&label_metered_OP_SUBTRACT_CONSTANT_INT,
+        [OP_SUBTRACT_CONSTANT_REAL] = &&label_metered_OP_SUBTRACT_CONSTANT_REAL,
+        [OP_MULTIPLY_CONSTANT_INT] = &&label_metered_OP_MULTIPLY_CONSTANT_INT,
+        [OP_MULTIPLY_CONSTANT_REAL] = &&label_metered_OP_MULTIPLY_CONSTANT_REAL,
+        [OP_DIVIDE_CONSTANT_REAL] = &&label_metered_OP_DIVIDE_CONSTANT_REAL,
+        [OP_DIV_CONSTANT_INT] = &&label_metered_OP_DIV_CONSTANT_INT,
+    };
 #endif
 
-        switch (SKARD_READ_BYTE()) {
-            case OP_RETURN:
+    while (true) {
+        SKARD_DISPATCH() {
+            SKARD_CASE(OP_RETURN):
                 return INTERPRETER_OK;
-            case OP_DUMP:
-                print_value(vm_stack_pop(&vm->stack));
-                printf("\n");
-                break;
-            case OP_CONSTANT:
-                vm_stack_push(&vm->stack, SKARD_READ_CONSTANT());
-                break;
-            case OP_CONSTANT_LONG:
-                vm_stack_push(&vm->stack, SKARD_READ_CONSTANT_LONG());
-                break;
-            default:
+            SKARD_CASE(OP_DUMP_INT):
+                SKARD_DUMP(SKARD_POP(), TYPE_INT);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DUMP_REAL):
+                SKARD_DUMP(SKARD_POP(), TYPE_REAL);
+                SKARD_NEXT();
+            SKARD_CASE(OP_CONSTANT):
+                SKARD_PUSH(SKARD_READ_CONSTANT());
+                SKARD_NEXT();
+            SKARD_CASE(OP_CONSTANT_LONG):
+                SKARD_PUSH(SKARD_READ_CONSTANT_LONG());
+                SKARD_NEXT();
+            SKARD_CASE(OP_NEGATE_INT):
+                SKARD_PEEK() = vm_negate_int(SKARD_PEEK());
+                SKARD_NEXT();
+            SKARD_CASE(OP_NEGATE_REAL):
+                SKARD_PEEK() = vm_negate_real(SKARD_PEEK());
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_INT):
+                SKARD_BINARY_OP(vm_add_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_REAL):
+                SKARD_BINARY_OP(vm_add_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_INT_REAL):
+                SKARD_BINARY_OP_PROMOTE(vm_add_real, vm_to_real, );
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_REAL_INT):
+                SKARD_BINARY_OP_PROMOTE(vm_add_real, , vm_to_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_INT):
+                SKARD_BINARY_OP(vm_subtract_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_REAL):
+                SKARD_BINARY_OP(vm_subtract_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_INT_REAL):
+                SKARD_BINARY_OP_PROMOTE(vm_subtract_real, vm_to_real, );
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_REAL_INT):
+                SKARD_BINARY_OP_PROMOTE(vm_subtract_real, , vm_to_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_INT):
+                SKARD_BINARY_OP(vm_multiply_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_REAL):
+                SKARD_BINARY_OP(vm_multiply_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_INT_REAL):
+                SKARD_BINARY_OP_PROMOTE(vm_multiply_real, vm_to_real, );
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_REAL_INT):
+                SKARD_BINARY_OP_PROMOTE(vm_multiply_real, , vm_to_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIVIDE_REAL):
+                SKARD_BINARY_OP(vm_divide_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIVIDE_INT_REAL):
+                SKARD_BINARY_OP_PROMOTE(vm_divide_real, vm_to_real, );
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIVIDE_REAL_INT):
+                SKARD_BINARY_OP_PROMOTE(vm_divide_real, , vm_to_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIVIDE_INT_INT):
+                SKARD_BINARY_OP_PROMOTE(vm_divide_real, vm_to_real, vm_to_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIV_INT):
+                if (SKARD_PEEK().as.sk_int == 0) {
+                    SKARD_DIV_BY_ZERO_ERROR();
+                }
+                SKARD_BINARY_OP(vm_div_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_GET_FIELD): {
+                Value *base = vm->stack.stack_top - vm->ip[0];
+                uint8_t field_offset = vm->ip[1];
+                uint8_t field_size = vm->ip[2];
+                vm->ip += 3;
+                for (size_t i = 0; i < field_size; i++) {
+                    base[i] = base[field_offset + i];
+                }
+                vm->stack.stack_top = base + field_size;
+                SKARD_NEXT();
+            }
+            SKARD_CASE(OP_YIELD_INT):
+                SKARD_SUSPEND(&SKARD_PEEK(), TYPE_INT);
+            SKARD_CASE(OP_YIELD_REAL):
+                SKARD_SUSPEND(&SKARD_PEEK(), TYPE_REAL);
+            SKARD_CASE(OP_CALL_NATIVE): {
+                const NativeFunction *native = &vm->natives->functions[vm->ip[0]];
+                Value *arguments = vm->stack.stack_top - vm->ip[1];
+                vm->ip += 2;
+                *arguments = native->trampoline(native->function, arguments);
+                vm->stack.stack_top = arguments + 1;
+                SKARD_NEXT();
+            }
+            SKARD_CASE(OP_CONSTANT_DUMP_INT):
+                SKARD_DUMP(SKARD_READ_CONSTANT(), TYPE_INT);
+                SKARD_NEXT();
+            SKARD_CASE(OP_CONSTANT_DUMP_REAL):
+                SKARD_DUMP(SKARD_READ_CONSTANT(), TYPE_REAL);
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_CONSTANT_INT):
+                SKARD_BINARY_OP_CONSTANT(vm_add_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_ADD_CONSTANT_REAL):
+                SKARD_BINARY_OP_CONSTANT(vm_add_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_CONSTANT_INT):
+                SKARD_BINARY_OP_CONSTANT(vm_subtract_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_SUBTRACT_CONSTANT_REAL):
+                SKARD_BINARY_OP_CONSTANT(vm_subtract_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_CONSTANT_INT):
+                SKARD_BINARY_OP_CONSTANT(vm_multiply_int);
+                SKARD_NEXT();
+            SKARD_CASE(OP_MULTIPLY_CONSTANT_REAL):
+                SKARD_BINARY_OP_CONSTANT(vm_multiply_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIVIDE_CONSTANT_REAL):
+                SKARD_BINARY_OP_CONSTANT(vm_divide_real);
+                SKARD_NEXT();
+            SKARD_CASE(OP_DIV_CONSTANT_INT):
+                if (vm->chunk->constants.values[*vm->ip].as.sk_int == 0) {
+                    SKARD_DIV_BY_ZERO_ERROR();
+                }
+                SKARD_BINARY_OP_CONSTANT(vm_div_int);
+                SKARD_NEXT();
+            SKARD_CASE_UNKNOWN:
                 return INTERPRETER_NOK_RUNTIME;
         }
     }
 
 #undef SKARD_READ_BYTE
+#undef SKARD_READ_OPCODE
+#undef SKARD_OPCODE_SIZE
+#undef SKARD_TRACE_RECORD
+#undef SKARD_PROFILE_STEP
 #undef SKARD_READ_CONSTANT
 #undef SKARD_READ_CONSTANT_LONG
+#undef SKARD_PUSH
+#undef SKARD_POP
+#undef SKARD_PEEK
+#undef SKARD_BINARY_OP
+#undef SKARD_BINARY_OP_PROMOTE
+#undef SKARD_BINARY_OP_CONSTANT
+#undef SKARD_DIV_BY_ZERO_ERROR
+#undef SKARD_DUMP
+}
+
+static InterpreterResult vm_loop_register(SkardVM *vm)
+{
+    Value *registers = vm->stack.stack;
+    Value *constants = vm->chunk->constants.values;
+
+#define SKARD_READ_OPCODE() (vm->ip += SKARD_REGISTER_INSTRUCTION_SIZE, vm->ip[-SKARD_REGISTER_INSTRUCTION_SIZE])
+#define SKARD_OPCODE_SIZE SKARD_REGISTER_INSTRUCTION_SIZE
+#define SKARD_TRACE_RECORD() \
+    trace_buffer_append(vm->trace, vm->ip - vm->chunk->code, vm->ip[0], 0, registers[vm->ip[1]])
+// The profile is indexed by stack opcodes, register chunks are not profiled
+#define SKARD_PROFILE_STEP() ((void) 0)
+#define SKARD_A() (vm->ip[-3])
+#define SKARD_B() (vm->ip[-2])
+#define SKARD_C() (vm->ip[-1])
+#define SKARD_RK(operand) \
+    ((operand) & SKARD_RK_CONSTANT_FLAG ? constants[(operand) & ~SKARD_RK_CONSTANT_FLAG] : registers[operand])
+#define SKARD_BINARY_OP(operation) \
+    (registers[SKARD_A()] = operation(SKARD_RK(SKARD_B()), SKARD_RK(SKARD_C())))
+
+    assert((COUNT_ROPS == 20) && "Exhaustive register ops handling");
+
+    size_t fuel = vm->fuel;
+    bool is_inspected = SKARD_IS_INSPECTED();
+    bool is_metered = SKARD_IS_METERED((size_t) (vm->chunk->code + vm->chunk->count - vm->ip));
+
+#ifdef SKARD_COMPUTED_GOTO
+    static void *dispatch_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&label_unknown,
+        [ROP_RETURN] = &&label_ROP_RETURN,
+        [ROP_DUMP_INT] = &&label_ROP_DUMP_INT,
+        [ROP_DUMP_REAL] = &&label_ROP_DUMP_REAL,
+        [ROP_CONSTANT] = &&label_ROP_CONSTANT,
+        [ROP_CONSTANT_LONG] = &&label_ROP_CONSTANT_LONG,
+        [ROP_NEGATE_INT] = &&label_ROP_NEGATE_INT,
+        [ROP_NEGATE_REAL] = &&label_ROP_NEGATE_REAL,
+        [ROP_ADD_INT] = &&label_ROP_ADD_INT,
+        [ROP_ADD_REAL] = &&label_ROP_ADD_REAL,
+        [ROP_SUBTRACT_INT] = &&label_ROP_SUBTRACT_INT,
+        [ROP_SUBTRACT_REAL] = &&label_ROP_SUBTRACT_REAL,
+        [ROP_MULTIPLY_INT] = &&label_ROP_MULTIPLY_INT,
+        [ROP_MULTIPLY_REAL] = &&label_ROP_MULTIPLY_REAL,
+        [ROP_DIVIDE_REAL] = &&label_ROP_DIVIDE_REAL,
+        [ROP_DIV_INT] = &&label_ROP_DIV_INT,
+        [ROP_TO_REAL] = &&label_ROP_TO_REAL,
+        [ROP_MOVE] = &&label_ROP_MOVE,
+        [ROP_YIELD_INT] = &&label_ROP_YIELD_INT,
+        [ROP_YIELD_REAL] = &&label_ROP_YIELD_REAL,
+        [ROP_CALL_NATIVE] = &&label_ROP_CALL_NATIVE,
+    };
+
+    static void *metered_table[UINT8_MAX + 1] = {
+        [0 ... UINT8_MAX] = &&label_unknown,
+        [ROP_RETURN] = &&label_metered_ROP_RETURN,
+        [ROP_DUMP_INT] = &&label_metered_ROP_DUMP_INT,
+        [ROP_DUMP_REAL] = &&label_metered_ROP_DUMP_REAL,
+        [ROP_CONSTANT] = &&label_metered_ROP_CONSTANT,
+        [ROP_CONSTANT_LONG] = &&label_metered_ROP_CONSTANT_LONG,
+        [ROP_NEGATE_INT] = &&label_metered_ROP_NEGATE_INT,
+        [ROP_NEGATE_REAL] = &&label_metered_ROP_NEGATE_REAL,
+        [ROP_ADD_INT] = &&label_metered_ROP_ADD_INT,
+        [ROP_ADD_REAL] = &&label_metered_ROP_ADD_REAL,
+        [ROP_SUBTRACT_INT] = &&label_metered_ROP_SUBTRACT_INT,
+        [ROP_SUBTRACT_REAL] = &&label_metered_ROP_SUBTRACT_REAL,
+        [ROP_MULTIPLY_INT] = &&label_metered_ROP_MULTIPLY_INT,
+        [ROP_MULTIPLY_REAL] = &&label_metered_ROP_MULTIPLY_REAL,
+        [ROP_DIVIDE_REAL] = &&label_metered_ROP_DIVIDE_REAL,
+        [ROP_DIV_INT] = &&label_metered_ROP_DIV_INT,
+        [ROP_TO_REAL] = &&label_metered_ROP_TO_REAL,
+        [ROP_MOVE] = &&label_metered_ROP_MOVE,
+        [ROP_YIELD_INT] = &&label_metered_ROP_YIELD_INT,
+        [ROP_YIELD_REAL] = &&label_metered_ROP_YIELD_REAL,
+        [ROP_CALL_NATIVE] = &&label_metered_ROP_CALL_NATIVE,
+    };
+#endif
+
+    while (true) {
+        SKARD_DISPATCH() {
+            SKARD_CASE(ROP_RETURN):
+                return INTERPRETER_OK;
+            SKARD_CASE(ROP_DUMP_INT):
+                print_value_of_kind(registers[SKARD_A()], TYPE_INT);
+                printf("\n");
+                SKARD_NEXT();
+            SKARD_CASE(ROP_DUMP_REAL):
+                print_value_of_kind(registers[SKARD_A()], TYPE_REAL);
+                printf("\n");
+                SKARD_NEXT();
+            SKARD_CASE(ROP_CONSTANT):
+                registers[SKARD_A()] = constants[SKARD_B() | SKARD_C() << 8];
+                SKARD_NEXT();
+            SKARD_CASE(ROP_CONSTANT_LONG): {
+                uint8_t a = SKARD_A();
+                vm->ip += SKARD_REGISTER_INSTRUCTION_SIZE;
+                // The index takes the first three bytes of the extension word
+                registers[a] = constants[vm->ip[-4] | vm->ip[-3] << 8 | vm->ip[-2] << 16];
+                SKARD_NEXT();
+            }
+            SKARD_CASE(ROP_NEGATE_INT):
+                registers[SKARD_A()] = vm_negate_int(SKARD_RK(SKARD_B()));
+                SKARD_NEXT();
+            SKARD_CASE(ROP_NEGATE_REAL):
+                registers[SKARD_A()] = vm_negate_real(SKARD_RK(SKARD_B()));
+                SKARD_NEXT();
+            SKARD_CASE(ROP_ADD_INT):
+                SKARD_BINARY_OP(vm_add_int);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_ADD_REAL):
+                SKARD_BINARY_OP(vm_add_real);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_SUBTRACT_INT):
+                SKARD_BINARY_OP(vm_subtract_int);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_SUBTRACT_REAL):
+                SKARD_BINARY_OP(vm_subtract_real);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_MULTIPLY_INT):
+                SKARD_BINARY_OP(vm_multiply_int);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_MULTIPLY_REAL):
+                SKARD_BINARY_OP(vm_multiply_real);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_DIVIDE_REAL):
+                SKARD_BINARY_OP(vm_divide_real);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_DIV_INT):
+                if (SKARD_RK(SKARD_C()).as.sk_int == 0) {
+                    vm_runtime_error(vm, vm->ip - vm->chunk->code - SKARD_REGISTER_INSTRUCTION_SIZE,
+                                     "Integer division by zero.");
+                    return INTERPRETER_NOK_RUNTIME;
+                }
+                SKARD_BINARY_OP(vm_div_int);
+                SKARD_NEXT();
+            SKARD_CASE(ROP_TO_REAL):
+                registers[SKARD_A()] = vm_to_real(SKARD_RK(SKARD_B()));
+                SKARD_NEXT();
+            SKARD_CASE(ROP_MOVE):
+                registers[SKARD_A()] = registers[SKARD_B()];
+                SKARD_NEXT();
+            SKARD_CASE(ROP_YIELD_INT):
+                SKARD_SUSPEND(&registers[SKARD_A()], TYPE_INT);
+            SKARD_CASE(ROP_YIELD_REAL):
+                SKARD_SUSPEND(&registers[SKARD_A()], TYPE_REAL);
+            SKARD_CASE(ROP_CALL_NATIVE): {
+                const NativeFunction *native = &vm->natives->functions[SKARD_C()];
+                registers[SKARD_A()] = native->trampoline(native->function, &registers[SKARD_A()]);
+                SKARD_NEXT();
+            }
+            SKARD_CASE_UNKNOWN:
+                return INTERPRETER_NOK_RUNTIME;
+        }
+    }
+
+#undef SKARD_READ_OPCODE
+#undef SKARD_OPCODE_SIZE
+#undef SKARD_TRACE_RECORD
+#undef SKARD_PROFILE_STEP
+#undef SKARD_A
+#undef SKARD_B
+#undef SKARD_C
+#undef SKARD_RK
+#undef SKARD_BINARY_OP
 }
 
+#ifdef SKARD_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+#undef SKARD_IS_PROFILED
+#undef SKARD_IS_INSPECTED
+#undef SKARD_IS_METERED
+#undef SKARD_FUEL
+#undef SKARD_SUSPEND
+#undef SKARD_TRACE
+#undef SKARD_SAMPLE
+#undef SKARD_DISPATCH
+#undef SKARD_NEXT
+#undef SKARD_CASE
+#undef SKARD_CASE_UNKNOWN
+
 InterpreterResult vm_run(SkardVM *vm, Chunk *chunk)
 {
+    if (!chunk->is_verified && !chunk_verify(chunk)) {
+        return INTERPRETER_NOK_VERIFICATION;
+    }
+    // Checked once per run, native calls themselves trust the verified indices
+    size_t natives_count = vm->natives != NULL ? vm->natives->count : 0;
+    if (chunk->natives_count > natives_count) {
+        fprintf(stderr, "ERROR: Chunk calls native functions that are not registered with the VM.\n");
+        return INTERPRETER_NOK_VERIFICATION;
+    }
+    for (size_t i = 0; i < chunk->natives_count; i++) {
+        const NativeFunction *native = &vm->natives->functions[i];
+        if (chunk->native_arities[i] != SKARD_NATIVE_UNUSED && chunk->native_arities[i] != native->arity) {
+            fprintf(stderr, "ERROR: Chunk calls native function '%.*s' with %d arguments, it takes %zu.\n",
+                    (int) native->name_length, native->name, chunk->native_arities[i], native->arity);
+            return INTERPRETER_NOK_VERIFICATION;
+        }
+    }
+
     vm->chunk = chunk;
     vm->ip = chunk->code;
+    vm->stack.stack_top = vm->stack.stack;
+    vm_stack_reserve(&vm->stack, chunk->max_stack_depth);
+#ifdef SKARD_PROFILE
+    vm->profile.previous_op = SKARD_PROFILE_NO_OP;
+#endif
 
-    return vm_loop(vm);
+    if (jit_enter(vm, chunk)) {
+        vm->ip = NULL;
+        vm->sampled_offset = SKARD_SAMPLED_NATIVE;
+        return jit_run(vm, chunk);
+    }
+
+    if (chunk->format == CHUNK_FORMAT_REGISTER) {
+        vm->stack.stack_top = vm->stack.stack + chunk->registers_count;
+    }
+    return vm_resume(vm);
+}
+
+// Continues a run that returned INTERPRETER_YIELD or INTERPRETER_SUSPENDED, an exhausted vm->fuel has to be refilled first
+InterpreterResult vm_resume(SkardVM *vm)
+{
+    assert((COUNT_CHUNK_FORMATS == 2) && "Exhaustive chunk formats handling");
+    switch (vm->chunk->format) {
+        case CHUNK_FORMAT_STACK:
+            return vm_loop(vm);
+        case CHUNK_FORMAT_REGISTER:
+            return vm_loop_register(vm);
+        default:
+            break;
+    }
+
+    return INTERPRETER_NOK_RUNTIME;
+}
+
+const VMProfile *vm_get_profile(const SkardVM *vm)
+{
+#ifdef SKARD_PROFILE
+    return &vm->profile;
+#else
+    (void) vm;
+    return NULL;
+#endif
 }
@@ -1,9 +1,18 @@
 #ifndef SKARD_VM_H
 #define SKARD_VM_H
 
+#include <signal.h>
+
 #include "chunk.h"
+#include "native.h"
+#include "profile.h"
+#include "trace.h"
 
 #define SKARD_VM_STACK_MIN_SIZE 256
+#define SKARD_FUEL_UNLIMITED SIZE_MAX
+// Values of sampled_offset outside of the interpreter
+#define SKARD_SAMPLED_IDLE (-1)
+#define SKARD_SAMPLED_NATIVE (-2)
 
 typedef struct {
     size_t capacity;
@@ -13,6 +22,7 @@ typedef struct {
 
 void vm_stack_init(VMStack *stack);
 void vm_stack_free(VMStack *stack);
+void vm_stack_reserve(VMStack *stack, size_t capacity);
 
 void vm_stack_push(VMStack *stack, Value value);
 Value vm_stack_pop(VMStack *stack);
@@ -20,17 +30,48 @@ Value vm_stack_pop(VMStack *stack);
 typedef enum {
     INTERPRETER_OK,
     INTERPRETER_NOK_RUNTIME,
+    INTERPRETER_NOK_VERIFICATION,
+    INTERPRETER_YIELD,
+    // The script executed yield, vm->yielded holds its value until vm_resume
+    INTERPRETER_SUSPENDED,
 } InterpreterResult;
 
 typedef struct {
     Chunk *chunk;
+    // NULL while generated code runs the chunk
     uint8_t *ip;
     VMStack stack;
+    // Entries after which a chunk is compiled to native code, 0 keeps everything interpreted
+    size_t jit_threshold;
+    // Records every executed instruction while set, chunks are interpreted while tracing is armed
+    TraceBuffer *trace;
+    // Instructions left before vm_run or vm_resume return INTERPRETER_YIELD, a run it covers to the end of the chunk is
+    // not counted and leaves it unchanged
+    size_t fuel;
+    // Host functions the chunk calls by index, it has to be compiled against this registry
+    const NativeRegistry *natives;
+    // Slot of the last yielded value, whatever it holds on vm_resume becomes the value of the yield expression
+    Value *yielded;
+    TypeKind yielded_kind;
+    // Set by a running sampler. The loop then publishes the offset of every instruction before executing it, ip
+    // itself is cached in registers and may be stale when a signal arrives. Signal handlers may only rely on a
+    // volatile sig_atomic_t being read and written whole, so the offset is published as one.
+    bool is_sampled;
+    volatile sig_atomic_t sampled_offset;
+#ifdef SKARD_PROFILE
+    VMProfile profile;
+#endif
 } SkardVM;
 
 void vm_init(SkardVM *vm);
 void vm_free(SkardVM *vm);
 
+void vm_runtime_error(SkardVM *vm, size_t offset, const char *message);
+
 InterpreterResult vm_run(SkardVM *vm, Chunk *chunk);
+InterpreterResult vm_resume(SkardVM *vm);
+
+// Counters gathered since vm_init, NULL when the VM is built without SKARD_PROFILE
+const VMProfile *vm_get_profile(const SkardVM *vm);
 
 #endif //SKARD_VM_H
@@ -0,0 +1,126 @@
+#include "bytecode_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <sys/stat.h>
+#define SKARD_BYTECODE_CACHE_SUPPORTED
+#endif
+
+#ifdef SKARD_BYTECODE_CACHE_SUPPORTED
+
+static char *join_path(const char *first, const char *second)
+{
+    size_t size = strlen(first) + strlen(second) + 2;
+    char *path = malloc(size);
+    if (path != NULL) {
+        snprintf(path, size, "%s/%s", first, second);
+    }
+    return path;
+}
+
+static char *bytecode_cache_directory(void)
+{
+    const char *directory = getenv("SKARD_CACHE_DIR");
+    if (directory != NULL && directory[0] != '\0') {
+        char *copy = malloc(strlen(directory) + 1);
+        if (copy != NULL) {
+            strcpy(copy, directory);
+        }
+        return copy;
+    }
+
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home != NULL && cache_home[0] != '\0') {
+        return join_path(cache_home, "skard");
+    }
+
+    const char *home = getenv("HOME");
+    if (home != NULL && home[0] != '\0') {
+        return join_path(home, ".cache/skard");
+    }
+
+    return NULL;
+}
+
+// Creates every missing directory along the path
+static bool make_directories(char *path)
+{
+    for (char *separator = strchr(path + 1, '/'); separator != NULL; separator = strchr(separator + 1, '/')) {
+        *separator = '\0';
+        bool is_made = mkdir(path, 0755) == 0 || errno == EEXIST;
+        *separator = '/';
+        if (!is_made) {
+            return false;
+        }
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+#endif
+
+bool bytecode_cache_init(BytecodeCache *cache, const char *source, const CompilerOptions *options)
+{
+    cache->directory = NULL;
+    cache->path = NULL;
+    cache->natives = options->natives;
+    cache->source = source;
+#ifdef SKARD_BYTECODE_CACHE_SUPPORTED
+    cache->directory = bytecode_cache_directory();
+    if (cache->directory == NULL) {
+        return false;
+    }
+
+    uint64_t hash = hash_bytes(source, strlen(source), SKARD_HASH_SEED);
+    hash = hash_bytes(SKARD_VERSION, strlen(SKARD_VERSION), hash);
+    // Builds with differently sized values cannot share files, keep them from overwriting each other. Single-pass
+    // chunks are not folded and leave some division by zero errors to run time, they get files of their own.
+    uint8_t layout[3] = { (uint8_t) options->format, (uint8_t) options->mode, (uint8_t) sizeof(Value) };
+    hash = hash_bytes(layout, sizeof(layout), hash);
+    if (options->fusions != NULL) {
+        hash = hash_bytes(options->fusions->enabled, sizeof(options->fusions->enabled), hash);
+    }
+    if (options->natives != NULL) {
+        hash = native_registry_hash(options->natives, hash);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".skc", hash);
+    cache->path = join_path(cache->directory, name);
+    return cache->path != NULL;
+#else
+    return false;
+#endif
+}
+
+void bytecode_cache_free(BytecodeCache *cache)
+{
+    free(cache->directory);
+    free(cache->path);
+    cache->directory = NULL;
+    cache->path = NULL;
+}
+
+bool bytecode_cache_load(BytecodeCache *cache, Chunk *chunk)
+{
+    return cache->path != NULL && skc_try_map_file(chunk, cache->path, cache->natives, cache->source);
+}
+
+// Best effort, a cache that cannot be written only costs the next run a compile
+void bytecode_cache_store(BytecodeCache *cache, Chunk *chunk)
+{
+#ifdef SKARD_BYTECODE_CACHE_SUPPORTED
+    if (cache->path != NULL && make_directories(cache->directory)) {
+        skc_try_write_file(chunk, cache->path, cache->natives, cache->source);
+    }
+#else
+    (void) cache;
+    (void) chunk;
+#endif
+}
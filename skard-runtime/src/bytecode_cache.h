@@ -0,0 +1,26 @@
+#ifndef SKARD_BYTECODE_CACHE_H
+#define SKARD_BYTECODE_CACHE_H
+
+#include <stdbool.h>
+
+#include "skard.h"
+
+// Compiled .skc files named after a hash of the source, the compiler version and the compiler options, stored under
+// $SKARD_CACHE_DIR, $XDG_CACHE_HOME/skard or ~/.cache/skard
+typedef struct {
+    char *directory;
+    char *path;
+    // The registry from the compiler options, recorded in and checked against every file
+    const NativeRegistry *natives;
+    // Recorded in every file and compared on load, it has to outlive the cache
+    const char *source;
+} BytecodeCache;
+
+// Returns false when there is no usable cache location
+bool bytecode_cache_init(BytecodeCache *cache, const char *source, const CompilerOptions *options);
+void bytecode_cache_free(BytecodeCache *cache);
+
+bool bytecode_cache_load(BytecodeCache *cache, Chunk *chunk);
+void bytecode_cache_store(BytecodeCache *cache, Chunk *chunk);
+
+#endif //SKARD_BYTECODE_CACHE_H
@@ -1,37 +1,242 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "skard.h"
+#include "utils.h"
+#include "bytecode_cache.h"
 
-int main(int argc, char **argv)
+static void print_usage(const char *program)
 {
-    (void) argc;
-    (void) argv;
+    fprintf(stderr, "Skard %s\n", SKARD_VERSION);
+    fprintf(stderr, "Usage: %s [--register] [--single-pass] [--fuse] [--jit | --no-jit] [--profile] [--sample <output>] [--trace] [--no-cache] <file>\n", program);
+    fprintf(stderr, "       %s compile [--register] [--single-pass] [--fuse] [--strip-debug] <file> [-o <output>]\n", program);
+    fprintf(stderr, "       %s run [--jit | --no-jit] [--profile] [--sample <output>] [--trace] <file.skc>\n", program);
+}
 
-    SkardVM vm;
-    vm_init(&vm);
+typedef enum {
+    COMMAND_EVAL,
+    COMMAND_COMPILE,
+    COMMAND_RUN,
+} Command;
 
-    Chunk c;
-    chunk_init(&c);
+// file.sk becomes file.skc, anything else gets the extension appended
+static char *make_output_filename(const char *filename)
+{
+    size_t length = strlen(filename);
+    bool has_extension = length >= 3 && strcmp(filename + length - 3, ".sk") == 0;
+    char *output = malloc(length + 5);
+    if (output == NULL) {
+        return NULL;
+    }
+    memcpy(output, filename, length);
+    strcpy(output + (has_extension ? length - 3 : length), ".skc");
+    return output;
+}
 
-    Value a = { .type = TYPE_REAL, .as.sk_real = 0.42 };
-    chunk_write_op_constant(&c, a, 0, 0);
-    chunk_write_byte(&c, OP_DUMP, 1, 0);
-    chunk_write_byte(&c, OP_RETURN, 2, 0);
+static SkInt native_abs(SkInt value)
+{
+    return value < 0 ? -value : value;
+}
 
-    disassemble_chunk(&c, "TEST");
+static SkInt native_min(SkInt a, SkInt b)
+{
+    return a < b ? a : b;
+}
 
-    printf("RUNNING...\n");
-    vm_run(&vm, &c);
+static SkInt native_max(SkInt a, SkInt b)
+{
+    return a > b ? a : b;
+}
 
-    chunk_free(&c);
+static SkReal native_fma(SkReal a, SkReal b, SkReal c)
+{
+    return a * b + c;
+}
 
-    vm_free(&vm);
+// Registration order fixes the native indices, compiled .skc files depend on it
+static void register_natives(NativeRegistry *natives)
+{
+    native_registry_add(natives, "sqrt", "(Real) -> Real", SKARD_NATIVE(sqrt));
+    native_registry_add(natives, "pow", "(Real, Real) -> Real", SKARD_NATIVE(pow));
+    native_registry_add(natives, "floor", "(Real) -> Real", SKARD_NATIVE(floor));
+    native_registry_add(natives, "abs", "(Int) -> Int", SKARD_NATIVE(native_abs));
+    native_registry_add(natives, "min", "(Int, Int) -> Int", SKARD_NATIVE(native_min));
+    native_registry_add(natives, "max", "(Int, Int) -> Int", SKARD_NATIVE(native_max));
+    native_registry_add(natives, "fma", "(Real, Real, Real) -> Real", SKARD_NATIVE(native_fma));
+}
+
+int main(int argc, char **argv)
+{
+    size_t jit_threshold = SKARD_JIT_DEFAULT_THRESHOLD;
+    bool is_profiled = false;
+    const char *sample_filename = NULL;
+    bool is_traced = false;
+    bool is_cached = true;
+    bool is_stripped = false;
 
-    printf("Test tokenize...\n");
     Compiler compiler;
-    Chunk chunk;
     compiler_init(&compiler);
-    compiler_compile_file(&compiler, "examples/basic/00_dump.sk", &chunk);
 
-    return 0;
+    FusionSet fusions;
+    fusion_set_init_all(&fusions);
+
+    Command command = COMMAND_EVAL;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "compile") == 0) {
+        command = COMMAND_COMPILE;
+        first = 2;
+    } else if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        command = COMMAND_RUN;
+        first = 2;
+    }
+
+    const char *filename = NULL;
+    const char *output_filename = NULL;
+    for (int i = first; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && command == COMMAND_COMPILE) {
+            if (i + 1 == argc) {
+                print_usage(argv[0]);
+                return 64;
+            }
+            output_filename = argv[++i];
+        } else if (strcmp(argv[i], "--strip-debug") == 0 && command == COMMAND_COMPILE) {
+            is_stripped = true;
+        } else if (strcmp(argv[i], "--register") == 0) {
+            compiler.options.format = CHUNK_FORMAT_REGISTER;
+        } else if (strcmp(argv[i], "--single-pass") == 0) {
+            compiler.options.mode = COMPILE_MODE_SINGLE_PASS;
+        } else if (strcmp(argv[i], "--fuse") == 0) {
+            compiler.options.fusions = &fusions;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            jit_threshold = 1;
+        } else if (strcmp(argv[i], "--no-jit") == 0) {
+            jit_threshold = 0;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            is_profiled = true;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            is_cached = false;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            is_traced = true;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            if (i + 1 == argc) {
+                print_usage(argv[0]);
+                return 64;
+            }
+            sample_filename = argv[++i];
+        } else if (filename == NULL) {
+            filename = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 64;
+        }
+    }
+
+    if (filename == NULL) {
+        print_usage(argv[0]);
+        return 64;
+    }
+
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    register_natives(&natives);
+    compiler.options.natives = &natives;
+
+    Chunk chunk;
+    if (command == COMMAND_RUN) {
+        if (!skc_map_file(&chunk, filename, &natives)) {
+            native_registry_free(&natives);
+            return 65;
+        }
+    } else if (command == COMMAND_EVAL && is_cached) {
+        char *source = read_file(filename);
+        BytecodeCache cache;
+        bytecode_cache_init(&cache, source, &compiler.options);
+        if (!bytecode_cache_load(&cache, &chunk)) {
+            if (!compiler_compile_source(&compiler, source, &chunk)) {
+                bytecode_cache_free(&cache);
+                free(source);
+                chunk_free(&chunk);
+                compiler_free(&compiler);
+                native_registry_free(&natives);
+                return 65;
+            }
+            bytecode_cache_store(&cache, &chunk);
+        }
+        bytecode_cache_free(&cache);
+        free(source);
+    } else if (!compiler_compile_file(&compiler, filename, &chunk)) {
+        chunk_free(&chunk);
+        compiler_free(&compiler);
+        native_registry_free(&natives);
+        return 65;
+    }
+    compiler_free(&compiler);
+
+    if (command == COMMAND_COMPILE) {
+        char *default_filename = output_filename == NULL ? make_output_filename(filename) : NULL;
+        const char *compiled_filename = output_filename != NULL ? output_filename : default_filename;
+        bool is_written = is_stripped ? skc_write_stripped_file(&chunk, compiled_filename, &natives)
+                                      : skc_write_file(&chunk, compiled_filename, &natives);
+        free(default_filename);
+        chunk_free(&chunk);
+        native_registry_free(&natives);
+        return is_written ? 0 : 73;
+    }
+
+    SkardVM vm;
+    vm_init(&vm);
+    vm.jit_threshold = jit_threshold;
+    vm.natives = &natives;
+
+    TraceBuffer trace;
+    if (is_traced) {
+        trace_buffer_init(&trace, SKARD_TRACE_DEFAULT_CAPACITY);
+        vm.trace = &trace;
+    }
+
+    VMSampler sampler;
+    vm_sampler_init(&sampler, &vm, sample_filename != NULL ? SKARD_SAMPLER_DEFAULT_CAPACITY : 0);
+    if (sample_filename != NULL && !vm_sampler_start(&sampler, SKARD_SAMPLER_DEFAULT_INTERVAL_US)) {
+        fprintf(stderr, "WARNING: Sampling is not available on this platform\n");
+    }
+
+    // Yielded values are streamed to the output as they are produced and sent back unchanged
+    InterpreterResult result = vm_run(&vm, &chunk);
+    while (result == INTERPRETER_SUSPENDED) {
+        print_value_of_kind(*vm.yielded, vm.yielded_kind);
+        printf("\n");
+        result = vm_resume(&vm);
+    }
+
+    vm_sampler_stop(&sampler);
+    if (sample_filename != NULL) {
+        FILE *file = fopen(sample_filename, "w");
+        if (file != NULL) {
+            vm_sampler_write_folded(&sampler, &chunk, filename, file);
+            fclose(file);
+        } else {
+            fprintf(stderr, "Could not open file \"%s\"\n", sample_filename);
+        }
+    }
+    vm_sampler_free(&sampler);
+    if (is_profiled) {
+        const VMProfile *profile = vm_get_profile(&vm);
+        if (profile != NULL) {
+            vm_profile_print(profile, stderr);
+        } else {
+            fprintf(stderr, "WARNING: Profiling is not available, rebuild with -DSKARD_PROFILE=ON\n");
+        }
+    }
+    if (is_traced) {
+        trace_buffer_print(&trace, &chunk, 0);
+        trace_buffer_free(&trace);
+    }
+    vm_free(&vm);
+    native_registry_free(&natives);
+
+    chunk_free(&chunk);
+
+    return result == INTERPRETER_OK ? 0 : 70;
 }
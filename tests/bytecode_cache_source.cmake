@@ -0,0 +1,35 @@
+# Cache files are named after a hash of the source. A file that lands under another source's name, by a collision or
+# because it is stale, has to be a miss rather than run the wrong program.
+set(cache_dir "${WORK_DIR}/bytecode_cache_source")
+file(REMOVE_RECURSE "${cache_dir}")
+set(ENV{SKARD_CACHE_DIR} "${cache_dir}")
+
+function(run_cached name source expected)
+    set(source_file "${WORK_DIR}/bytecode_cache_source_${name}.sk")
+    file(WRITE "${source_file}" "${source}")
+    execute_process(COMMAND "${SKARD}" "${source_file}"
+                    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error
+                    OUTPUT_STRIP_TRAILING_WHITESPACE)
+    # Debug builds print the tokens and the disassembly first, the result is the last line
+    string(FIND "${output}" "\n" position REVERSE)
+    math(EXPR position "${position} + 1")
+    string(SUBSTRING "${output}" ${position} -1 last_line)
+    if (NOT result EQUAL 0 OR NOT last_line STREQUAL expected)
+        message(FATAL_ERROR "skard ${name}: expected ${expected}, got '${last_line}' (exit ${result})\n${error}")
+    endif ()
+endfunction()
+
+run_cached(first "6 * 7" 42)
+file(GLOB first_files "${cache_dir}/*.skc")
+run_cached(second "6 * 8" 48)
+file(GLOB files "${cache_dir}/*.skc")
+list(REMOVE_ITEM files ${first_files})
+list(LENGTH first_files first_count)
+list(LENGTH files second_count)
+if (NOT first_count EQUAL 1 OR NOT second_count EQUAL 1)
+    message(FATAL_ERROR "Expected one cache file per source, found ${first_count} and ${second_count}")
+endif ()
+
+# Plant the first chunk under the second source's name
+file(COPY_FILE ${first_files} ${files})
+run_cached(second "6 * 8" 48)
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "skard.h"
+
+#define SIZE_TERMS 2000
+
+static SkInt native_abs(SkInt a)
+{
+    return a < 0 ? -a : a;
+}
+
+// Native calls keep the folder from reducing the sum to one constant, every term adds a constant and a call
+static char *make_source(SkInt offset)
+{
+    size_t capacity = SIZE_TERMS * 24;
+    char *source = malloc(capacity);
+    size_t length = 0;
+    for (SkInt i = 1; i <= SIZE_TERMS; i++) {
+        length += (size_t) snprintf(source + length, capacity - length, "%sabs(%lld)", i > 1 ? " + " : "",
+                                    (long long) (i + offset));
+    }
+    return source;
+}
+
+static bool check_entry(const char *name, ChunkCache *cache, FrozenChunk *frozen)
+{
+    const Chunk *chunk = &frozen->chunk;
+    size_t minimum = chunk->count + chunk->constants.count * sizeof(Value);
+    size_t size = cache->most_recent->size;
+    printf("%-8s %zu bytes counted, %zu bytes of code and constants, %zu bytes packed\n", name, size, minimum,
+           chunk->packed_size);
+
+    if (chunk->packed == NULL || size < chunk->packed_size || size < minimum) {
+        fprintf(stderr, "ERROR: %s: the cache counts %zu bytes for a chunk of at least %zu.\n", name, size, minimum);
+        return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "abs", "(Int) -> Int", SKARD_NATIVE(native_abs));
+
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.natives = &natives;
+    char *first_source = make_source(0);
+    char *second_source = make_source(SIZE_TERMS);
+
+    ChunkCache cache;
+    chunk_cache_init(&cache, SKARD_CHUNK_CACHE_DEFAULT_MEMORY_CAP);
+    FrozenChunk *first = chunk_cache_compile(&cache, &compiler, first_source);
+    bool is_ok = first != NULL && check_entry("first", &cache, first);
+    size_t first_size = is_ok ? cache.memory_used : 0;
+
+    FrozenChunk *second = chunk_cache_compile(&cache, &compiler, second_source);
+    is_ok = is_ok && second != NULL && check_entry("second", &cache, second);
+    if (is_ok && cache.memory_used != first_size + cache.most_recent->size) {
+        fprintf(stderr, "ERROR: %zu bytes used, expected the sum of both entries.\n", cache.memory_used);
+        is_ok = false;
+    }
+    if (first != NULL) {
+        frozen_chunk_release(first);
+    }
+    if (second != NULL) {
+        frozen_chunk_release(second);
+    }
+    chunk_cache_free(&cache);
+
+    // With room for one of the chunks only, the second one has to push the first out
+    chunk_cache_init(&cache, first_size + first_size / 2);
+    for (size_t i = 0; i < 2 && is_ok; i++) {
+        FrozenChunk *frozen = chunk_cache_compile(&cache, &compiler, i == 0 ? first_source : second_source);
+        is_ok = frozen != NULL;
+        if (frozen != NULL) {
+            frozen_chunk_release(frozen);
+        }
+    }
+    if (is_ok && (cache.evictions != 1 || cache.entries_count != 1 || cache.memory_used > cache.memory_cap)) {
+        fprintf(stderr, "ERROR: %llu evictions and %zu entries in %zu of %zu bytes, expected the first evicted.\n",
+                (unsigned long long) cache.evictions, cache.entries_count, cache.memory_used, cache.memory_cap);
+        is_ok = false;
+    }
+    chunk_cache_free(&cache);
+
+    free(first_source);
+    free(second_source);
+    compiler_free(&compiler);
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}
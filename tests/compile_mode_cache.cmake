@@ -0,0 +1,19 @@
+# Division by a folded zero is a compile error in the default mode and a runtime error with --single-pass. The file
+# cached by a single-pass run must not be loaded by a default run of the same source.
+set(cache_dir "${WORK_DIR}/compile_mode_cache")
+file(REMOVE_RECURSE "${cache_dir}")
+set(ENV{SKARD_CACHE_DIR} "${cache_dir}")
+
+set(source_file "${WORK_DIR}/compile_mode_cache.sk")
+file(WRITE "${source_file}" "1 | (2 - 2)")
+
+function(expect_exit expected)
+    execute_process(COMMAND "${SKARD}" ${ARGN} "${source_file}" RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+    if (NOT result EQUAL expected)
+        message(FATAL_ERROR "skard ${ARGN}: expected exit ${expected}, got ${result}\n${error}")
+    endif ()
+endfunction()
+
+expect_exit(70 --single-pass)
+expect_exit(65)
+expect_exit(70 --single-pass)
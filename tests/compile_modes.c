@@ -0,0 +1,192 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "skard.h"
+
+#define MODES_MAX_YIELDS 8
+
+typedef struct {
+    const char *source;
+    bool is_valid;
+} ModeCase;
+
+// Every source ends in a yield so its value reaches the test, the AST mode folds most of these and the single pass
+// emits them as written
+static const ModeCase mode_cases[] = {
+    { "yield 1 + 2.5", true },
+    { "yield (1 + 2) * 2.5 - 4", true },
+    { "yield -(3 * 4) + 0.5", true },
+    { "yield 7 / 2", true },
+    { "yield 7 | 2", true },
+    { "yield -7 | 2", true },
+    { "yield 9223372036854775807 + 1", true },
+    { "yield -9223372036854775807 - 1 | -1", true },
+    { "yield sqrt(2) + 1", true },
+    { "yield pow(2, 10) - abs(-24)", true },
+    { "yield min(3, 4) * max(2, 9) | 2", true },
+    { "yield fma(1, 2, 3)", true },
+    { "yield struct { a = 1, b = 2.5 }.b + struct { a = 3 }.a", true },
+    { "yield struct { p = struct { x = 3, y = 4 }, q = 7 }.p.y * abs(-2)", true },
+    { "yield -struct { a = 5 }.a / 2", true },
+    { "yield (yield 2) * 3", true },
+    { "yield 1.5 + (yield min(2, 1) + (yield 4))", true },
+    { "yield struct { a = abs(-2), b = yield 0.5 }.a + 1", true },
+    { "yield 1 | 0", false },
+    { "yield abs(-4) | 0", false },
+    { "yield 1 + 2.5 +", false },
+    { "yield unknown(1)", false },
+    { "yield struct { a = 1 }.b", false },
+};
+
+typedef struct {
+    bool is_compiled;
+    InterpreterResult result;
+    size_t yields_count;
+    TypeKind kinds[MODES_MAX_YIELDS];
+    Value values[MODES_MAX_YIELDS];
+} ModeRun;
+
+static SkInt native_abs(SkInt a)
+{
+    return a < 0 ? -a : a;
+}
+
+static SkInt native_min(SkInt a, SkInt b)
+{
+    return a < b ? a : b;
+}
+
+static SkInt native_max(SkInt a, SkInt b)
+{
+    return a > b ? a : b;
+}
+
+static SkReal native_fma(SkReal a, SkReal b, SkReal c)
+{
+    return a * b + c;
+}
+
+static ModeRun run_mode(const char *source, CompileMode mode, const NativeRegistry *natives)
+{
+    ModeRun run = { .is_compiled = false, .result = INTERPRETER_NOK_RUNTIME, .yields_count = 0 };
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.mode = mode;
+    compiler.options.natives = natives;
+
+    Chunk chunk;
+    run.is_compiled = compiler_compile_source(&compiler, source, &chunk);
+    compiler_free(&compiler);
+    if (run.is_compiled) {
+        SkardVM vm;
+        vm_init(&vm);
+        vm.natives = natives;
+        run.result = vm_run(&vm, &chunk);
+        while (run.result == INTERPRETER_SUSPENDED && run.yields_count < MODES_MAX_YIELDS) {
+            run.kinds[run.yields_count] = vm.yielded_kind;
+            run.values[run.yields_count] = *vm.yielded;
+            run.yields_count++;
+            run.result = vm_resume(&vm);
+        }
+        vm_free(&vm);
+    }
+    chunk_free(&chunk);
+    return run;
+}
+
+static bool is_same_value(TypeKind kind, Value a, Value b)
+{
+    if (kind == TYPE_REAL) {
+        return a.as.sk_real == b.as.sk_real || (isnan(a.as.sk_real) && isnan(b.as.sk_real));
+    }
+    return a.as.sk_int == b.as.sk_int;
+}
+
+static bool is_same_run(const ModeRun *a, const ModeRun *b)
+{
+    if (a->is_compiled != b->is_compiled || a->result != b->result || a->yields_count != b->yields_count) {
+        return false;
+    }
+    for (size_t i = 0; i < a->yields_count; i++) {
+        if (a->kinds[i] != b->kinds[i] || !is_same_value(a->kinds[i], a->values[i], b->values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_run(const char *name, const ModeRun *run)
+{
+    fprintf(stderr, "  %-12s compiled %d, result %d, yielded", name, run->is_compiled, run->result);
+    for (size_t i = 0; i < run->yields_count; i++) {
+        if (run->kinds[i] == TYPE_REAL) {
+            fprintf(stderr, " %f", run->values[i].as.sk_real);
+        } else {
+            fprintf(stderr, " %lld", (long long) run->values[i].as.sk_int);
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+// Division by a folded zero is a compile error in the AST mode and a runtime error in the single pass, a chunk cache
+// shared by both modes must not hand the single-pass chunk to the AST mode
+static bool check_cache_keys(const NativeRegistry *natives)
+{
+    const char *source = "yield 1 | (2 - 2)";
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.natives = natives;
+    ChunkCache cache;
+    chunk_cache_init(&cache, SKARD_CHUNK_CACHE_DEFAULT_MEMORY_CAP);
+
+    compiler.options.mode = COMPILE_MODE_SINGLE_PASS;
+    FrozenChunk *single_pass = chunk_cache_compile(&cache, &compiler, source);
+    compiler.options.mode = COMPILE_MODE_AST;
+    FrozenChunk *ast = chunk_cache_compile(&cache, &compiler, source);
+
+    bool is_ok = single_pass != NULL && ast == NULL;
+    if (!is_ok) {
+        fprintf(stderr, "ERROR: The chunk cache shares entries between compile modes.\n");
+    }
+    if (single_pass != NULL) {
+        frozen_chunk_release(single_pass);
+    }
+    if (ast != NULL) {
+        frozen_chunk_release(ast);
+    }
+    chunk_cache_free(&cache);
+    compiler_free(&compiler);
+    return is_ok;
+}
+
+int main(void)
+{
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "sqrt", "(Real) -> Real", SKARD_NATIVE(sqrt));
+    native_registry_add(&natives, "pow", "(Real, Real) -> Real", SKARD_NATIVE(pow));
+    native_registry_add(&natives, "abs", "(Int) -> Int", SKARD_NATIVE(native_abs));
+    native_registry_add(&natives, "min", "(Int, Int) -> Int", SKARD_NATIVE(native_min));
+    native_registry_add(&natives, "max", "(Int, Int) -> Int", SKARD_NATIVE(native_max));
+    native_registry_add(&natives, "fma", "(Real, Real, Real) -> Real", SKARD_NATIVE(native_fma));
+
+    bool is_ok = true;
+    for (size_t i = 0; i < sizeof(mode_cases) / sizeof(mode_cases[0]); i++) {
+        const ModeCase *mode_case = &mode_cases[i];
+        ModeRun ast = run_mode(mode_case->source, COMPILE_MODE_AST, &natives);
+        ModeRun single_pass = run_mode(mode_case->source, COMPILE_MODE_SINGLE_PASS, &natives);
+
+        bool is_expected = ast.is_compiled == mode_case->is_valid &&
+                           (!ast.is_compiled || (ast.result == INTERPRETER_OK && ast.yields_count > 0));
+        if (!is_expected || !is_same_run(&ast, &single_pass)) {
+            fprintf(stderr, "ERROR: The compile modes disagree on \"%s\".\n", mode_case->source);
+            print_run("ast", &ast);
+            print_run("single-pass", &single_pass);
+            is_ok = false;
+        }
+    }
+    is_ok = check_cache_keys(&natives) && is_ok;
+
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}
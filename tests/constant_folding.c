@@ -0,0 +1,152 @@
+#include <stdio.h>
+
+#include "skard.h"
+
+typedef struct {
+    const char *source;
+    TypeKind kind;
+    SkInt int_value;
+    SkReal real_value;
+    // Native calls stay in the chunk, everything else has to reduce to one constant
+    bool is_folded;
+} FoldCase;
+
+// Folded values have to match what the VM computes at run time, the cases calling abs() compute the same values
+// without folding. `|` binds tighter than `-`, so only the parenthesized forms divide INT_MIN by -1.
+static const FoldCase fold_cases[] = {
+    { "yield 9223372036854775807 + 1", TYPE_INT, INT64_MIN, 0, true },
+    { "yield abs(9223372036854775807) + 1", TYPE_INT, INT64_MIN, 0, false },
+    { "yield -9223372036854775807 - 2", TYPE_INT, INT64_MAX, 0, true },
+    { "yield -abs(9223372036854775807) - 2", TYPE_INT, INT64_MAX, 0, false },
+    { "yield 4611686018427387904 * 4", TYPE_INT, 0, 0, true },
+    { "yield abs(4611686018427387904) * 4", TYPE_INT, 0, 0, false },
+    { "yield (-9223372036854775807 - 1) | -1", TYPE_INT, INT64_MIN, 0, true },
+    { "yield -9223372036854775807 - 1 | -1", TYPE_INT, -INT64_MAX + 1, 0, true },
+    { "yield -abs(9223372036854775807) - 1 | -1", TYPE_INT, -INT64_MAX + 1, 0, false },
+    { "yield (-abs(9223372036854775807) - 1) | -1", TYPE_INT, INT64_MIN, 0, false },
+    { "yield 7 | -2", TYPE_INT, -3, 0, true },
+    { "yield -7 | 2", TYPE_INT, -3, 0, true },
+    { "yield 6 / 3", TYPE_REAL, 0, 2.0, true },
+    { "yield abs(6) / 3", TYPE_REAL, 0, 2.0, false },
+    { "yield 7 / 2", TYPE_REAL, 0, 3.5, true },
+    { "yield (1 + 2) * 2.5 - 4", TYPE_REAL, 0, 3.5, true },
+    { "yield 1 | (3 - 2)", TYPE_INT, 1, 0, true },
+};
+
+// Integer division by a zero known at compile time is rejected, whether the zero is written or folded
+static const char *division_by_zero_sources[] = {
+    "yield 1 | 0",
+    "yield 1 | (2 - 2)",
+    "yield abs(-3) | (2 - 2)",
+    "yield 1 | (3 - 3) + 1",
+};
+
+static size_t native_calls_count = 0;
+
+static SkInt native_abs(SkInt a)
+{
+    native_calls_count++;
+    return a < 0 ? -a : a;
+}
+
+static bool compile(const char *source, const NativeRegistry *natives, Chunk *chunk)
+{
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.mode = COMPILE_MODE_AST;
+    compiler.options.natives = natives;
+    bool is_compiled = compiler_compile_source(&compiler, source, chunk);
+    compiler_free(&compiler);
+    return is_compiled;
+}
+
+// A folded chunk only loads constants, yields, dumps and returns
+static bool is_chunk_folded(const Chunk *chunk)
+{
+    for (size_t offset = 0; offset < chunk->count; offset += stack_instruction_size(chunk->code[offset])) {
+        switch (chunk->code[offset]) {
+        case OP_CONSTANT:
+        case OP_CONSTANT_LONG:
+        case OP_YIELD_INT:
+        case OP_YIELD_REAL:
+        case OP_DUMP_INT:
+        case OP_DUMP_REAL:
+        case OP_CONSTANT_DUMP_INT:
+        case OP_CONSTANT_DUMP_REAL:
+        case OP_RETURN:
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_fold_case(const FoldCase *fold_case, const NativeRegistry *natives)
+{
+    Chunk chunk;
+    if (!compile(fold_case->source, natives, &chunk)) {
+        fprintf(stderr, "ERROR: \"%s\" did not compile.\n", fold_case->source);
+        chunk_free(&chunk);
+        return false;
+    }
+
+    bool is_ok = true;
+    if (is_chunk_folded(&chunk) != fold_case->is_folded) {
+        fprintf(stderr, "ERROR: \"%s\" was %s.\n", fold_case->source,
+                fold_case->is_folded ? "not folded" : "folded past a native call");
+        is_ok = false;
+    }
+
+    SkardVM vm;
+    vm_init(&vm);
+    vm.natives = natives;
+    native_calls_count = 0;
+    InterpreterResult result = vm_run(&vm, &chunk);
+    if (result != INTERPRETER_SUSPENDED || vm.yielded_kind != fold_case->kind) {
+        fprintf(stderr, "ERROR: \"%s\" did not yield a %s (result %d).\n", fold_case->source,
+                fold_case->kind == TYPE_INT ? "Int" : "Real", result);
+        is_ok = false;
+    } else if (fold_case->kind == TYPE_INT && vm.yielded->as.sk_int != fold_case->int_value) {
+        fprintf(stderr, "ERROR: \"%s\" yielded %lld, expected %lld.\n", fold_case->source,
+                (long long) vm.yielded->as.sk_int, (long long) fold_case->int_value);
+        is_ok = false;
+    } else if (fold_case->kind == TYPE_REAL && vm.yielded->as.sk_real != fold_case->real_value) {
+        fprintf(stderr, "ERROR: \"%s\" yielded %f, expected %f.\n", fold_case->source, vm.yielded->as.sk_real,
+                fold_case->real_value);
+        is_ok = false;
+    }
+    if (is_ok && !fold_case->is_folded && native_calls_count != 1) {
+        fprintf(stderr, "ERROR: \"%s\" called its native %zu times, expected once.\n", fold_case->source,
+                native_calls_count);
+        is_ok = false;
+    }
+    vm_free(&vm);
+    chunk_free(&chunk);
+    return is_ok;
+}
+
+int main(void)
+{
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "abs", "(Int) -> Int", SKARD_NATIVE(native_abs));
+
+    bool is_ok = true;
+    for (size_t i = 0; i < sizeof(fold_cases) / sizeof(fold_cases[0]); i++) {
+        is_ok = check_fold_case(&fold_cases[i], &natives) && is_ok;
+    }
+
+    for (size_t i = 0; i < sizeof(division_by_zero_sources) / sizeof(division_by_zero_sources[0]); i++) {
+        Chunk chunk;
+        if (compile(division_by_zero_sources[i], &natives, &chunk)) {
+            fprintf(stderr, "ERROR: \"%s\" compiled, expected an integer division by zero.\n",
+                    division_by_zero_sources[i]);
+            is_ok = false;
+        }
+        chunk_free(&chunk);
+    }
+
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+
+#include "skard.h"
+
+#define RESUME_MAX_YIELDS 4
+// Instructions per resume in the sliced runs, small enough to stop between most instructions
+#define RESUME_SLICE 2
+
+typedef struct {
+    TypeKind kind;
+    SkReal value;
+    // Written into the yielded slot before the next resume
+    SkReal replacement;
+} ExpectedYield;
+
+typedef struct {
+    const char *source;
+    size_t yields_count;
+    ExpectedYield yields[RESUME_MAX_YIELDS];
+} ResumeScript;
+
+// The replaced values feed the rest of the script, so the later yields only match when the handoff works
+static const ResumeScript resume_scripts[] = {
+    { "yield (yield (yield 1) + 10) * 2", 3,
+      { { TYPE_INT, 1, 5 }, { TYPE_INT, 15, 7 }, { TYPE_INT, 14, 14 } } },
+    { "yield (yield 1.5) * (yield 2) + 0.5", 3,
+      { { TYPE_REAL, 1.5, 4 }, { TYPE_INT, 2, 3 }, { TYPE_REAL, 12.5, 12.5 } } },
+};
+
+#define RESUME_SCRIPTS_COUNT (sizeof(resume_scripts) / sizeof(resume_scripts[0]))
+
+typedef struct {
+    const ResumeScript *script;
+    Chunk chunk;
+    SkardCoroutine coroutine;
+    size_t yields_count;
+    bool is_finished;
+} ResumeRun;
+
+static bool check_yield(const char *name, ResumeRun *run)
+{
+    const ResumeScript *script = run->script;
+    SkardCoroutine *coroutine = &run->coroutine;
+    if (run->yields_count == script->yields_count) {
+        fprintf(stderr, "ERROR: %s: \"%s\" yielded more than %zu times.\n", name, script->source,
+                script->yields_count);
+        return false;
+    }
+
+    const ExpectedYield *expected = &script->yields[run->yields_count++];
+    Value *slot = coroutine_yielded(coroutine);
+    SkReal value = coroutine->yielded_kind == TYPE_INT ? (SkReal) slot->as.sk_int : slot->as.sk_real;
+    if (coroutine->yielded_kind != expected->kind || value != expected->value) {
+        fprintf(stderr, "ERROR: %s: \"%s\" yield %zu gave %f, expected %f.\n", name, script->source,
+                run->yields_count, value, expected->value);
+        return false;
+    }
+
+    *slot = expected->kind == TYPE_INT ? make_value_int((SkInt) expected->replacement)
+                                       : make_value_real(expected->replacement);
+    return true;
+}
+
+// Takes turns between the coroutines of all scripts on one VM until every one of them finished
+static bool resume_all(const char *name, ChunkFormat format, size_t jit_threshold, size_t slice)
+{
+    ResumeRun runs[RESUME_SCRIPTS_COUNT];
+    bool is_ok = true;
+    for (size_t i = 0; i < RESUME_SCRIPTS_COUNT; i++) {
+        ResumeRun *run = &runs[i];
+        run->script = &resume_scripts[i];
+        run->yields_count = 0;
+        run->is_finished = false;
+
+        Compiler compiler;
+        compiler_init(&compiler);
+        compiler.options.format = format;
+        is_ok = compiler_compile_source(&compiler, run->script->source, &run->chunk) &&
+                coroutine_init(&run->coroutine, &run->chunk) && is_ok;
+        compiler_free(&compiler);
+    }
+
+    SkardVM vm;
+    vm_init(&vm);
+    vm.jit_threshold = jit_threshold;
+    size_t finished_count = 0;
+    while (is_ok && finished_count < RESUME_SCRIPTS_COUNT) {
+        for (size_t i = 0; is_ok && i < RESUME_SCRIPTS_COUNT; i++) {
+            ResumeRun *run = &runs[i];
+            if (run->is_finished) {
+                continue;
+            }
+
+            vm.fuel = slice;
+            InterpreterResult result = coroutine_resume(&run->coroutine, &vm);
+            if (result == INTERPRETER_SUSPENDED) {
+                is_ok = check_yield(name, run);
+            } else if (result == INTERPRETER_OK) {
+                run->is_finished = true;
+                finished_count++;
+                is_ok = run->yields_count == run->script->yields_count;
+            } else if (result != INTERPRETER_YIELD) {
+                fprintf(stderr, "ERROR: %s: \"%s\" failed with result %d.\n", name, run->script->source, result);
+                is_ok = false;
+            }
+        }
+    }
+    if (!is_ok) {
+        fprintf(stderr, "ERROR: %s: the coroutines did not run to their expected results.\n", name);
+    }
+    // Generated code hands the first yield over to the interpreter, the run above only covers that when it was used
+    for (size_t i = 0; is_ok && jit_threshold > 0 && jit_is_available() && i < RESUME_SCRIPTS_COUNT; i++) {
+        if (runs[i].chunk.jit_code == NULL) {
+            fprintf(stderr, "ERROR: %s: \"%s\" was not compiled to native code.\n", name, runs[i].script->source);
+            is_ok = false;
+        }
+    }
+
+    vm_free(&vm);
+    for (size_t i = 0; i < RESUME_SCRIPTS_COUNT; i++) {
+        coroutine_free(&runs[i].coroutine);
+        chunk_free(&runs[i].chunk);
+    }
+    return is_ok;
+}
+
+int main(void)
+{
+    bool is_ok = true;
+    is_ok = resume_all("stack", CHUNK_FORMAT_STACK, 0, SKARD_FUEL_UNLIMITED) && is_ok;
+    is_ok = resume_all("stack sliced", CHUNK_FORMAT_STACK, 0, RESUME_SLICE) && is_ok;
+    is_ok = resume_all("stack jit", CHUNK_FORMAT_STACK, 1, SKARD_FUEL_UNLIMITED) && is_ok;
+    is_ok = resume_all("register", CHUNK_FORMAT_REGISTER, 0, SKARD_FUEL_UNLIMITED) && is_ok;
+    is_ok = resume_all("register sliced", CHUNK_FORMAT_REGISTER, 0, RESUME_SLICE) && is_ok;
+    return is_ok ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+# Integer division by a zero known at compile time is reported by the compiler, for a written zero as well as for
+# one the folder computed. The caching is turned off so every run compiles its source.
+set(source_file "${WORK_DIR}/division_by_zero.sk")
+
+function(expect_division_error source)
+    file(WRITE "${source_file}" "${source}")
+    execute_process(COMMAND "${SKARD}" --no-cache "${source_file}" RESULT_VARIABLE result OUTPUT_QUIET
+                    ERROR_VARIABLE error)
+    string(FIND "${error}" "Integer division by zero." position)
+    if (NOT result EQUAL 65 OR position EQUAL -1)
+        message(FATAL_ERROR "\"${source}\": expected the compile error, got exit ${result}\n${error}")
+    endif ()
+endfunction()
+
+expect_division_error("1 | 0")
+expect_division_error("1 | (2 - 2)")
+expect_division_error("abs(-3) | (2 - 2)")
+expect_division_error("1 | (3 - 3) + 1")
@@ -0,0 +1,155 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "skard.h"
+
+#define STRESS_RUNS_PER_THREAD 200000
+#define STRESS_MAX_THREADS 256
+
+// The natives keep the folder from reducing the script to a single constant
+static const char *stress_source = "yield min(7, 9) * max(6, 2) + (min(5, 3) - 3) * 1000";
+static const SkInt stress_expected = 42;
+
+static SkInt native_min(SkInt a, SkInt b)
+{
+    return a < b ? a : b;
+}
+
+static SkInt native_max(SkInt a, SkInt b)
+{
+    return a > b ? a : b;
+}
+
+typedef struct {
+    FrozenChunk *frozen;
+    const NativeRegistry *natives;
+    size_t jit_threshold;
+    size_t failures;
+} StressWorker;
+
+// Every worker retains the shared chunk and runs it on its own VM
+static void *stress_worker_run(void *data)
+{
+    StressWorker *worker = data;
+    FrozenChunk *frozen = frozen_chunk_retain(worker->frozen);
+
+    SkardVM vm;
+    vm_init(&vm);
+    vm.natives = worker->natives;
+    vm.jit_threshold = worker->jit_threshold;
+    for (size_t i = 0; i < STRESS_RUNS_PER_THREAD; i++) {
+        InterpreterResult result = vm_run(&vm, &frozen->chunk);
+        if (result != INTERPRETER_SUSPENDED || vm.yielded_kind != TYPE_INT ||
+            vm.yielded->as.sk_int != stress_expected) {
+            worker->failures++;
+        }
+    }
+    vm_free(&vm);
+
+    frozen_chunk_release(frozen);
+    return NULL;
+}
+
+static double stress_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+static bool stress_run(const char *name, FrozenChunk *frozen, const NativeRegistry *natives, size_t jit_threshold,
+                       size_t threads_count)
+{
+    pthread_t threads[STRESS_MAX_THREADS];
+    StressWorker workers[STRESS_MAX_THREADS];
+
+    double start = stress_now();
+    for (size_t i = 0; i < threads_count; i++) {
+        workers[i] = (StressWorker) {
+            .frozen = frozen, .natives = natives, .jit_threshold = jit_threshold, .failures = 0 };
+        if (pthread_create(&threads[i], NULL, stress_worker_run, &workers[i]) != 0) {
+            fprintf(stderr, "ERROR: Could not start worker thread.\n");
+            return false;
+        }
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < threads_count; i++) {
+        pthread_join(threads[i], NULL);
+        failures += workers[i].failures;
+    }
+    double elapsed = stress_now() - start;
+
+    size_t runs = threads_count * STRESS_RUNS_PER_THREAD;
+    printf("%-16s %3zu threads: %8zu runs in %.3f s, %.0f runs/s\n", name, threads_count, runs, elapsed,
+           (double) runs / elapsed);
+
+    if (failures > 0) {
+        fprintf(stderr, "ERROR: %s: %zu of %zu runs returned a wrong result.\n", name, failures, runs);
+        return false;
+    }
+    if (frozen->references != 1) {
+        fprintf(stderr, "ERROR: %s: %zu references left after the workers finished.\n", name, frozen->references);
+        return false;
+    }
+    return true;
+}
+
+static bool stress_format(const char *name, ChunkFormat format, bool is_jit_compiled, NativeRegistry *natives,
+                          size_t threads_count)
+{
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.format = format;
+    compiler.options.natives = natives;
+
+    Chunk chunk;
+    bool is_compiled = compiler_compile_source(&compiler, stress_source, &chunk);
+    compiler_free(&compiler);
+    if (!is_compiled) {
+        chunk_free(&chunk);
+        return false;
+    }
+
+    FrozenChunk *frozen = chunk_freeze(&chunk, is_jit_compiled);
+    if (frozen == NULL) {
+        chunk_free(&chunk);
+        return false;
+    }
+    // The JIT variant would silently repeat the interpreted one if the chunk was left to the interpreter
+    if (is_jit_compiled && jit_is_available() && frozen->chunk.jit_code == NULL) {
+        fprintf(stderr, "ERROR: %s: the chunk was not compiled to native code.\n", name);
+        frozen_chunk_release(frozen);
+        return false;
+    }
+
+    size_t jit_threshold = is_jit_compiled ? 1 : 0;
+    bool is_ok = stress_run(name, frozen, natives, jit_threshold, 1) &&
+                 stress_run(name, frozen, natives, jit_threshold, threads_count);
+    frozen_chunk_release(frozen);
+    return is_ok;
+}
+
+int main(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads_count = cores < 2 ? 2 : (size_t) cores;
+    if (threads_count > STRESS_MAX_THREADS) {
+        threads_count = STRESS_MAX_THREADS;
+    }
+
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "min", "(Int, Int) -> Int", SKARD_NATIVE(native_min));
+    native_registry_add(&natives, "max", "(Int, Int) -> Int", SKARD_NATIVE(native_max));
+
+    bool is_ok = stress_format("stack", CHUNK_FORMAT_STACK, false, &natives, threads_count) &&
+                 stress_format("stack jit", CHUNK_FORMAT_STACK, true, &natives, threads_count) &&
+                 stress_format("register", CHUNK_FORMAT_REGISTER, false, &natives, threads_count);
+
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}
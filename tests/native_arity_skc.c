@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include "skard.h"
+
+static SkInt native_add(SkInt a, SkInt b)
+{
+    return a + b;
+}
+
+static void write_op(Chunk *chunk, uint8_t op)
+{
+    chunk_write_byte(chunk, op, 1, 1);
+}
+
+static void write_call(Chunk *chunk, uint8_t index, uint8_t arity)
+{
+    uint8_t instruction[] = { OP_CALL_NATIVE, index, arity };
+    chunk_write_instruction(chunk, instruction, sizeof(instruction), 1, 1);
+}
+
+// add(1, 2) and then a second call to the same native, with its own arguments or with none at all
+static void build_chunk(Chunk *chunk, bool is_consistent)
+{
+    chunk_init(chunk);
+    chunk_write_op_constant(chunk, make_value_int(1), 1, 1);
+    chunk_write_op_constant(chunk, make_value_int(2), 1, 1);
+    write_call(chunk, 0, 2);
+    if (is_consistent) {
+        chunk_write_op_constant(chunk, make_value_int(3), 1, 1);
+        chunk_write_op_constant(chunk, make_value_int(4), 1, 1);
+        write_call(chunk, 0, 2);
+    } else {
+        write_call(chunk, 0, 0);
+    }
+    write_op(chunk, OP_ADD_INT);
+    write_op(chunk, OP_YIELD_INT);
+    write_op(chunk, OP_RETURN);
+}
+
+// Writes the chunk to a compiled file and runs what is mapped back, as `skard run` does
+static InterpreterResult run_compiled(const char *filename, bool is_consistent, const NativeRegistry *natives,
+                                      SkInt *yielded)
+{
+    Chunk chunk;
+    build_chunk(&chunk, is_consistent);
+    bool is_written = skc_write_file(&chunk, filename, natives);
+    chunk_free(&chunk);
+    if (!is_written || !skc_map_file(&chunk, filename, natives)) {
+        return INTERPRETER_NOK_RUNTIME;
+    }
+
+    SkardVM vm;
+    vm_init(&vm);
+    vm.natives = natives;
+    InterpreterResult result = vm_run(&vm, &chunk);
+    if (result == INTERPRETER_SUSPENDED && vm.yielded_kind == TYPE_INT) {
+        *yielded = vm.yielded->as.sk_int;
+    }
+    vm_free(&vm);
+    chunk_free(&chunk);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <compiled file>\n", argv[0]);
+        return 64;
+    }
+
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "add", "(Int, Int) -> Int", SKARD_NATIVE(native_add));
+
+    bool is_ok = true;
+    SkInt yielded = 0;
+    InterpreterResult result = run_compiled(argv[1], true, &natives, &yielded);
+    if (result != INTERPRETER_SUSPENDED || yielded != 10) {
+        fprintf(stderr, "ERROR: Consistent call sites: expected 10, got %lld (result %d).\n", (long long) yielded,
+                result);
+        is_ok = false;
+    }
+
+    result = run_compiled(argv[1], false, &natives, &yielded);
+    if (result != INTERPRETER_NOK_VERIFICATION) {
+        fprintf(stderr, "ERROR: Mismatched call sites were not rejected (result %d).\n", result);
+        is_ok = false;
+    }
+
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}
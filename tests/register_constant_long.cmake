@@ -0,0 +1,37 @@
+# More constants than a short register load can address, so the register chunk has to use ROP_CONSTANT_LONG.
+# The terms are grouped to keep the expression tree shallow.
+set(count 70000)
+set(group 256)
+set(expected 2450035000)
+
+set(groups "")
+foreach (start RANGE 1 ${count} ${group})
+    math(EXPR end "${start} + ${group} - 1")
+    if (end GREATER count)
+        set(end ${count})
+    endif ()
+    set(terms "")
+    foreach (i RANGE ${start} ${end})
+        list(APPEND terms "abs(${i})")
+    endforeach ()
+    list(JOIN terms " + " terms)
+    list(APPEND groups "(${terms})")
+endforeach ()
+list(JOIN groups " + " source)
+
+set(source_file "${WORK_DIR}/register_constant_long.sk")
+file(WRITE "${source_file}" "${source}")
+
+foreach (flags "" "--register" "--register --jit")
+    separate_arguments(arguments UNIX_COMMAND "${flags}")
+    execute_process(COMMAND "${SKARD}" ${arguments} --no-cache "${source_file}"
+                    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error
+                    OUTPUT_STRIP_TRAILING_WHITESPACE)
+    # Debug builds print the tokens and the disassembly first, the result is the last line
+    string(FIND "${output}" "\n" position REVERSE)
+    math(EXPR position "${position} + 1")
+    string(SUBSTRING "${output}" ${position} -1 last_line)
+    if (NOT result EQUAL 0 OR NOT last_line STREQUAL expected)
+        message(FATAL_ERROR "skard ${flags}: expected ${expected}, got '${last_line}' (exit ${result})\n${error}")
+    endif ()
+endforeach ()
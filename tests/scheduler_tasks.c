@@ -0,0 +1,171 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "skard.h"
+
+#define TASKS_SUBMITTERS 4
+#define TASKS_PER_SUBMITTER 250
+#define TASKS_COUNT (TASKS_SUBMITTERS * TASKS_PER_SUBMITTER)
+#define TASKS_WORKERS 4
+// Small enough that every task is put back in a queue several times
+#define TASKS_SLICE 3
+#define TASKS_PARK_TIMEOUT_S 10
+
+// The natives keep the folder from reducing the script to a few instructions
+static const char *tasks_source = "(yield min(7, 9) * max(6, 2) + (min(5, 3) - 3) * 1000) + max(1, 2) - min(1, 2)";
+static const SkInt tasks_expected = 42;
+
+typedef struct {
+    size_t yields_count;
+    size_t finishes_count;
+    bool is_yield_correct;
+} TaskRecord;
+
+typedef struct {
+    Scheduler *scheduler;
+    SkardTask *tasks;
+    size_t first;
+} Submitter;
+
+static SkInt native_min(SkInt a, SkInt b)
+{
+    return a < b ? a : b;
+}
+
+static SkInt native_max(SkInt a, SkInt b)
+{
+    return a > b ? a : b;
+}
+
+// Each task is only ever run by one worker at a time, its record needs no lock
+static void task_yielded(SkardTask *task, Value *value, TypeKind kind, void *data)
+{
+    (void) task;
+    TaskRecord *record = data;
+    record->yields_count++;
+    record->is_yield_correct = kind == TYPE_INT && value->as.sk_int == tasks_expected;
+}
+
+static void task_finished(SkardTask *task, void *data)
+{
+    (void) task;
+    TaskRecord *record = data;
+    record->finishes_count++;
+}
+
+static void *submit_tasks(void *data)
+{
+    Submitter *submitter = data;
+    for (size_t i = submitter->first; i < submitter->first + TASKS_PER_SUBMITTER; i++) {
+        scheduler_submit(submitter->scheduler, &submitter->tasks[i]);
+    }
+    return NULL;
+}
+
+static bool check_tasks(const SkardTask *tasks, const TaskRecord *records)
+{
+    for (size_t i = 0; i < TASKS_COUNT; i++) {
+        const TaskRecord *record = &records[i];
+        if (record->finishes_count != 1 || record->yields_count != 1 || !record->is_yield_correct ||
+            tasks[i].result != INTERPRETER_OK) {
+            fprintf(stderr, "ERROR: Task %zu finished %zu times and yielded %zu times (result %d).\n", i,
+                    record->finishes_count, record->yields_count, tasks[i].result);
+            return false;
+        }
+        if (tasks[i].slices_count < 2) {
+            fprintf(stderr, "ERROR: Task %zu ran in a single slice, it was never put back in a queue.\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Workers with nothing left to take have to sleep on the condition rather than spin
+static bool wait_for_parked_workers(Scheduler *scheduler)
+{
+    time_t deadline = time(NULL) + TASKS_PARK_TIMEOUT_S;
+    while (true) {
+        pthread_mutex_lock(&scheduler->lock);
+        size_t sleeping_count = scheduler->sleeping_count;
+        size_t queued_count = scheduler->queued_count;
+        pthread_mutex_unlock(&scheduler->lock);
+        if (sleeping_count == scheduler->workers_count && queued_count == 0) {
+            return true;
+        }
+        if (time(NULL) > deadline) {
+            fprintf(stderr, "ERROR: %zu of %zu workers parked with %zu tasks counted as queued.\n", sleeping_count,
+                    scheduler->workers_count, queued_count);
+            return false;
+        }
+        struct timespec pause = { 0, 1000000 };
+        nanosleep(&pause, NULL);
+    }
+}
+
+int main(void)
+{
+    // Every task dumps its result, the test reports on stderr
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        return 1;
+    }
+
+    NativeRegistry natives;
+    native_registry_init(&natives);
+    native_registry_add(&natives, "min", "(Int, Int) -> Int", SKARD_NATIVE(native_min));
+    native_registry_add(&natives, "max", "(Int, Int) -> Int", SKARD_NATIVE(native_max));
+
+    Compiler compiler;
+    compiler_init(&compiler);
+    compiler.options.natives = &natives;
+    Chunk chunk;
+    bool is_compiled = compiler_compile_source(&compiler, tasks_source, &chunk);
+    compiler_free(&compiler);
+    FrozenChunk *frozen = is_compiled ? chunk_freeze(&chunk, false) : NULL;
+    if (frozen == NULL) {
+        chunk_free(&chunk);
+        native_registry_free(&natives);
+        return 1;
+    }
+
+    static SkardTask tasks[TASKS_COUNT];
+    static TaskRecord records[TASKS_COUNT];
+    for (size_t i = 0; i < TASKS_COUNT; i++) {
+        skard_task_init(&tasks[i], frozen);
+        tasks[i].vm.natives = &natives;
+        tasks[i].vm.jit_threshold = 0;
+        tasks[i].on_yield = task_yielded;
+        tasks[i].on_finish = task_finished;
+        tasks[i].data = &records[i];
+        records[i] = (TaskRecord) { .yields_count = 0, .finishes_count = 0, .is_yield_correct = false };
+    }
+
+    Scheduler scheduler;
+    if (!scheduler_init(&scheduler, TASKS_WORKERS, TASKS_SLICE)) {
+        fprintf(stderr, "ERROR: Could not start the workers.\n");
+        return 1;
+    }
+
+    pthread_t submitters[TASKS_SUBMITTERS];
+    Submitter contexts[TASKS_SUBMITTERS];
+    for (size_t i = 0; i < TASKS_SUBMITTERS; i++) {
+        contexts[i] = (Submitter) { .scheduler = &scheduler, .tasks = tasks, .first = i * TASKS_PER_SUBMITTER };
+        pthread_create(&submitters[i], NULL, submit_tasks, &contexts[i]);
+    }
+    for (size_t i = 0; i < TASKS_SUBMITTERS; i++) {
+        pthread_join(submitters[i], NULL);
+    }
+    scheduler_wait(&scheduler);
+
+    bool is_ok = check_tasks(tasks, records) && wait_for_parked_workers(&scheduler);
+    fprintf(stderr, "%d tasks on %d workers, %llu steals\n", TASKS_COUNT, TASKS_WORKERS,
+            (unsigned long long) scheduler.steals_count);
+    scheduler_free(&scheduler);
+
+    for (size_t i = 0; i < TASKS_COUNT; i++) {
+        skard_task_free(&tasks[i]);
+    }
+    frozen_chunk_release(frozen);
+    native_registry_free(&natives);
+    return is_ok ? 0 : 1;
+}